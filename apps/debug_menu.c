@@ -64,6 +64,7 @@
 #include "rtc.h"
 #include "storage.h"
 #include "fs_defines.h"
+#include "disk_cache.h"
 #include "eeprom_24cxx.h"
 #if (CONFIG_STORAGE & STORAGE_MMC) || (CONFIG_STORAGE & STORAGE_SD)
 #include "sdmmc.h"
@@ -1766,6 +1767,39 @@ static bool dbg_disk_info(void)
     info.scroll_all = true;
     return simplelist_show_list(&info);
 }
+
+static int disk_cache_callback(int btn, struct gui_synclist *lists)
+{
+    struct dc_stats stats;
+    dc_get_stats(&stats);
+
+    simplelist_set_line_count(0);
+
+    simplelist_addline("Entries: %d", DC_NUM_ENTRIES);
+    simplelist_addline("Hits: %lu", stats.hits);
+    simplelist_addline("Misses: %lu", stats.misses);
+    unsigned long probes = stats.hits + stats.misses;
+    unsigned int hitrate = probes ? 1000ull*stats.hits / probes : 0;
+    simplelist_addline("Hit rate: %u.%u%%", hitrate / 10, hitrate % 10);
+    simplelist_addline("Written back: %lu sectors", stats.writebacks);
+    simplelist_addline("Writes: %lu", stats.writes);
+
+    if (btn == ACTION_NONE)
+        btn = ACTION_REDRAW;
+
+    return btn;
+    (void)lists;
+}
+
+static bool dbg_disk_cache_info(void)
+{
+    struct simplelist_info info;
+    simplelist_info_init(&info, "Disk Cache Info", 6, NULL);
+    info.action_callback = disk_cache_callback;
+    info.hide_selection = true;
+    info.scroll_all = true;
+    return simplelist_show_list(&info);
+}
 #endif /* PLATFORM_NATIVE */
 
 #ifdef HAVE_DIRCACHE
@@ -1816,6 +1850,9 @@ static int dircache_callback(int btn, struct gui_synclist *lists)
     simplelist_addline("Scanning took: %ld.%ld s",
                        ticks / HZ, (ticks*10 / HZ) % 10);
     simplelist_addline("Entry count: %u", info.entry_count);
+    if (info.status == DIRCACHE_SCANNING)
+        simplelist_addline("Progress: %u%%", info.build_progress);
+    simplelist_addline("Build rate: %u entries/s", info.build_rate);
 
     if (btn == ACTION_NONE)
         btn = ACTION_REDRAW;
@@ -2630,6 +2667,7 @@ static const struct {
 #endif
 #if (CONFIG_PLATFORM & PLATFORM_NATIVE)
         { "View disk info", dbg_disk_info },
+        { "View disk cache info", dbg_disk_cache_info },
 #if (CONFIG_STORAGE & STORAGE_ATA)
         { "Dump ATA identify info", dbg_identify_info},
 #ifdef HAVE_ATA_SMART
@@ -53,7 +53,6 @@
 #endif
 #include "wps.h"
 
-static int compare_sort_dir; /* qsort key for sorting directories */
 
 int ft_build_playlist(struct tree_context* c, int start_index)
 {
@@ -187,16 +186,15 @@ static void check_file_thumbnails(struct tree_context* c)
     closedir(dir);
 }
 
-/* support function for qsort() */
-static int compare(const void* p1, const void* p2)
+/* compare two entries, sorting directories by 'sort_dir' */
+static int compare(const struct entry* e1, const struct entry* e2,
+                   int sort_dir)
 {
-    struct entry* e1 = (struct entry*)p1;
-    struct entry* e2 = (struct entry*)p2;
     int criteria;
 
     if (e1->attr & ATTR_DIRECTORY && e2->attr & ATTR_DIRECTORY)
     {   /* two directories */
-        criteria = compare_sort_dir;
+        criteria = sort_dir;
 
 #ifdef HAVE_MULTIVOLUME
         if (e1->attr & ATTR_VOLUME || e2->attr & ATTR_VOLUME)
@@ -272,6 +270,48 @@ static int compare(const void* p1, const void* p2)
     return 0; /* never reached */
 }
 
+/* support functions for qsort(), which passes no context; one for each
+   order of directories, since ft_load() runs on more than one thread */
+static int compare_alpha(const void* p1, const void* p2)
+{
+    return compare(p1, p2, SORT_ALPHA);
+}
+
+static int compare_date(const void* p1, const void* p2)
+{
+    return compare(p1, p2, SORT_DATE);
+}
+
+static int compare_date_reversed(const void* p1, const void* p2)
+{
+    return compare(p1, p2, SORT_DATE_REVERSED);
+}
+
+static int compare_type(const void* p1, const void* p2)
+{
+    return compare(p1, p2, SORT_TYPE);
+}
+
+static int compare_alpha_reversed(const void* p1, const void* p2)
+{
+    return compare(p1, p2, SORT_ALPHA_REVERSED);
+}
+
+static int compare_type_reversed(const void* p1, const void* p2)
+{
+    return compare(p1, p2, SORT_TYPE_REVERSED);
+}
+
+static int (* const compare_fns[])(const void* p1, const void* p2) =
+{
+    [SORT_ALPHA]          = compare_alpha,
+    [SORT_DATE]           = compare_date,
+    [SORT_DATE_REVERSED]  = compare_date_reversed,
+    [SORT_TYPE]           = compare_type,
+    [SORT_ALPHA_REVERSED] = compare_alpha_reversed,
+    [SORT_TYPE_REVERSED]  = compare_type_reversed,
+};
+
 /* load and sort directory into the tree's cache. returns NULL on failure. */
 int ft_load(struct tree_context* c, const char* tempdir)
 {
@@ -388,8 +428,9 @@ int ft_load(struct tree_context* c, const char* tempdir)
     c->dirlength = files_in_dir;
     closedir(dir);
 
-    compare_sort_dir = c->sort_dir;
-    qsort(tree_get_entries(c), files_in_dir, sizeof(struct entry), compare);
+    qsort(tree_get_entries(c), files_in_dir, sizeof(struct entry),
+          compare_fns[(unsigned)c->sort_dir < ARRAYLEN(compare_fns) ?
+                      c->sort_dir : SORT_ALPHA]);
 
     /* If thumbnail talking is enabled, make an extra run to mark files with
        associated thumbnails, so we don't do unsuccessful spinups later. */
@@ -524,6 +524,15 @@ static bool add_to_playlist(int position, bool queue)
                 recurse = (gui_syncyesno_run(&message, NULL, NULL)==YESNO_YES);
             }
 
+            if (new_playlist && recurse)
+            {
+                /* don't wait for the whole tree before playing */
+                if (playlist_play_directory(selected_file, position,
+                                            queue) > 0)
+                    onplay_result = ONPLAY_START_PLAY;
+                return false;
+            }
+
             playlist_insert_directory(NULL, selected_file, position, queue,
                                       recurse);
         }
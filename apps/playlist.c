@@ -74,6 +74,7 @@
 #include "playlist.h"
 #include "ata_idle_notify.h"
 #include "file.h"
+#include "dir.h"
 #include "action.h"
 #include "mv.h"
 #include "debug.h"
@@ -106,12 +107,32 @@
 #include "plugin.h" /* To borrow a temp buffer to rewrite a .m3u8 file */
 #include "panic.h"
 #include "logdiskf.h"
+#include "crc32.h"
+#include "playlist_checkpoint.h"
 #ifdef HAVE_DIRCACHE
 #include "dircache.h"
 #endif
 
 #define PLAYLIST_CONTROL_FILE_VERSION 2
 
+/* Parsing a playlist file to find the start of each track takes a while for
+ * large playlists, so the seek offsets found for a playlist of at least
+ * PLAYLIST_INDEX_MIN_TRACKS tracks are saved to PLAYLIST_INDEX_FILE along
+ * with the size and time of the playlist file. The next time the same,
+ * unchanged playlist is loaded, the offsets are read back from there. */
+#define PLAYLIST_INDEX_MAGIC      0x504c4931 /* "PLI1" */
+#define PLAYLIST_INDEX_MIN_TRACKS 1000
+
+struct playlist_index_header
+{
+    uint32_t magic;           /* PLAYLIST_INDEX_MAGIC */
+    uint32_t size;            /* size of the playlist file */
+    uint32_t mtime;           /* modification time of the playlist file */
+    uint32_t start;           /* offset parsing started at (after any BOM) */
+    uint32_t amount;          /* number of 32-bit seek offsets following */
+    char     filename[MAX_PATH]; /* playlist file */
+};
+
 /*
     Each playlist index has a flag associated with it which identifies what
     type of track it is.  These flags are stored in the 4 high order bits of
@@ -142,6 +163,37 @@
 #define PLAYLIST_QUEUED                 0x20000000
 #define PLAYLIST_SKIPPED                0x10000000
 
+/* Resuming replays every command in the control file, which takes a while
+ * after a long session of inserting, queueing and shuffling. So after every
+ * PLAYLIST_CHECKPOINT_COMMANDS commands, once the control file has been
+ * synced, the complete state of the current playlist is saved to
+ * PLAYLIST_CHECKPOINT_FILE with the length of the control file it covers.
+ * Resuming loads the checkpoint right after the playlist itself and replays
+ * only the commands after that point. The checkpoint is written to a
+ * temporary file that then replaces the old one, and it is removed before
+ * the control file is truncated or replaced, so any checkpoint on disk
+ * matches a synced prefix of the control file. Its indices point into the
+ * playlist file, so it also records the name, size and time of that file
+ * and is only used while they are unchanged.
+ *
+ * The state is taken with the control mutex held, but the file is written
+ * without it so that a large playlist doesn't hold up other threads. Any
+ * edit or command in the meantime changes checkpoint_state.generation and
+ * the written file is thrown away instead of replacing the old one.
+ * firmware/test/playlist_checkpoint checks that crashing at any point
+ * leaves a checkpoint that is either consistent or ignored. */
+#define PLAYLIST_CHECKPOINT_COMMANDS 64
+
+static struct
+{
+    int  base_amount; /* tracks loaded before the first command, -1 if not
+                         known yet, -2 if checkpoints can't be used */
+    int  commands;    /* commands written since the last checkpoint */
+    bool sorted;      /* playlist not shuffled since the last sort */
+    int  edits;       /* playlist edits in progress */
+    unsigned int generation; /* changes with every edit and command */
+} checkpoint_state = { -1, 0, true, 0, 0 };
+
 struct directory_search_context {
     struct playlist_info* playlist;
     int position;
@@ -197,15 +249,66 @@ static int rotate_index(const struct playlist_info* playlist, int index);
 
 #ifdef HAVE_DIRCACHE
 #define PLAYLIST_LOAD_POINTERS 1
+#define PLAYLIST_STREAM_DIRECTORY 2
 
 static struct event_queue playlist_queue SHAREDBSS_ATTR;
 static long playlist_stack[(DEFAULT_STACK_SIZE + 0x800)/sizeof(long)];
 static const char playlist_thread_name[] = "playlist cachectrl";
+
+/* state of a streaming directory insertion, see stream_start() */
+#define PLAYLIST_STREAM_FIRST   PLAYLIST_DISPLAY_COUNT /* tracks added
+                                                          before playback */
+#define PLAYLIST_STREAM_BATCH   32 /* tracks added per background batch */
+#define PLAYLIST_STREAM_DEPTH   16 /* deeper directories are skipped */
+
+static struct
+{
+    struct tree_context tc;         /* currdir is the directory walked */
+    int dirfilter;
+    int pos[PLAYLIST_STREAM_DEPTH]; /* next entry in each open directory */
+    int depth;                      /* index of currdir in pos[] */
+    int position;                   /* where the tracks are inserted */
+    bool queue;
+    volatile bool cancel;           /* playlist was emptied meanwhile */
+    volatile int count;             /* tracks inserted, -1 when idle */
+    char track[MAX_PATH+1];
+} stream = { .count = -1 };
 #endif
 
 static struct mutex current_playlist_mutex SHAREDBSS_ATTR;
 static struct mutex created_playlist_mutex SHAREDBSS_ATTR;
 
+#ifdef HAVE_DIRCACHE
+/* The playlist thread adds the tracks of a streamed directory while other
+ * threads change the current playlist as well. Every change to the tracks
+ * of a playlist is made as a whole with this held, together with its
+ * control file command, so that none of them sees another half done. */
+static struct mutex playlist_edit_mutex SHAREDBSS_ATTR;
+#endif
+
+static inline void playlist_edit_lock(void)
+{
+#ifdef HAVE_DIRCACHE
+    mutex_lock(&playlist_edit_mutex);
+#endif
+    checkpoint_state.edits++;
+}
+
+static inline void playlist_edit_unlock(void)
+{
+    checkpoint_state.edits--;
+    checkpoint_state.generation++;
+#ifdef HAVE_DIRCACHE
+    mutex_unlock(&playlist_edit_mutex);
+#endif
+}
+
+/* for temporary buffers that must stay put while they're in use */
+static struct buflib_callbacks pinned_ops = {
+    .move_callback = NULL,
+    .shrink_callback = NULL,
+};
+
 #ifdef HAVE_DIRCACHE
 static void copy_filerefs(struct dircache_fileref *dcfto,
                           const struct dircache_fileref *dcffrom,
@@ -279,11 +382,409 @@ static int convert_m3u(char* buf, int buf_len, int buf_max, char* temp)
     return dest - temp;
 }
 
+/* Return the offset of the first '\n' or '\r' in the 'len' bytes at 'p', or
+ * 'len' if there is none. Once 'p' is aligned, a word at a time is tested
+ * for either byte so that the long lines of a playlist are skipped quickly.
+ */
+static size_t find_eol(const unsigned char *p, size_t len)
+{
+    const unsigned long ones  = ~0ul / 0xff; /* 0x01 in every byte */
+    const unsigned long highs = ones << 7;   /* 0x80 in every byte */
+    size_t i = 0;
+
+    for (; i < len && ((uintptr_t)&p[i] & (sizeof (unsigned long) - 1)); i++)
+    {
+        if (p[i] == '\n' || p[i] == '\r')
+            return i;
+    }
+
+    for (; len - i >= sizeof (unsigned long); i += sizeof (unsigned long))
+    {
+        unsigned long w = *(const unsigned long *)&p[i];
+        unsigned long n = w ^ (ones * '\n');
+        unsigned long r = w ^ (ones * '\r');
+
+        /* a byte becomes zero where there's a match */
+        if (((n - ones) & ~n & highs) | ((r - ones) & ~r & highs))
+            break;
+    }
+
+    for (; i < len; i++)
+    {
+        if (p[i] == '\n' || p[i] == '\r')
+            return i;
+    }
+
+    return len;
+}
+
+/* Get the size and modification time of a file, both 0 if it can't be
+   found */
+static struct dirinfo get_file_info(const char *filename)
+{
+    char dirname[MAX_PATH];
+    const char *name;
+    struct dirinfo info;
+
+    memset(&info, 0, sizeof (info));
+
+    /* playlist file names are always absolute paths */
+    size_t len = path_dirname(filename, &name);
+    strmemcpy(dirname, name, MIN(len, sizeof (dirname) - 1));
+    path_basename(filename, &name);
+
+    DIR *dir = opendir(dirname);
+    if (!dir)
+        return info;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+    {
+        if (!strcasecmp(entry->d_name, name))
+        {
+            info = dir_get_info(dir, entry);
+            break;
+        }
+    }
+
+    closedir(dir);
+    return info;
+}
+
+/* Fill in the index file header describing the open playlist file */
+static void init_index_header(struct playlist_info *playlist,
+                              struct playlist_index_header *hdr,
+                              unsigned long start)
+{
+    memset(hdr, 0, sizeof (*hdr));
+    hdr->magic  = PLAYLIST_INDEX_MAGIC;
+    hdr->size   = filesize(playlist->fd);
+    hdr->mtime  = get_file_info(playlist->filename).mtime;
+    hdr->start  = start;
+    hdr->amount = playlist->amount;
+    strlcpy(hdr->filename, playlist->filename, sizeof (hdr->filename));
+}
+
+/* Load the seek offsets of the playlist from the index file if it is for
+ * this very playlist file. Returns true if the indices were loaded. */
+static bool load_playlist_index(struct playlist_info *playlist,
+                                unsigned long start)
+{
+    struct playlist_index_header hdr, cur;
+    bool loaded = false;
+
+    int fd = open(PLAYLIST_INDEX_FILE, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (read(fd, &hdr, sizeof (hdr)) != sizeof (hdr) ||
+        hdr.magic != PLAYLIST_INDEX_MAGIC ||
+        hdr.amount > (uint32_t)playlist->max_playlist_size ||
+        strcmp(hdr.filename, playlist->filename))
+        goto exit;
+
+    init_index_header(playlist, &cur, start);
+    if (hdr.size != cur.size || hdr.mtime != cur.mtime || !cur.mtime ||
+        hdr.start != cur.start)
+        goto exit;
+
+    /* read the 32-bit offsets into the low end of the array and widen them
+       from the top down if the indices are larger */
+    uint32_t *offsets = (uint32_t *)playlist->indices;
+    size_t size = hdr.amount * sizeof (uint32_t);
+    if ((size_t)read(fd, offsets, size) != size)
+        goto exit;
+
+    if (sizeof (playlist->indices[0]) != sizeof (uint32_t))
+    {
+        for (int i = hdr.amount - 1; i >= 0; i--)
+            playlist->indices[i] = offsets[i];
+    }
+
+#ifdef HAVE_DIRCACHE
+    copy_filerefs(playlist->dcfrefs, NULL, hdr.amount);
+#endif
+    playlist->amount = hdr.amount;
+    loaded = true;
+
+exit:
+    close(fd);
+    return loaded;
+}
+
+/* Save the seek offsets of the freshly parsed playlist, using 'buffer' to
+ * convert them to the file format */
+static void save_playlist_index(struct playlist_info *playlist,
+                                unsigned long start, char *buffer,
+                                size_t buflen)
+{
+    struct playlist_index_header hdr;
+    init_index_header(playlist, &hdr, start);
+    if (!hdr.mtime)
+        return;
+
+    int fd = open(PLAYLIST_INDEX_FILE, O_CREAT|O_WRONLY|O_TRUNC, 0666);
+    if (fd < 0)
+        return;
+
+    bool ok = write(fd, &hdr, sizeof (hdr)) == sizeof (hdr);
+
+    uint32_t *offsets = (uint32_t *)ALIGN_UP((uintptr_t)buffer, 4);
+    size_t count = (buflen - ((char *)offsets - buffer)) / sizeof (uint32_t);
+
+    for (int i = 0; ok && i < playlist->amount; i += count)
+    {
+        size_t n = MIN(count, (size_t)(playlist->amount - i));
+
+        for (size_t j = 0; j < n; j++)
+            offsets[j] = playlist->indices[i + j];
+
+        ok = (size_t)write(fd, offsets, n * sizeof (uint32_t)) ==
+                n * sizeof (uint32_t);
+    }
+
+    close(fd);
+
+    if (!ok)
+        remove(PLAYLIST_INDEX_FILE);
+}
+
+/* Track names of an in-RAM playlist (playing a directory) are front coded in
+ * playlist->buffer: each entry is a byte giving how many leading characters
+ * it shares with the entry before it, followed by the rest of the name and
+ * a terminating NUL. Every PLAYLIST_PATH_RESTART entries the full name is
+ * stored so that an entry can be decoded by replaying at most that many
+ * entries. The buffer offsets of these restart entries are kept in a table
+ * of ints growing down from the end of the buffer; the seek value of a
+ * track is the offset of its entry, as before. */
+#define PLAYLIST_PATH_RESTART   16
+#define PLAYLIST_PATH_SHARE_MAX 255
+
+static struct
+{
+    int restarts;      /* number of entries in the restart table */
+    int last_pos;      /* buffer offset of the last entry added */
+    int since_restart; /* entries added since the last restart entry */
+} path_store;
+
+static void path_store_reset(void)
+{
+    path_store.restarts = 0;
+    path_store.last_pos = -1;
+    path_store.since_restart = 0;
+}
+
+/* the restart table; entry k is at [-1-k] */
+static int * path_store_table(const struct playlist_info *playlist)
+{
+    return (int *)ALIGN_DOWN((uintptr_t)&playlist->buffer[playlist->buffer_size],
+                             sizeof (int));
+}
+
+/* decode the entry at offset 'seek' into 'buf' and return its length */
+static int path_store_get(const struct playlist_info *playlist, int seek,
+                          char *buf, size_t bufsize)
+{
+    const char *buffer = (const char *)playlist->buffer;
+    const int *table = path_store_table(playlist);
+
+    /* find the last restart at or before the entry */
+    int lo = 0, hi = path_store.restarts - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (table[-1 - mid] <= seek)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    if (hi < 0)
+        return -1;
+
+    int pos = table[-1 - lo];
+    size_t len = 0;
+
+    while (1)
+    {
+        size_t shared = MIN((unsigned char)buffer[pos], len);
+        len = shared + strlcpy(buf + shared, &buffer[pos + 1], bufsize - shared);
+        len = MIN(len, bufsize - 1);
+
+        if (pos >= seek || pos >= path_store.last_pos)
+            break;
+
+        pos += 1 + strlen(&buffer[pos + 1]) + 1;
+    }
+
+    return pos == seek ? (int)len : -1;
+}
+
+/* append a name, returning its offset or -1 if there's no room */
+static int path_store_add(struct playlist_info *playlist, const char *name)
+{
+    char last[MAX_PATH];
+    size_t len = strlen(name);
+    size_t shared = 0;
+    bool restart = path_store.last_pos < 0 ||
+                   path_store.since_restart >= PLAYLIST_PATH_RESTART - 1;
+
+    if (!restart &&
+        path_store_get(playlist, path_store.last_pos, last, sizeof (last)) > 0)
+    {
+        while (shared < PLAYLIST_PATH_SHARE_MAX && last[shared] &&
+               last[shared] == name[shared])
+            shared++;
+    }
+    else
+    {
+        restart = true;
+    }
+
+    int *table = path_store_table(playlist);
+    char *end = (char *)&table[-path_store.restarts - (restart ? 1 : 0)];
+    int pos = playlist->buffer_end_pos;
+    size_t size = 1 + len - shared + 1;
+
+    if (&playlist->buffer[pos] + size > end)
+        return -1;
+
+    char *p = (char *)&playlist->buffer[pos];
+    *p = shared;
+    memcpy(p + 1, name + shared, len - shared + 1);
+
+    if (restart)
+    {
+        table[-1 - path_store.restarts++] = pos;
+        path_store.since_restart = 0;
+    }
+    else
+    {
+        path_store.since_restart++;
+    }
+
+    path_store.last_pos = pos;
+    playlist->buffer_end_pos += size;
+    return pos;
+}
+
+/* Start over with checkpoints for a new or rewritten control file */
+static void checkpoint_reset(int base_amount)
+{
+    mutex_lock(&current_playlist_mutex);
+    remove(PLAYLIST_CHECKPOINT_FILE);
+    checkpoint_state.base_amount = base_amount;
+    checkpoint_state.commands = 0;
+    checkpoint_state.sorted = true;
+    checkpoint_state.generation++;
+    mutex_unlock(&current_playlist_mutex);
+}
+
+/* take the state of the current playlist for a checkpoint; called with the
+   control file synced and the control mutex held */
+static bool begin_checkpoint(struct playlist_info *playlist,
+                             struct playlist_checkpoint *cp)
+{
+    /* cached commands aren't in the control file yet but their changes
+       are already in the playlist */
+    if (playlist->num_cached > 0 || checkpoint_state.edits > 0)
+        return false;
+
+    memset(cp, 0, sizeof (*cp));
+    cp->base_amount         = checkpoint_state.base_amount;
+    cp->amount              = playlist->amount;
+    cp->index               = playlist->index;
+    cp->first_index         = playlist->first_index;
+    cp->seed                = playlist->seed;
+    cp->last_insert_pos     = playlist->last_insert_pos;
+    cp->num_inserted_tracks = playlist->num_inserted_tracks;
+    cp->last_shuffled_start = playlist->last_shuffled_start;
+    cp->shuffle_modified    = playlist->shuffle_modified;
+    cp->deleted             = playlist->deleted;
+    cp->sorted              = checkpoint_state.sorted;
+    strlcpy(cp->filename, playlist->filename, sizeof (cp->filename));
+
+    return playlist_checkpoint_mark(cp, playlist->control_fd);
+}
+
+/* write the checkpoint taken by begin_checkpoint() without the control
+   mutex and put it in place if nothing changed in the meantime */
+static void write_checkpoint(struct playlist_info *playlist,
+                             struct playlist_checkpoint *cp,
+                             unsigned int generation)
+{
+    static const char temp_file[] = PLAYLIST_CHECKPOINT_FILE "_temp";
+    struct dirinfo info = get_file_info(cp->filename);
+
+    cp->size  = info.size;
+    cp->mtime = info.mtime;
+
+    bool ok = playlist_checkpoint_write(temp_file, cp, &playlist->indices);
+
+    mutex_lock(playlist->control_mutex);
+
+    if (ok && generation == checkpoint_state.generation &&
+        rename(temp_file, PLAYLIST_CHECKPOINT_FILE) >= 0)
+        checkpoint_state.commands = 0;
+    else
+        remove(temp_file);
+
+    mutex_unlock(playlist->control_mutex);
+}
+
+/* Load the checkpoint on top of the playlist loaded from the playlist file
+ * or directory. Returns the control file position to continue replaying
+ * from, or 0 if there's no usable checkpoint. */
+static uint32_t load_checkpoint(struct playlist_info *playlist, bool *sorted)
+{
+    struct playlist_checkpoint cp;
+    uint32_t pos = 0;
+
+    int fd = playlist_checkpoint_open(PLAYLIST_CHECKPOINT_FILE, &cp,
+                                      playlist->control_fd,
+                                      playlist->max_playlist_size);
+    if (fd < 0)
+        return 0;
+
+    if (cp.base_amount != playlist->amount)
+        goto exit;
+
+    /* the playlist file must be the one the indices point into */
+    struct dirinfo info = get_file_info(playlist->filename);
+    if (strncmp(cp.filename, playlist->filename, sizeof (cp.filename)) ||
+        cp.size != (uint32_t)info.size || cp.mtime != (uint32_t)info.mtime)
+        goto exit;
+
+    if (!playlist_checkpoint_read_indices(fd, &cp, &playlist->indices))
+        goto exit;
+
+#ifdef HAVE_DIRCACHE
+    copy_filerefs(playlist->dcfrefs, NULL, cp.amount);
+#endif
+    playlist->amount              = cp.amount;
+    playlist->index               = cp.index;
+    playlist->first_index         = cp.first_index;
+    playlist->seed                = cp.seed;
+    playlist->last_insert_pos     = cp.last_insert_pos;
+    playlist->num_inserted_tracks = cp.num_inserted_tracks;
+    playlist->last_shuffled_start = cp.last_shuffled_start;
+    playlist->shuffle_modified    = cp.shuffle_modified;
+    playlist->deleted             = cp.deleted;
+    *sorted = cp.sorted;
+    pos = cp.control_size;
+
+exit:
+    close(fd);
+    return pos;
+}
+
 /*
  * remove any files and indices associated with the playlist
  */
 static void empty_playlist(struct playlist_info* playlist, bool resume)
 {
+    playlist_edit_lock();
+
     playlist->filename[0] = '\0';
     playlist->utf8 = true;
 
@@ -303,6 +804,14 @@ static void empty_playlist(struct playlist_info* playlist, bool resume)
         playlist->buffer[0] = 0;
 
     playlist->buffer_end_pos = 0;
+    if (playlist->current)
+    {
+        path_store_reset();
+#ifdef HAVE_DIRCACHE
+        /* a stream still running would fill the new playlist */
+        stream.cancel = true;
+#endif
+    }
 
     playlist->index = 0;
     playlist->first_index = 0;
@@ -323,6 +832,8 @@ static void empty_playlist(struct playlist_info* playlist, bool resume)
            playlist */
         create_control(playlist);
     }
+
+    playlist_edit_unlock();
 }
 
 /*
@@ -361,6 +872,9 @@ static void new_playlist(struct playlist_info* playlist, const char *dir,
  */
 static void create_control(struct playlist_info* playlist)
 {
+    if (playlist->current)
+        checkpoint_reset(-1);
+
     playlist->control_fd = open(playlist->control_filename,
                                 O_CREAT|O_RDWR|O_TRUNC, 0666);
     if (playlist->control_fd < 0)
@@ -436,6 +950,9 @@ static int recreate_control(struct playlist_info* playlist)
         snprintf(temp_file, sizeof(temp_file), "%s%s",
             playlist->control_filename, file_suffix);
 
+        if (playlist->current)
+            checkpoint_reset(-2);
+
         if (rename(playlist->control_filename, temp_file) < 0)
             return -1;
 
@@ -510,6 +1027,13 @@ static int recreate_control(struct playlist_info* playlist)
     if (result < 0)
         return result;
 
+    if (playlist->current)
+    {
+        checkpoint_state.base_amount =
+            playlist->amount - playlist->num_inserted_tracks;
+        checkpoint_state.commands = playlist->num_inserted_tracks;
+    }
+
     return 0;
 }
 
@@ -547,6 +1071,8 @@ static int add_indices_to_playlist(struct playlist_info* playlist,
     unsigned int nread;
     unsigned int i = 0;
     unsigned int count = 0;
+    unsigned int start;
+    int start_amount;
     bool store_index;
     unsigned char *p;
     int result = 0;
@@ -561,6 +1087,11 @@ static int add_indices_to_playlist(struct playlist_info* playlist,
     if((i = lseek(playlist->fd, 0, SEEK_CUR)) > 0)
         playlist->utf8 = true; /* Override any earlier indication. */
 
+    start = i;
+    start_amount = playlist->amount;
+    if (start_amount == 0 && load_playlist_index(playlist, start))
+        goto exit;
+
     splash(0, ID2P(LANG_WAIT));
 
     store_index = true;
@@ -576,12 +1107,24 @@ static int add_indices_to_playlist(struct playlist_info* playlist,
 
         for(count=0; count < nread; count++,p++) {
 
+            if(!store_index)
+            {
+                /* Skip the rest of the line */
+                size_t skip = find_eol(p, nread - count);
+                count += skip;
+                p += skip;
+
+                if(count >= nread)
+                    break;
+
+                store_index = true;
+            }
             /* Are we on a new line? */
-            if((*p == '\n') || (*p == '\r'))
+            else if((*p == '\n') || (*p == '\r'))
             {
                 store_index = true;
             }
-            else if(store_index)
+            else
             {
                 store_index = false;
 
@@ -606,6 +1149,10 @@ static int add_indices_to_playlist(struct playlist_info* playlist,
         i+= count;
     }
 
+    /* only an index of the whole file is worth saving */
+    if (start_amount == 0 && playlist->amount >= PLAYLIST_INDEX_MIN_TRACKS)
+        save_playlist_index(playlist, start, buffer, buflen);
+
 exit:
 #ifdef HAVE_DIRCACHE
     queue_post(&playlist_queue, PLAYLIST_LOAD_POINTERS, 0);
@@ -667,24 +1214,28 @@ static int create_and_play_dir(int direction, bool play_last)
  */
 int playlist_remove_all_tracks(struct playlist_info *playlist)
 {
-    int result;
+    int result = 0;
 
     if (playlist == NULL)
         playlist = &current_playlist;
 
+    playlist_edit_lock();
+
     while (playlist->index > 0)
         if ((result = remove_track_from_playlist(playlist, 0, true)) < 0)
-            return result;
+            goto exit;
 
     while (playlist->amount > 1)
         if ((result = remove_track_from_playlist(playlist, 1, true)) < 0)
-            return result;
+            goto exit;
 
     if (playlist->amount == 1) {
         playlist->indices[0] |= PLAYLIST_QUEUED;
     }
 
-    return 0;
+exit:
+    playlist_edit_unlock();
+    return result;
 }
 
 
@@ -715,8 +1266,11 @@ static int add_track_to_playlist(struct playlist_info* playlist,
 
     insert_position = orig_position = position;
 
+    playlist_edit_lock();
+
     if (playlist->amount >= playlist->max_playlist_size)
     {
+        playlist_edit_unlock();
         display_buffer_full();
         return -1;
     }
@@ -788,7 +1342,10 @@ static int add_track_to_playlist(struct playlist_info* playlist,
         }
         case PLAYLIST_REPLACE:
             if (playlist_remove_all_tracks(playlist) < 0)
+            {
+                playlist_edit_unlock();
                 return -1;
+            }
     
             playlist->last_insert_pos = position = insert_position = playlist->index + 1;
             break;
@@ -831,7 +1388,10 @@ static int add_track_to_playlist(struct playlist_info* playlist,
             playlist->last_insert_pos, filename, NULL, &seek_pos);
 
         if (result < 0)
+        {
+            playlist_edit_unlock();
             return result;
+        }
     }
 
     playlist->indices[insert_position] = flags | seek_pos;
@@ -842,7 +1402,8 @@ static int add_track_to_playlist(struct playlist_info* playlist,
 
     playlist->amount++;
     playlist->num_inserted_tracks++;
-    
+
+    playlist_edit_unlock();
     return insert_position;
 }
 
@@ -901,6 +1462,8 @@ static int remove_track_from_playlist(struct playlist_info* playlist,
     if (playlist->amount <= 0)
         return -1;
 
+    playlist_edit_lock();
+
     inserted = playlist->indices[position] & PLAYLIST_INSERT_TYPE_MASK;
 
     /* shift indices now that track has been removed */
@@ -938,14 +1501,136 @@ static int remove_track_from_playlist(struct playlist_info* playlist,
             position, -1, NULL, NULL, NULL);
 
         if (result < 0)
+        {
+            playlist_edit_unlock();
             return result;
+        }
 
         sync_control(playlist, false);
     }
-    
+
+    playlist_edit_unlock();
     return 0;
 }
 
+/*
+ * Rearrange the indices (and filerefs) so that track i is the one that was at
+ * position from[i] before.  Each cycle of the permutation is followed once,
+ * so every entry is moved once; from[] is used up on the way.
+ */
+#define PERMUTE_DONE 0x80000000
+static void permute_playlist(struct playlist_info* playlist, uint32_t *from)
+{
+    int i, j, k;
+
+    for (i = 0; i < playlist->amount; i++)
+    {
+        if (from[i] & PERMUTE_DONE)
+            continue;
+
+        int indextmp = playlist->indices[i];
+#ifdef HAVE_DIRCACHE
+        struct dircache_fileref dcftmp;
+        if (playlist->dcfrefs)
+            dcftmp = playlist->dcfrefs[i];
+#endif
+
+        for (j = i; (k = from[j]) != i; j = k)
+        {
+            playlist->indices[j] = playlist->indices[k];
+#ifdef HAVE_DIRCACHE
+            if (playlist->dcfrefs)
+                playlist->dcfrefs[j] = playlist->dcfrefs[k];
+#endif
+            from[j] |= PERMUTE_DONE;
+        }
+
+        playlist->indices[j] = indextmp;
+#ifdef HAVE_DIRCACHE
+        if (playlist->dcfrefs)
+            playlist->dcfrefs[j] = dcftmp;
+#endif
+        from[j] |= PERMUTE_DONE;
+    }
+}
+
+/*
+ * Sort key of a track index: its kind in the top two bits, in the order
+ * given at compare(), and its seek position below that.  Within a kind the
+ * seek positions are unique, so the flags further down never matter.
+ */
+static inline uint32_t sort_key(unsigned long index)
+{
+    uint32_t kind;
+
+    switch (index & PLAYLIST_INSERT_TYPE_MASK)
+    {
+        case PLAYLIST_INSERT_TYPE_PREPEND:
+            kind = 0;
+            break;
+        case 0:
+            kind = 1;
+            break;
+        case PLAYLIST_INSERT_TYPE_INSERT:
+            kind = 2;
+            break;
+        default:
+            kind = 3;
+            break;
+    }
+
+    return (kind << 30) | ((index & PLAYLIST_SEEK_MASK) << 2) |
+           ((index >> 28) & 3);
+}
+
+/*
+ * LSD radix sort of the positions 0..n-1 by keys[], a byte at a time.
+ * Bytes that are the same for every key are skipped.  Returns whichever of
+ * the two buffers holds the sorted positions.
+ */
+static uint32_t *radix_sort(const uint32_t *keys, uint32_t *perm,
+                            uint32_t *tmp, int n)
+{
+    static int counts[4][256]; /* too much for the stack */
+    int shift, i;
+
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < n; i++)
+    {
+        uint32_t key = keys[i];
+        counts[0][key & 0xff]++;
+        counts[1][(key >> 8) & 0xff]++;
+        counts[2][(key >> 16) & 0xff]++;
+        counts[3][key >> 24]++;
+        perm[i] = i;
+    }
+
+    for (shift = 0; shift < 4; shift++)
+    {
+        int *count = counts[shift];
+        int sum = 0;
+
+        if (count[(keys[0] >> (shift * 8)) & 0xff] == n)
+            continue;
+
+        for (i = 0; i < 256; i++)
+        {
+            int c = count[i];
+            count[i] = sum;
+            sum += c;
+        }
+
+        for (i = 0; i < n; i++)
+            tmp[count[(keys[perm[i]] >> (shift * 8)) & 0xff]++] = perm[i];
+
+        uint32_t *swap = perm;
+        perm = tmp;
+        tmp = swap;
+    }
+
+    return perm;
+}
+
 /*
  * randomly rearrange the array of indices for the playlist.  If start_current
  * is true then update the index to the new index of the current playing track
@@ -956,8 +1641,11 @@ static int randomise_playlist(struct playlist_info* playlist,
 {
     int count;
     int candidate;
+
+    playlist_edit_lock();
+
     unsigned int current = playlist->indices[playlist->index];
-    
+
     /* seed 0 is used to identify sorted playlist for resume purposes */
     if (seed == 0)
         seed = 1;
@@ -1000,7 +1688,8 @@ static int randomise_playlist(struct playlist_info* playlist,
         update_control(playlist, PLAYLIST_COMMAND_SHUFFLE, seed,
             playlist->first_index, NULL, NULL, NULL);
     }
-    
+
+    playlist_edit_unlock();
     return 0;
 }
 
@@ -1012,19 +1701,44 @@ static int randomise_playlist(struct playlist_info* playlist,
 static int sort_playlist(struct playlist_info* playlist, bool start_current,
                          bool write)
 {
+    playlist_edit_lock();
+
     unsigned int current = playlist->indices[playlist->index];
+    int n = playlist->amount;
+    int handle = 0;
+
+    /* only take the keys from free memory; an allocation that has to shrink
+       the audio buffer would stop and restart playback */
+    size_t size = 3 * n * sizeof(uint32_t);
+    if (n > 0 && size + BUFLIB_ALLOC_OVERHEAD + sizeof("playlist sort") <=
+                     core_allocatable())
+        handle = core_alloc_ex("playlist sort", size, &pinned_ops);
+
+    if (handle > 0)
+    {
+        /* the keys are taken once and sorted along with the positions of
+           their tracks, then the indices and filerefs move only once */
+        uint32_t *keys = core_get_data(handle);
+        int i;
 
-    if (playlist->amount > 0)
-        qsort((void*)playlist->indices, playlist->amount,
+        for (i = 0; i < n; i++)
+            keys[i] = sort_key(playlist->indices[i]);
+
+        permute_playlist(playlist, radix_sort(keys, keys + n, keys + 2*n, n));
+        core_free(handle);
+    }
+    else if (n > 0)
+    {
+        qsort((void*)playlist->indices, n,
             sizeof(playlist->indices[0]), compare);
 
 #ifdef HAVE_DIRCACHE
-    /** We need to re-check the song names from disk because qsort can't
-     * sort two arrays at once :/
-     * FIXME: Please implement a better way to do this. */
-    copy_filerefs(playlist->dcfrefs, NULL, playlist->max_playlist_size);
-    queue_post(&playlist_queue, PLAYLIST_LOAD_POINTERS, 0);
+        /** We need to re-check the song names from disk because qsort
+         * can't sort two arrays at once */
+        copy_filerefs(playlist->dcfrefs, NULL, playlist->max_playlist_size);
+        queue_post(&playlist_queue, PLAYLIST_LOAD_POINTERS, 0);
 #endif
+    }
 
     if (start_current)
         find_and_set_playlist_index(playlist, current);
@@ -1040,7 +1754,8 @@ static int sort_playlist(struct playlist_info* playlist, bool start_current,
         update_control(playlist, PLAYLIST_COMMAND_UNSHUFFLE,
             playlist->first_index, -1, NULL, NULL, NULL);
     }
-    
+
+    playlist_edit_unlock();
     return 0;
 }
 
@@ -1244,6 +1959,254 @@ static int compare(const void* p1, const void* p2)
         return *e1 - *e2;
 }
 
+#ifdef HAVE_DIRCACHE
+/*
+ * Streaming directory insertion.  The first few tracks of a directory tree
+ * are added right away so that playback can start, the rest is enumerated
+ * on the playlist thread in batches.  The walk uses its own tree context
+ * (and therefore its own entry and name buffers) since the browser's one
+ * belongs to the UI thread, and keeps an explicit stack of positions rather
+ * than recursing on the small thread stack.  Directories are sorted exactly
+ * like the browser sorts them, so the resulting order is the same as with
+ * playlist_insert_directory().
+ *
+ * When shuffling, each background track is inserted at a random place
+ * among the tracks not played yet (PLAYLIST_INSERT_SHUFFLED).  This is the
+ * incremental form of Fisher-Yates: every new track is equally likely to
+ * end up in any position of the upcoming part of the playlist, and unlike
+ * swapping, every step can be written to the control file as it is.
+ */
+
+static void stream_free_buffers(void)
+{
+    struct tree_cache *cache = &stream.tc.cache;
+
+    if (cache->entries_handle > 0)
+        cache->entries_handle = core_free(cache->entries_handle);
+    if (cache->name_buffer_handle > 0)
+        cache->name_buffer_handle = core_free(cache->name_buffer_handle);
+}
+
+static bool stream_alloc_buffers(void)
+{
+    struct tree_cache *cache = &stream.tc.cache;
+
+    memset(&stream.tc, 0, sizeof(stream.tc));
+    stream.dirfilter = SHOW_ALL;
+    stream.tc.dirfilter = &stream.dirfilter;
+    stream.tc.sort_dir = global_settings.sort_dir;
+
+    cache->name_buffer_size = AVERAGE_FILENAME_LENGTH *
+        global_settings.max_files_in_dir;
+    cache->name_buffer_handle = core_alloc_ex("playlist stream names",
+        cache->name_buffer_size, &pinned_ops);
+
+    cache->max_entries = global_settings.max_files_in_dir;
+    cache->entries_handle = core_alloc_ex("playlist stream entries",
+        cache->max_entries * sizeof(struct entry), &pinned_ops);
+
+    if (cache->name_buffer_handle > 0 && cache->entries_handle > 0)
+        return true;
+
+    stream_free_buffers();
+    return false;
+}
+
+/*
+ * Find the next audio file of the walk and put its path into stream.track.
+ * Returns 1 if there is one, 0 at the end of the walk and -1 on error.
+ */
+static int stream_next_track(void)
+{
+    struct tree_context *tc = &stream.tc;
+
+    while (stream.depth >= 0)
+    {
+        int i = stream.pos[stream.depth];
+
+        if (i >= tc->filesindir)
+        {
+            /* done with this directory, go on with its parent */
+            if (--stream.depth < 0)
+                break;
+
+            char *slash = strrchr(tc->currdir, '/');
+            if (slash == tc->currdir)
+                slash++;
+            *slash = '\0';
+
+            if (ft_load(tc, tc->currdir) < 0)
+                return -1;
+            continue;
+        }
+
+        struct entry *entry = tree_get_entry_at(tc, i);
+        stream.pos[stream.depth]++;
+
+        if (entry->attr & ATTR_DIRECTORY)
+        {
+            if (stream.depth + 1 >= PLAYLIST_STREAM_DEPTH ||
+                path_append(stream.track, tc->currdir, entry->name,
+                            sizeof(tc->currdir)) >= sizeof(tc->currdir))
+                continue;
+
+            /* a failed load leaves the current listing alone */
+            if (ft_load(tc, stream.track) < 0)
+                continue;
+
+            strcpy(tc->currdir, stream.track);
+            stream.pos[++stream.depth] = 0;
+        }
+        else if ((entry->attr & FILE_ATTR_MASK) == FILE_ATTR_AUDIO)
+        {
+            if (path_append(stream.track, tc->currdir, entry->name,
+                            sizeof(stream.track)) < sizeof(stream.track))
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Insert up to max tracks of the walk.  Returns the number of tracks
+ * inserted, which is less than max at the end of the walk, or -1 on error.
+ */
+static int stream_insert_tracks(struct playlist_info* playlist, int max)
+{
+    int count = 0;
+    int result;
+
+    while (count < max)
+    {
+        result = stream_next_track();
+        if (result <= 0)
+            return result < 0 ? -1 : count;
+
+        /* the playlist can be emptied or filled up by another thread while
+           the walk goes on, so check that with the track going in at once */
+        playlist_edit_lock();
+
+        /* stop quietly when full, the thread must not splash */
+        if (stream.cancel ||
+            playlist->amount >= playlist->max_playlist_size)
+        {
+            playlist_edit_unlock();
+            return count;
+        }
+
+        result = add_track_to_playlist(playlist, stream.track,
+                                       stream.position, stream.queue, -1);
+        playlist_edit_unlock();
+
+        if (result < 0)
+            return -1;
+
+        count++;
+        stream.count++;
+    }
+
+    return count;
+}
+
+/*
+ * Stop streaming: release the buffers and pick up what was inserted.
+ */
+static void stream_finish(struct playlist_info* playlist)
+{
+    stream_free_buffers();
+    stream.count = -1;
+
+    if (stream.cancel)
+        return;
+
+    sync_control(playlist, false);
+
+    if ((audio_status() & AUDIO_STATUS_PLAY) && playlist->started)
+        audio_flush_and_reload_tracks();
+
+    queue_post(&playlist_queue, PLAYLIST_LOAD_POINTERS, 0);
+}
+
+/*
+ * Insert the first tracks of dirname.  Returns false if the insertion
+ * can't be streamed, leaving it to playlist_insert_directory().
+ */
+static bool stream_start(struct playlist_info* playlist, const char *dirname,
+                         int position, bool queue)
+{
+    int count;
+
+    /* only one stream at a time */
+    if (stream.count >= 0 || !stream_alloc_buffers())
+        return false;
+
+    if (check_control(playlist) < 0)
+    {
+        stream_free_buffers();
+        splash(HZ*2, ID2P(LANG_PLAYLIST_CONTROL_ACCESS_ERROR));
+        return true;
+    }
+
+    if (ft_load(&stream.tc, dirname) < 0)
+    {
+        stream_free_buffers();
+        splash(HZ*2, ID2P(LANG_PLAYLIST_DIRECTORY_ACCESS_ERROR));
+        return true;
+    }
+
+    strlcpy(stream.tc.currdir, dirname, sizeof(stream.tc.currdir));
+    stream.pos[0] = 0;
+    stream.depth = 0;
+    stream.position = position;
+    stream.queue = queue;
+    stream.cancel = false;
+    stream.count = 0;
+
+    cpu_boost(true);
+    count = stream_insert_tracks(playlist, PLAYLIST_STREAM_FIRST);
+    cpu_boost(false);
+
+    if (count < PLAYLIST_STREAM_FIRST)
+    {
+        stream_finish(playlist);
+        return true;
+    }
+
+    /* from now on playback has started, keep the order or the shuffle */
+    if (global_settings.playlist_shuffle ||
+        position == PLAYLIST_INSERT_SHUFFLED ||
+        position == PLAYLIST_INSERT_LAST_SHUFFLED)
+        stream.position = PLAYLIST_INSERT_SHUFFLED;
+    else
+        stream.position = PLAYLIST_INSERT_LAST;
+
+    sync_control(playlist, false);
+    return true;
+}
+
+/*
+ * Add a batch of tracks on the playlist thread.
+ */
+static void stream_batch(void)
+{
+    struct playlist_info* playlist = &current_playlist;
+    bool first = stream.count == PLAYLIST_STREAM_FIRST;
+    int count = stream_insert_tracks(playlist, PLAYLIST_STREAM_BATCH);
+
+    if (count < PLAYLIST_STREAM_BATCH)
+    {
+        stream_finish(playlist);
+        return;
+    }
+
+    /* the tracks following the current one may have been buffered
+       before there were any */
+    if (first && (audio_status() & AUDIO_STATUS_PLAY) && playlist->started)
+        audio_flush_and_reload_tracks();
+}
+#endif /* HAVE_DIRCACHE */
+
 #ifdef HAVE_DIRCACHE
 /**
  * Thread to update filename pointers to dircache on background
@@ -1287,6 +2250,14 @@ static void playlist_thread(void)
 
     while (1)
     {
+        /* keep streaming as long as nothing else is to be done */
+        if (stream.count >= 0 && queue_empty(&playlist_queue))
+        {
+            stream_batch();
+            yield();
+            continue;
+        }
+
         queue_wait_w_tmo(&playlist_queue, &ev, HZ*sleep_time);
 
         switch (ev.id)
@@ -1295,6 +2266,10 @@ static void playlist_thread(void)
                 dirty_pointers = true;
                 break ;
 
+            case PLAYLIST_STREAM_DIRECTORY:
+                /* the stream is set up already, this is just the wakeup */
+                break ;
+
             /* Start the background scanning after either the disk spindown
                timeout or 5s, whichever is less */
             case SYS_TIMEOUT:
@@ -1355,6 +2330,11 @@ static void playlist_thread(void)
             }
             
             case SYS_USB_CONNECTED:
+                if (stream.count >= 0)
+                {
+                    stream.cancel = true;
+                    stream_finish(&current_playlist);
+                }
                 usb_acknowledge(SYS_USB_CONNECTED_ACK);
                 usb_wait_for_disconnect(&playlist_queue);
                 break ;
@@ -1388,7 +2368,11 @@ static int get_filename(struct playlist_info* playlist, int index, int seek,
     
     if (playlist->in_ram && !control_file && max < 0)
     {
-        max = strlcpy(tmp_buf, (char*)&playlist->buffer[seek], sizeof(tmp_buf));
+        max = path_store_get(playlist, seek, tmp_buf, sizeof(tmp_buf));
+
+        /* no entry at that offset */
+        if (max < 0)
+            return max;
     }
     else if (max < 0)
     {
@@ -1887,6 +2871,7 @@ static int flush_cached_control(struct playlist_info* playlist)
 
     if (result > 0)
     {
+        checkpoint_state.commands += playlist->num_cached;
         playlist->num_cached = 0;
         playlist->pending_control_sync = true;
 
@@ -1924,6 +2909,22 @@ static int update_control(struct playlist_info* playlist,
     cache->s2 = s2;
     cache->data = data;
 
+    if (playlist->current)
+        checkpoint_state.generation++;
+
+    if (playlist->current && command != PLAYLIST_COMMAND_PLAYLIST)
+    {
+        /* whatever is in the playlist before the first command came from
+           the playlist file or directory */
+        if (checkpoint_state.base_amount == -1)
+            checkpoint_state.base_amount = playlist->amount;
+
+        if (command == PLAYLIST_COMMAND_SHUFFLE)
+            checkpoint_state.sorted = false;
+        else if (command == PLAYLIST_COMMAND_UNSHUFFLE)
+            checkpoint_state.sorted = true;
+    }
+
     switch (command)
     {
         case PLAYLIST_COMMAND_PLAYLIST:
@@ -1965,10 +2966,25 @@ static void sync_control(struct playlist_info* playlist, bool force)
     {
         if (playlist->pending_control_sync)
         {
+            struct playlist_checkpoint cp;
+            unsigned int generation = 0;
+            bool checkpoint = false;
+
             mutex_lock(playlist->control_mutex);
             fsync(playlist->control_fd);
             playlist->pending_control_sync = false;
+
+            if (playlist->current && checkpoint_state.base_amount >= 0 &&
+                checkpoint_state.commands >= PLAYLIST_CHECKPOINT_COMMANDS)
+            {
+                generation = checkpoint_state.generation;
+                checkpoint = begin_checkpoint(playlist, &cp);
+            }
+
             mutex_unlock(playlist->control_mutex);
+
+            if (checkpoint)
+                write_checkpoint(playlist, &cp, generation);
         }
     }
 }
@@ -2019,6 +3035,9 @@ void playlist_init(void)
 
     mutex_init(&current_playlist_mutex);
     mutex_init(&created_playlist_mutex);
+#ifdef HAVE_DIRCACHE
+    mutex_init(&playlist_edit_mutex);
+#endif
 
     playlist->current = true;
     strlcpy(playlist->control_filename, PLAYLIST_CONTROL_FILE,
@@ -2124,6 +3143,8 @@ int playlist_resume(void)
     int control_file_size = 0;
     bool first = true;
     bool sorted = true;
+    uint32_t checkpoint_pos = 0;
+    int replayed = 0;
     int result = -1;
 
     /* dummy ops with no callbacks, needed because by
@@ -2246,6 +3267,10 @@ int playlist_resume(void)
                             playlist->in_ram = true;
                             resume_directory(str2);
                         }
+
+                        /* skip the commands a checkpoint already covers */
+                        checkpoint_state.base_amount = playlist->amount;
+                        checkpoint_pos = load_checkpoint(playlist, &sorted);
                         
                         /* load the rest of the data */
                         first = false;
@@ -2370,6 +3395,10 @@ int playlist_resume(void)
                         break;
                 }
 
+                if (current_command != PLAYLIST_COMMAND_PLAYLIST &&
+                    current_command != PLAYLIST_COMMAND_COMMENT)
+                    replayed++;
+
                 newline = true;
 
                 /* to ignore any extra newlines */
@@ -2495,6 +3524,12 @@ int playlist_resume(void)
 
         total_read += count;
 
+        if (checkpoint_pos > (uint32_t)total_read)
+        {
+            total_read = checkpoint_pos;
+            lseek(playlist->control_fd, total_read, SEEK_SET);
+        }
+
         if (first)
             /* still looking for header */
             nread = read(playlist->control_fd, buffer,
@@ -2509,6 +3544,9 @@ int playlist_resume(void)
         }
     }
 
+    checkpoint_state.commands = replayed;
+    checkpoint_state.sorted = sorted;
+
 #ifdef HAVE_DIRCACHE
     queue_post(&playlist_queue, PLAYLIST_LOAD_POINTERS, 0);
 #endif
@@ -2524,25 +3562,23 @@ out:
 int playlist_add(const char *filename)
 {
     struct playlist_info* playlist = &current_playlist;
-    int len = strlen(filename);
-    
-    if((len+1 > playlist->buffer_size - playlist->buffer_end_pos) ||
-       (playlist->amount >= playlist->max_playlist_size))
+    int pos = -1;
+
+    if (playlist->amount < playlist->max_playlist_size)
+        pos = path_store_add(playlist, filename);
+
+    if (pos < 0)
     {
         display_buffer_full();
         return -1;
     }
 
-    playlist->indices[playlist->amount] = playlist->buffer_end_pos;
+    playlist->indices[playlist->amount] = pos;
 #ifdef HAVE_DIRCACHE
     copy_filerefs(&playlist->dcfrefs[playlist->amount], NULL, 1);
 #endif
 
     playlist->amount++;
-    
-    strcpy((char*)&playlist->buffer[playlist->buffer_end_pos], filename);
-    playlist->buffer_end_pos += len;
-    playlist->buffer[playlist->buffer_end_pos++] = '\0';
 
     return 0;
 }
@@ -2949,6 +3985,7 @@ int playlist_set_current(struct playlist_info* playlist)
     playlist->control_fd = -1;
     close(current_playlist.control_fd);
     current_playlist.control_fd = -1;
+    checkpoint_reset(-2); /* the commands of the other playlist come along */
     remove(current_playlist.control_filename);
     current_playlist.control_created = false;
     if (rename(playlist->control_filename,
@@ -3119,6 +4156,49 @@ int playlist_insert_directory(struct playlist_info* playlist,
     return result;
 }
 
+/*
+ * Start playing a directory tree as a new current playlist.  Playback starts
+ * as soon as the first tracks are in, the rest of the tree is added on the
+ * background where that's possible.  Returns the number of tracks the
+ * playlist starts with or -1 if there are none.
+ */
+int playlist_play_directory(const char *dirname, int position, bool queue)
+{
+    struct playlist_info* playlist = &current_playlist;
+
+#ifdef HAVE_DIRCACHE
+    if (!stream_start(playlist, dirname, position, queue))
+#endif
+        playlist_insert_directory(playlist, dirname, position, queue, true);
+
+    if (playlist->amount <= 0)
+        return -1;
+
+    if (global_settings.playlist_shuffle)
+        playlist_shuffle(current_tick, -1);
+    playlist_start(0, 0, 0);
+
+#ifdef HAVE_DIRCACHE
+    if (stream.count >= 0)
+        queue_post(&playlist_queue, PLAYLIST_STREAM_DIRECTORY, 0);
+#endif
+
+    return playlist->amount;
+}
+
+/*
+ * Returns the number of tracks a streaming insertion added so far or -1 if
+ * none is running.
+ */
+int playlist_stream_count(void)
+{
+#ifdef HAVE_DIRCACHE
+    return stream.count;
+#else
+    return -1;
+#endif
+}
+
 /*
  * Insert all tracks from specified playlist into dynamic playlist.
  */
@@ -3307,6 +4387,8 @@ int playlist_move(struct playlist_info* playlist, int index, int new_index)
     if (index == new_index)
         return -1;
 
+    playlist_edit_lock();
+
     if (index == playlist->index)
     {
         /* Moving the current track */
@@ -3344,7 +4426,10 @@ int playlist_move(struct playlist_info* playlist, int index, int new_index)
 
     if (get_filename(playlist, index, seek, control_file, filename,
             sizeof(filename)) < 0)
+    {
+        playlist_edit_unlock();
         return -1;
+    }
 
     /* We want to insert the track at the position that was specified by
        new_index.  This may be different then new_index because of the
@@ -3405,6 +4490,7 @@ int playlist_move(struct playlist_info* playlist, int index, int new_index)
     queue_post(&playlist_queue, PLAYLIST_LOAD_POINTERS, 0);
 #endif
 
+    playlist_edit_unlock();
     return result;
 }
 
@@ -163,6 +163,8 @@ int playlist_insert_track(struct playlist_info* playlist, const char *filename,
 int playlist_insert_directory(struct playlist_info* playlist,
                               const char *dirname, int position, bool queue,
                               bool recurse);
+int playlist_play_directory(const char *dirname, int position, bool queue);
+int playlist_stream_count(void);
 int playlist_insert_playlist(struct playlist_info* playlist, const char *filename,
                              int position, bool queue);
 #if CONFIG_CODEC == SWCODEC
@@ -0,0 +1,152 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#include <string.h>
+#include "file.h"
+#include "crc32.h"
+#include "playlist_checkpoint.h"
+
+/* indices are read and written this many at a time */
+#define CHUNK 64
+
+static inline int chunk_len(int left)
+{
+    return left < CHUNK ? left : CHUNK;
+}
+
+/* crc of the control file bytes just before 'size' */
+static uint32_t control_crc(int fd, uint32_t size)
+{
+    unsigned char buf[PLAYLIST_CHECKPOINT_CRC_SPAN];
+    uint32_t len = size < sizeof (buf) ? size : sizeof (buf);
+
+    if (lseek(fd, size - len, SEEK_SET) != (off_t)(size - len) ||
+        read(fd, buf, len) != (ssize_t)len)
+        return 0;
+
+    return crc_32(buf, len, 0xffffffff);
+}
+
+bool playlist_checkpoint_mark(struct playlist_checkpoint *cp, int control_fd)
+{
+    off_t pos = lseek(control_fd, 0, SEEK_CUR);
+    off_t size = filesize(control_fd);
+
+    if (pos < 0 || size < 0)
+        return false;
+
+    cp->magic        = PLAYLIST_CHECKPOINT_MAGIC;
+    cp->control_size = size;
+    cp->control_crc  = control_crc(control_fd, size);
+
+    return lseek(control_fd, pos, SEEK_SET) == pos;
+}
+
+bool playlist_checkpoint_write(const char *file,
+                               struct playlist_checkpoint *cp,
+                               volatile unsigned long *const *indices)
+{
+    uint32_t buf[CHUNK];
+
+    int fd = open(file, O_CREAT|O_WRONLY|O_TRUNC, 0666);
+    if (fd < 0)
+        return false;
+
+    /* header goes in again once the crc of the indices is known */
+    cp->indices_crc = 0xffffffff;
+    bool ok = write(fd, cp, sizeof (*cp)) == sizeof (*cp);
+
+    for (int i = 0; ok && i < cp->amount; i += CHUNK)
+    {
+        int n = chunk_len(cp->amount - i);
+
+        for (int j = 0; j < n; j++)
+            buf[j] = (*indices)[i + j];
+
+        cp->indices_crc = crc_32(buf, n * sizeof (uint32_t), cp->indices_crc);
+        ok = write(fd, buf, n * sizeof (uint32_t)) ==
+                (ssize_t)(n * sizeof (uint32_t));
+    }
+
+    if (ok)
+    {
+        ok = lseek(fd, 0, SEEK_SET) == 0 &&
+             write(fd, cp, sizeof (*cp)) == sizeof (*cp);
+    }
+
+    close(fd);
+    return ok;
+}
+
+int playlist_checkpoint_open(const char *file, struct playlist_checkpoint *cp,
+                             int control_fd, int max_amount)
+{
+    off_t control_pos = lseek(control_fd, 0, SEEK_CUR);
+    off_t control_size = filesize(control_fd);
+
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    if (read(fd, cp, sizeof (*cp)) != sizeof (*cp) ||
+        cp->magic != PLAYLIST_CHECKPOINT_MAGIC ||
+        cp->amount < 0 || cp->amount > max_amount ||
+        control_size < 0 || cp->control_size > (uint32_t)control_size ||
+        cp->control_crc != control_crc(control_fd, cp->control_size))
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    lseek(control_fd, control_pos, SEEK_SET);
+    return fd;
+}
+
+bool playlist_checkpoint_read_indices(int fd,
+                                      const struct playlist_checkpoint *cp,
+                                      volatile unsigned long *const *indices)
+{
+    uint32_t buf[CHUNK];
+    uint32_t crc = 0xffffffff;
+
+    for (int i = 0; i < cp->amount; i += CHUNK)
+    {
+        size_t size = chunk_len(cp->amount - i) * sizeof (uint32_t);
+        if (read(fd, buf, size) != (ssize_t)size)
+            return false;
+
+        crc = crc_32(buf, size, crc);
+    }
+
+    if (crc != cp->indices_crc ||
+        lseek(fd, sizeof (*cp), SEEK_SET) != sizeof (*cp))
+        return false;
+
+    for (int i = 0; i < cp->amount; i += CHUNK)
+    {
+        int n = chunk_len(cp->amount - i);
+        if (read(fd, buf, n * sizeof (uint32_t)) !=
+                (ssize_t)(n * sizeof (uint32_t)))
+            return false; /* shouldn't happen after the first pass */
+
+        for (int j = 0; j < n; j++)
+            (*indices)[i + j] = buf[j];
+    }
+
+    return true;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef _PLAYLIST_CHECKPOINT_H_
+#define _PLAYLIST_CHECKPOINT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "file.h"
+
+/* A checkpoint saves the complete state of the current playlist together
+ * with the length of the control file it covers, so that resuming only has
+ * to replay the commands after that point. See playlist.c for when one is
+ * written and when it's dropped. */
+#define PLAYLIST_CHECKPOINT_MAGIC    0x504c4332 /* "PLC2" */
+#define PLAYLIST_CHECKPOINT_CRC_SPAN 256 /* control file bytes checked */
+
+struct playlist_checkpoint
+{
+    uint32_t magic;               /* PLAYLIST_CHECKPOINT_MAGIC */
+    uint32_t control_size;        /* control file bytes covered */
+    uint32_t control_crc;         /* crc of the bytes just before that */
+    int32_t  base_amount;         /* tracks loaded from the playlist itself */
+    int32_t  amount;              /* number of indices following */
+    int32_t  index;
+    int32_t  first_index;
+    int32_t  seed;
+    int32_t  last_insert_pos;
+    int32_t  num_inserted_tracks;
+    int32_t  last_shuffled_start;
+    uint8_t  shuffle_modified;
+    uint8_t  deleted;
+    uint8_t  sorted;              /* not shuffled since the last sort */
+    uint8_t  pad;
+    uint32_t indices_crc;         /* crc of the indices */
+    uint32_t size;                /* size of the playlist file */
+    uint32_t mtime;               /* modification time of the playlist file */
+    char     filename[MAX_PATH];  /* playlist file */
+};
+
+/* Sets magic, control_size and control_crc for the control file as it is
+ * now. Returns false if the control file can't be read. */
+bool playlist_checkpoint_mark(struct playlist_checkpoint *cp, int control_fd);
+
+/* Writes the checkpoint and its amount indices to file, which is created or
+ * truncated. Sets indices_crc. Returns false if any of it failed, leaving
+ * a partial file. *indices is looked up again for every few indices as the
+ * buffer may move while the file is written. */
+bool playlist_checkpoint_write(const char *file,
+                               struct playlist_checkpoint *cp,
+                               volatile unsigned long *const *indices);
+
+/* Opens file and reads its checkpoint, which must cover a prefix of the
+ * control file as it is now and have at most max_amount indices. Returns
+ * the open file, positioned at the indices, or -1 if there's no usable
+ * checkpoint. */
+int playlist_checkpoint_open(const char *file, struct playlist_checkpoint *cp,
+                             int control_fd, int max_amount);
+
+/* Checks the crc of all the indices in fd before copying any of them to
+ * *indices, which is looked up again like above. Returns false, with the
+ * indices untouched, if they don't match. */
+bool playlist_checkpoint_read_indices(int fd,
+                                      const struct playlist_checkpoint *cp,
+                                      volatile unsigned long *const *indices);
+
+#endif /* _PLAYLIST_CHECKPOINT_H_ */
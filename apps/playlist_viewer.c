@@ -39,6 +39,7 @@
 #include "action.h"
 #include "debug.h"
 #include "backlight.h"
+#include "lru.h"
 
 #include "lang.h"
 
@@ -54,9 +55,9 @@
 /* Maximum number of tracks we can have loaded at one time */
 #define MAX_PLAYLIST_ENTRIES 200
 
-/* The number of items between the selected one and the end/start of
- * the buffer under which the buffer must reload */
-#define MIN_BUFFER_MARGIN (screens[0].getnblines()+1)
+/* Number of tracks loaded around the selected one between two checks for
+ * a button press */
+#define PREFETCH_BATCH 4
 
 /* Information about a specific track */
 struct playlist_entry {
@@ -67,27 +68,24 @@ struct playlist_entry {
     bool skipped;               /* Is track marked as bad?                  */
 };
 
-enum direction
-{
-    FORWARD,
-    BACKWARD
+/* A loaded track in the cache */
+struct playlist_slot {
+    int track;                  /* Viewer-relative index, -1 if unused      */
+    struct playlist_entry entry;
+    char name[MAX_PATH];
 };
 
+/* Tracks are loaded one by one into a small LRU cache.  The ones around the
+   selected track are loaded ahead between button presses, so the rows that
+   get drawn are usually in the cache already. */
 struct playlist_buffer
 {
-    char *name_buffer;        /* Buffer used to store track names */
-    int buffer_size;          /* Size of name buffer */
-
-    int first_index;          /* Real index of first track loaded inside
-                                 the buffer */
-
-    enum direction direction; /* Direction of the buffer (if the buffer
-                                 was loaded BACKWARD, the last track in
-                                 the buffer has a real index < to the
-                                 real index of the the first track)*/
-
-    struct playlist_entry tracks[MAX_PLAYLIST_ENTRIES];
-    int num_loaded;           /* Number of track entries loaded in buffer */
+    struct lru lru;           /* Slots, least recently used first */
+    short *index;             /* Handles of the used slots sorted by track */
+    int num_slots;            /* Number of slots in the cache */
+    int num_loaded;           /* Number of used slots */
+    int prefetch;             /* Distance from the selected track up to
+                                 which the tracks have been loaded */
 };
 
 /* Global playlist viewer settings */
@@ -108,10 +106,9 @@ static struct playlist_viewer  viewer;
 /* Used when viewing playlists on disk */
 static struct playlist_info temp_playlist;
 
-static void playlist_buffer_init(struct playlist_buffer *pb, char *names_buffer,
-                                 int names_buffer_size);
-static void playlist_buffer_load_entries(struct playlist_buffer * pb, int index,
-                                         enum direction direction);
+static bool playlist_buffer_init(struct playlist_buffer *pb, char *buffer,
+                                 size_t buffer_size);
+static void playlist_buffer_flush(struct playlist_buffer *pb);
 static int playlist_entry_load(struct playlist_entry *entry, int index,
                                char* name_buffer, int remaining_size);
 
@@ -128,80 +125,78 @@ static void format_line(const struct playlist_entry* track, char* str,
 static bool update_playlist(bool force);
 static int  onplay_menu(int index);
 
-static void playlist_buffer_init(struct playlist_buffer *pb, char *names_buffer,
-                                 int names_buffer_size)
+static void playlist_slot_init(void *data)
 {
-    pb->name_buffer = names_buffer;
-    pb->buffer_size = names_buffer_size;
-    pb->first_index = 0;
-    pb->num_loaded = 0;
+    ((struct playlist_slot *)data)->track = -1;
 }
 
 /*
- * Loads the entries following 'index' in the playlist buffer
+ * Splits the buffer into the index and the slots.  Returns false if not even
+ * one track fits.
  */
-static void playlist_buffer_load_entries(struct playlist_buffer *pb, int index,
-                                         enum direction direction)
+static bool playlist_buffer_init(struct playlist_buffer *pb, char *buffer,
+                                 size_t buffer_size)
 {
-    int num_entries = viewer.num_tracks;
-    char* p = pb->name_buffer;
-    int remaining = pb->buffer_size;
-    int i;
-
-    pb->first_index = index;
-    if (num_entries > MAX_PLAYLIST_ENTRIES)
-        num_entries = MAX_PLAYLIST_ENTRIES;
+    /* lru_data() is LRU_SLOT_OVERHEAD into a slot, so the slots are padded
+       and placed to keep the name pointers in them aligned */
+    size_t data_size = ALIGN_UP(LRU_SLOT_OVERHEAD +
+                                sizeof(struct playlist_slot),
+                                sizeof(void *)) - LRU_SLOT_OVERHEAD;
+    size_t slot_size = sizeof(short) + LRU_SLOT_OVERHEAD + data_size;
+    uintptr_t slots;
+
+    /* leave room for aligning the index and the slots after it */
+    if (buffer_size < sizeof(void *) + slot_size)
+        return false;
 
-    for (i = 0; i < num_entries; i++)
-    {
-        int len = playlist_entry_load(&(pb->tracks[i]), index, p, remaining);
-        if (len < 0)
-        {
-            /* Out of name buffer space */
-            num_entries = i;
-            break;
-        }
+    pb->num_slots = MIN((buffer_size - sizeof(void *)) / slot_size,
+                        MAX_PLAYLIST_ENTRIES);
+    pb->index = (short *)ALIGN_UP((uintptr_t)buffer, sizeof(short));
+    slots = ALIGN_UP((uintptr_t)pb->index + pb->num_slots * sizeof(short) +
+                     LRU_SLOT_OVERHEAD, sizeof(void *)) - LRU_SLOT_OVERHEAD;
 
-        p += len;
-        remaining -= len;
+    lru_create(&pb->lru, (void *)slots, pb->num_slots, data_size);
+    playlist_buffer_flush(pb);
+    return true;
+}
 
-        if(direction == FORWARD)
-            index++;
-        else
-            index--;
-        index += viewer.num_tracks;
-        index %= viewer.num_tracks;
-    }
-    pb->direction = direction;
-    pb->num_loaded = i;
+/* Forget all loaded tracks */
+static void playlist_buffer_flush(struct playlist_buffer *pb)
+{
+    lru_traverse(&pb->lru, playlist_slot_init);
+    pb->num_loaded = 0;
+    pb->prefetch = 0;
 }
 
-/* playlist_buffer_load_entries_screen()
- *      This function is called when the currently selected item gets too close
- *      to the start or the end of the loaded part of the playlis, or when
- *      the list callback requests a playlist item that has not been loaded yet
- *
- *      reference_track is either the currently selected track, or the track that
- *      has been requested by the callback, and has not been loaded yet.
+/*
+ * Finds the position of track in the sorted index.  Returns true if it is
+ * loaded, else pos is where it would go.
  */
-static void playlist_buffer_load_entries_screen(struct playlist_buffer * pb,
-                                                enum direction direction,
-                                                int reference_track)
+static bool playlist_buffer_find(struct playlist_buffer *pb, int track,
+                                 int *pos)
 {
-    if (direction == FORWARD)
-    {
-        int min_start = reference_track-2*screens[0].getnblines();
-        while (min_start < 0)
-            min_start += viewer.num_tracks;
-        min_start %= viewer.num_tracks;
-        playlist_buffer_load_entries(pb, min_start, FORWARD);
-    }
-    else
+    int low = 0;
+    int high = pb->num_loaded;
+
+    while (low < high)
     {
-        int max_start = reference_track+2*screens[0].getnblines();
-        max_start %= viewer.num_tracks;
-        playlist_buffer_load_entries(pb, max_start, BACKWARD);
+        int mid = (low + high) / 2;
+        struct playlist_slot *slot = lru_data(&pb->lru, pb->index[mid]);
+
+        if (slot->track == track)
+        {
+            *pos = mid;
+            return true;
+        }
+
+        if (slot->track < track)
+            low = mid + 1;
+        else
+            high = mid;
     }
+
+    *pos = low;
+    return false;
 }
 
 static int playlist_entry_load(struct playlist_entry *entry, int index,
@@ -233,75 +228,98 @@ static int playlist_entry_load(struct playlist_entry *entry, int index,
     return -1;
 }
 
-static int playlist_buffer_get_index(struct playlist_buffer *pb, int index)
+/*
+ * Returns the entry for a track, loading it into the least recently used
+ * slot if it isn't loaded yet.
+ */
+static struct playlist_entry * playlist_buffer_get_track(struct playlist_buffer *pb,
+                                                         int index)
 {
-    int buffer_index;
-    if (pb->direction == FORWARD)
+    struct playlist_slot *slot;
+    short handle;
+    int pos;
+
+    if (playlist_buffer_find(pb, index, &pos))
     {
-        if (index >= pb->first_index)
-            buffer_index = index-pb->first_index;
-        else /* rotation : track0 in buffer + requested track */
-            buffer_index = viewer.num_tracks-pb->first_index+index;
+        handle = pb->index[pos];
+        lru_touch(&pb->lru, handle);
+        return &((struct playlist_slot *)lru_data(&pb->lru, handle))->entry;
     }
-    else
+
+    handle = pb->lru._head;
+    slot = lru_data(&pb->lru, handle);
+
+    if (slot->track >= 0)
+    {
+        /* evict the track this slot holds */
+        int old;
+        playlist_buffer_find(pb, slot->track, &old);
+        memmove(&pb->index[old], &pb->index[old + 1],
+                (pb->num_loaded - old - 1) * sizeof(short));
+        pb->num_loaded--;
+        if (old < pos)
+            pos--;
+        slot->track = -1;
+    }
+
+    lru_touch(&pb->lru, handle);
+
+    if (playlist_entry_load(&slot->entry, index, slot->name,
+                            sizeof(slot->name)) < 0)
     {
-        if (index <= pb->first_index)
-            buffer_index = pb->first_index-index;
-        else /* rotation : track0 in buffer + dist from the last track
-                to the requested track (num_tracks-requested track) */
-            buffer_index = pb->first_index+viewer.num_tracks-index;
+        /* show an empty row and try again next time */
+        slot->name[0] = '\0';
+        slot->entry.name = slot->name;
+        slot->entry.index = -1;
+        slot->entry.display_index = index + 1;
+        slot->entry.queued = false;
+        slot->entry.skipped = false;
+        return &slot->entry;
     }
-    return buffer_index;
+
+    slot->track = index;
+    memmove(&pb->index[pos + 1], &pb->index[pos],
+            (pb->num_loaded - pos) * sizeof(short));
+    pb->index[pos] = handle;
+    pb->num_loaded++;
+    return &slot->entry;
 }
 
-#define distance(a, b) \
-    a>b? (a) - (b) : (b) - (a)
-static bool playlist_buffer_needs_reload(struct playlist_buffer* pb,
-                                         int track_index)
+/*
+ * Loads a few of the tracks around the selected one that aren't loaded yet,
+ * nearest first.  Returns false once all of them are loaded.
+ */
+static bool playlist_buffer_prefetch(struct playlist_buffer *pb, int selected)
 {
-    if (pb->num_loaded == viewer.num_tracks)
+    int window = MIN((pb->num_slots - 1) / 2, viewer.num_tracks / 2);
+    int loads = 0;
+    int pos;
+
+    if (viewer.num_tracks <= 0)
         return false;
-    int selected_index = playlist_buffer_get_index(pb, track_index);
-    int first_buffer_index = playlist_buffer_get_index(pb, pb->first_index);
-    int distance_beginning = distance(selected_index, first_buffer_index);
-    if (distance_beginning < MIN_BUFFER_MARGIN)
-        return true;
-
-    if (pb->num_loaded - distance_beginning < MIN_BUFFER_MARGIN)
-       return true;
-    return false;
-}
 
-static struct playlist_entry * playlist_buffer_get_track(struct playlist_buffer *pb,
-                                                         int index)
-{
-    int buffer_index = playlist_buffer_get_index(pb, index);
-    /* Make sure that we are not returning an invalid pointer.
-       In some cases, when scrolling really fast, it could happen that a reqested track
-       has not been pre-loaded */
-    if (buffer_index < 0) {
-        playlist_buffer_load_entries_screen(&viewer.buffer,
-                    pb->direction == FORWARD ? BACKWARD : FORWARD,
-                    index);
-
-    } else if (buffer_index >= pb->num_loaded) {
-        playlist_buffer_load_entries_screen(&viewer.buffer,
-                    pb->direction,
-                    index);
-    }
-    buffer_index = playlist_buffer_get_index(pb, index);
-    if (buffer_index < 0 || buffer_index >= pb->num_loaded) {
-        /* This really shouldn't happen. If this happens, then
-           the name_buffer is probably too small to store enough
-           titles to fill the screen, and preload data in the short
-           direction.
-          
-           If this happens then scrolling performance will probably
-           be quite low, but it's better then having Data Abort errors */
-        playlist_buffer_load_entries(pb, index, FORWARD);
-        buffer_index = playlist_buffer_get_index(pb, index);
+    while (pb->prefetch <= window)
+    {
+        int track = (selected + pb->prefetch) % viewer.num_tracks;
+
+        /* the tracks of the window are touched too, so they are the most
+           recently used ones and the window doesn't evict itself */
+        if (!playlist_buffer_find(pb, track, &pos))
+            loads++;
+        playlist_buffer_get_track(pb, track);
+
+        track = (selected - pb->prefetch + viewer.num_tracks) %
+                viewer.num_tracks;
+        if (!playlist_buffer_find(pb, track, &pos))
+            loads++;
+        playlist_buffer_get_track(pb, track);
+
+        pb->prefetch++;
+        if (loads >= PREFETCH_BATCH)
+            return pb->prefetch <= window;
     }
-    return &(pb->tracks[buffer_index]);
+
+    return false;
 }
 
 /* Initialize the playlist viewer. */
@@ -378,7 +396,8 @@ static bool playlist_viewer_init(struct playlist_viewer * viewer,
         buffer += index_buffer_size;
         buffer_size -= index_buffer_size;
     }
-    playlist_buffer_init(&viewer->buffer, buffer, buffer_size);
+    if (!playlist_buffer_init(&viewer->buffer, buffer, buffer_size))
+        return false;
 
     viewer->moving_track = -1;
     viewer->moving_playlist_index = -1;
@@ -461,8 +480,8 @@ static bool update_playlist(bool force)
             global_status.resume_elapsed = -1;
             return false;
         }
-        playlist_buffer_load_entries_screen(&viewer.buffer, FORWARD,
-                          viewer.selected_track);
+        playlist_buffer_flush(&viewer.buffer);
+        playlist_buffer_get_track(&viewer.buffer, viewer.selected_track);
         if (viewer.buffer.num_loaded <= 0)
         {
             global_status.resume_index = -1;
@@ -672,6 +691,8 @@ enum playlist_viewer_result playlist_viewer_ex(const char* filename)
     bool exit = false;        /* exit viewer */
     int button;
     bool dirty = false;
+    int streamed = -1;        /* tracks added by a streaming insertion */
+    static char title[32];
     struct gui_synclist playlist_lists;
     if (!playlist_viewer_init(&viewer, filename, false))
         goto exit;
@@ -699,6 +720,22 @@ enum playlist_viewer_result playlist_viewer_ex(const char* filename)
         else
             track = -1;
 
+        /* show the progress of a directory still being added */
+        if (!viewer.playlist && playlist_stream_count() != streamed)
+        {
+            streamed = playlist_stream_count();
+            if (streamed >= 0)
+            {
+                snprintf(title, sizeof(title), "%s (%d)", str(LANG_PLAYLIST),
+                         streamed);
+                gui_synclist_set_title(&playlist_lists, title, Icon_Playlist);
+            }
+            else
+                gui_synclist_set_title(&playlist_lists, str(LANG_PLAYLIST),
+                                       Icon_Playlist);
+            gui_synclist_draw(&playlist_lists);
+        }
+
         if (track != viewer.current_playing_track ||
             playlist_amount_ex(viewer.playlist) != viewer.num_tracks)
         {
@@ -714,8 +751,13 @@ enum playlist_viewer_result playlist_viewer_ex(const char* filename)
             gui_synclist_speak_item(&playlist_lists);
         }
 
-        /* Timeout so we can determine if play status has changed */
-        bool res = list_do_action(CONTEXT_TREE, HZ/2,
+        /* Load the tracks around the selected one between button presses,
+           only wait for the next one once they're all in.  Timeout so we
+           can determine if play status has changed */
+        bool prefetching = playlist_buffer_prefetch(&viewer.buffer,
+                                                    viewer.selected_track);
+        bool res = list_do_action(CONTEXT_TREE,
+                            prefetching ? TIMEOUT_NOBLOCK : HZ/2,
                             &playlist_lists, &button, LIST_WRAP_UNLESS_HELD);
         /* during moving, another redraw is going to be needed,
          * since viewer.selected_track is updated too late (after the first draw)
@@ -723,13 +765,9 @@ enum playlist_viewer_result playlist_viewer_ex(const char* filename)
         viewer.selected_track=gui_synclist_get_sel_pos(&playlist_lists);
         if (res)
         {
-            bool reload = playlist_buffer_needs_reload(&viewer.buffer,
-                    viewer.selected_track);
-            if (reload)
-                playlist_buffer_load_entries_screen(&viewer.buffer,
-                    button == ACTION_STD_NEXT ? FORWARD : BACKWARD,
-                    viewer.selected_track);
-            if (reload || viewer.moving_track >= 0)
+            /* start over around the new selection */
+            viewer.buffer.prefetch = 0;
+            if (viewer.moving_track >= 0)
                 gui_synclist_draw(&playlist_lists);
         }
         switch (button)
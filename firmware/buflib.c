@@ -97,6 +97,21 @@
 
 #define BPANICF panicf
 
+/* Allocation tracing. Every operation on a context is logged as one line
+ * which can be fed to the replay tool in firmware/test/buflib to
+ * benchmark the allocator against a real workload. trace_in_callback is
+ * non-zero while buflib calls into a shrink callback so that the replay can
+ * tell requested operations from those buflib asked for */
+#ifdef BUFLIB_TRACE
+    #include <stdio.h>
+    #define BTRACEF(fmt, ...) \
+        debugf("buflib_trace: %d " fmt "\n", trace_in_callback, __VA_ARGS__)
+static int trace_in_callback;
+static bool trace_in_max;
+#else
+    #define BTRACEF(...) do { } while(0)
+#endif
+
 #define IS_MOVABLE(a) (!a[2].ops || a[2].ops->move_callback)
 static union buflib_data* find_first_free(struct buflib_context *ctx);
 static union buflib_data* find_block_before(struct buflib_context *ctx,
@@ -109,6 +124,7 @@ buflib_init(struct buflib_context *ctx, void *buf, size_t size)
     union buflib_data *bd_buf = buf;
     BDEBUGF("buflib initialized with %lu.%02lu kiB\n",
             (unsigned long)size / 1024, ((unsigned long)size%1000)/10);
+    BTRACEF("init %p %lu", (void *)ctx, (unsigned long)size);
 
     /* Align on sizeof(buflib_data), to prevent unaligned access */
     ALIGN_BUFFER(bd_buf, size, sizeof(union buflib_data));
@@ -287,6 +303,8 @@ move_block(struct buflib_context* ctx, union buflib_data* block, int shift)
         tmp->alloc = new_start; /* update handle table */
         memmove(new_block, block, block->val * sizeof(union buflib_data));
         retval = true;
+        BTRACEF("move %p %d %ld", (void *)ctx, handle,
+                (long)(new_block->val * sizeof(union buflib_data)));
     }
 
     if (ops && ops->sync_callback)
@@ -418,8 +436,14 @@ buflib_compact_and_shrink(struct buflib_context *ctx, unsigned shrink_hints)
                     wanted -= free_space;
                     shrink_hints = pos_hints | wanted;
                 }
+#ifdef BUFLIB_TRACE
+                trace_in_callback++;
+#endif
                 ret = this[2].ops->shrink_callback(handle, shrink_hints,
                                             data, (char*)(this+this->val)-data);
+#ifdef BUFLIB_TRACE
+                trace_in_callback--;
+#endif
                 result |= (ret == BUFLIB_CB_OK);
                 /* 'this' might have changed in the callback (if it shrinked
                  * from the top or even freed the handle), get it again */
@@ -477,6 +501,7 @@ buflib_buffer_out(struct buflib_context *ctx, size_t *size)
     *size = avail_b;
     void *ret = ctx->buf_start;
     buflib_buffer_shift(ctx, avail);
+    BTRACEF("out %p %lu", (void *)ctx, (unsigned long)avail_b);
     return ret;
 }
 
@@ -484,6 +509,7 @@ buflib_buffer_out(struct buflib_context *ctx, size_t *size)
 void
 buflib_buffer_in(struct buflib_context *ctx, int size)
 {
+    BTRACEF("in %p %d", (void *)ctx, size);
     size /= sizeof(union buflib_data);
     buflib_buffer_shift(ctx, -size);
 }
@@ -517,6 +543,13 @@ buflib_alloc_ex(struct buflib_context *ctx, size_t size, const char *name,
     bool last;
     /* This really is assigned a value before use */
     int block_len;
+#ifdef BUFLIB_TRACE
+    size_t trace_size = size;
+    char trace_flags[3] = {
+        (!ops || ops->move_callback) ? 'm' : '-',
+        (ops && ops->shrink_callback) ? 's' : '-',
+        '\0' };
+#endif
     size += name_len;
     size = (size + sizeof(union buflib_data) - 1) /
            sizeof(union buflib_data)
@@ -549,6 +582,11 @@ handle_alloc:
          * if possible */
         if (buflib_compact_and_shrink(ctx, hints))
             goto handle_alloc;
+#ifdef BUFLIB_TRACE
+        if (!trace_in_max)
+            BTRACEF("alloc %p %d %lu %s %s", (void *)ctx, -1,
+                    (unsigned long)trace_size, trace_flags, name ?: "");
+#endif
         return -1;
     }
 
@@ -594,6 +632,11 @@ buffer_alloc:
         } else {
             handle->val=1;
             handle_free(ctx, handle);
+#ifdef BUFLIB_TRACE
+            if (!trace_in_max)
+                BTRACEF("alloc %p %d %lu %s %s", (void *)ctx, -2,
+                        (unsigned long)trace_size, trace_flags, name ?: "");
+#endif
             return -2;
         }
     }
@@ -626,6 +669,12 @@ buffer_alloc:
     /* Only free blocks *before* alloc_end have tagged length. */
     else if ((size_t)block_len > size)
         block->val = size - block_len;
+#ifdef BUFLIB_TRACE
+    if (!trace_in_max)
+        BTRACEF("alloc %p %d %lu %s %s", (void *)ctx,
+                (int)(ctx->handle_table - handle), (unsigned long)trace_size,
+                trace_flags, name ?: "");
+#endif
     /* Return the handle index as a positive integer. */
     return ctx->handle_table - handle;
 }
@@ -709,6 +758,7 @@ buflib_free(struct buflib_context *ctx, int handle_num)
     }
     handle_free(ctx, handle);
     handle->alloc = NULL;
+    BTRACEF("free %p %d", (void *)ctx, handle_num);
 
     return 0; /* unconditionally */
 }
@@ -819,11 +869,24 @@ buflib_alloc_maximum(struct buflib_context* ctx, const char* name, size_t *size,
 
     *size = buflib_allocatable(ctx);
     if (*size <= 0) /* OOM */
+    {
+        BTRACEF("max %p %d %lu %s %s", (void *)ctx, -1, 0ul, "--", name);
         return -1;
+    }
 
     strlcpy(buf, name, sizeof(buf));
 
+#ifdef BUFLIB_TRACE
+    trace_in_max = true;
+    int handle = buflib_alloc_ex(ctx, *size, buf, ops);
+    trace_in_max = false;
+    BTRACEF("max %p %d %lu %c%c %s", (void *)ctx, handle, (unsigned long)*size,
+            (!ops || ops->move_callback) ? 'm' : '-',
+            (ops && ops->shrink_callback) ? 's' : '-', buf);
+    return handle;
+#else
     return buflib_alloc_ex(ctx, *size, buf, ops);
+#endif
 }
 
 /* Shrink the allocation indicated by the handle according to new_start and
@@ -855,6 +918,9 @@ buflib_shrink(struct buflib_context* ctx, int handle, void* new_start, size_t ne
     if (new_next_block > old_next_block)
         return false;
 
+    BTRACEF("shrink %p %d %ld %lu", (void *)ctx, handle,
+            (long)(newstart - oldstart), (unsigned long)new_size);
+
     metadata_size.val = aligned_oldstart - block;
     /* update val and the handle table entry */
     new_block = aligned_newstart - metadata_size.val;
@@ -49,7 +49,8 @@
  * r - reserved buffer
  * d - name buffer for the name entry of the struct dircache_entry
  * 0 - zero bytes to assist free name block sentinel scanning (not 0xfe or 0xff)
- * |xxxxxx|rrrrrrrrr|0|dddddd|0|
+ * h - name hash bucket heads (DIRCACHE_NAMEHASH), aligned, fixed size
+ * |xxxxxx|rrrrrrrrr|0|dddddd|0|hhh|
  *
  * Subsequent x are allocated from the front, d are allocated from the back,
  * using the reserve buffer for entries added after initial scan.
@@ -90,6 +91,12 @@
  *
  * r0->r1->r2->q0->q1->q2->NULL
  * ^resolved0  ^queued0
+ *
+ * Name hash:
+ * With DIRCACHE_NAMEHASH, every entry linked into a directory is also on a
+ * chain hanging off the bucket for the hash of its parent index and its name
+ * with ASCII case folded, as FAT compares names. Path lookups then only
+ * compare the few entries on that chain instead of the whole directory.
  */
 
 #ifdef DIRCACHE_NATIVE
@@ -103,6 +110,7 @@ struct sab
     struct filestr_base   stream;    /* scan directory stream */
     struct file_base_info info;      /* scanned entry info */
     bool volatile         quit;      /* halt all scanning */
+    bool                  issab;     /* build scan; release control */
     struct sab_component  *stackend; /* end of stack pointer */
     struct sab_component  *top;      /* current top of stack */
     struct sab_component
@@ -185,6 +193,9 @@ struct dircache_entry
     uint32_t    tinyname     :  1; /* if == 1, name fits in .namebuf */
     uint32_t    frontier     :  2; /* (FRONTIER_* bitflags) */
     uint32_t    attr         :  8; /* entry file attributes */
+#ifdef DIRCACHE_NAMEHASH
+    int         hashnext;          /* next in name hash bucket */
+#endif
 #ifdef DIRCACHE_NATIVE
     long        firstcluster;      /* first file cluster - max 0x0ffffff4 */
     uint16_t    wrtdate;           /* FAT write date */
@@ -220,6 +231,9 @@ static struct dircache
     size_t       sizenames;           /* size of all names (including holes) */
     size_t       namesfree;           /* amount of wasted name space */
     int          nextnamefree;        /* hint of next free name in buffer */
+#ifdef DIRCACHE_NAMEHASH
+    unsigned int isonames;            /* entries only findable by scanning */
+#endif
     /* per-volume data */
     struct dircache_volume            /* per volume cache data */
     {
@@ -249,6 +263,9 @@ static struct dircache_runinfo
     /* cache buffer info */
     int          handle;           /* buflib buffer handle */
     size_t       bufsize;          /* size of buflib allocation - 1 */
+#ifdef DIRCACHE_NAMEHASH
+    unsigned int hashmask;         /* number of name hash buckets - 1 */
+#endif
     int          buflocked;        /* don't move due to other allocs */
     union {
     void                  *p;      /* address of buffer - ENTRYSIZE */
@@ -256,6 +273,10 @@ static struct dircache_runinfo
     unsigned char         *pname;  /* alias of .p to assist name resolution */
     };
     struct buflib_callbacks ops;   /* buflib ops callbacks */
+    /* build progress */
+    long         build_start;      /* tick when the last build began */
+    long         build_end;        /* tick when it ended (0 = ongoing) */
+    unsigned int build_entries;    /* entries it added */
     /* per-volume data */
     struct dircache_runinfo_volume
     {
@@ -494,13 +515,56 @@ static void binding_dissolve_volume(struct dircache_runinfo_volume *dcrivolp)
 
 /** Dircache buffer management **/
 
+#ifdef DIRCACHE_NAMEHASH
+/* bytes taken by the bucket heads at the end of the buffer */
+#define NAMEHASH_SIZE(hashmask) (((hashmask) + 1) * sizeof (int))
+
+/**
+ * return the bucket mask for a buffer of the given size; aims for a few
+ * entries per bucket when the buffer is full of entries
+ */
+static unsigned int namehash_mask(size_t size)
+{
+    unsigned int buckets = 16;
+
+    while (buckets * 4 * ENTRYSIZE < size)
+        buckets *= 2;
+
+    return buckets - 1;
+}
+
+/**
+ * return the array of bucket heads that follows the names
+ */
+static inline int * get_namehash_buckets(void)
+{
+    return dircache_runinfo.p + ENTRYSIZE +
+           ALIGN_UP(dircache_runinfo.bufsize + 1, sizeof (int));
+}
+
+/**
+ * empty all buckets
+ */
+static void namehash_clear(void)
+{
+    memset(get_namehash_buckets(), 0,
+           NAMEHASH_SIZE(dircache_runinfo.hashmask));
+}
+#endif /* DIRCACHE_NAMEHASH */
+
 /**
  * allocate the cache's memory block
  */
 static int alloc_cache(size_t size)
 {
     /* pad with one extra-- see alloc_name() and free_name() */
-    return core_alloc_ex("dircache", size + 1, &dircache_runinfo.ops);
+    size_t allocsize = size + 1;
+#ifdef DIRCACHE_NAMEHASH
+    /* bucket heads go after it all */
+    allocsize = ALIGN_UP(allocsize, sizeof (int)) +
+                NAMEHASH_SIZE(namehash_mask(size));
+#endif
+    return core_alloc_ex("dircache", allocsize, &dircache_runinfo.ops);
 }
 
 /**
@@ -525,6 +589,10 @@ static void set_buffer(int handle, size_t size)
         dircache.names = size + ENTRYSIZE;
         dircache_runinfo.pname[dircache.names - 1] = 0;
         dircache_runinfo.pname[dircache.names    ] = 0;
+    #ifdef DIRCACHE_NAMEHASH
+        dircache_runinfo.hashmask = namehash_mask(size);
+        namehash_clear();
+    #endif
     }
 }
 
@@ -758,6 +826,129 @@ static void entry_name_copy(char *dst, const struct dircache_entry *ce)
     *dst = '\0';
 }
 
+#ifdef DIRCACHE_NAMEHASH
+/**
+ * hash a name under the given parent index; FNV-1a with ASCII case folded
+ * since that is how FAT compares names
+ */
+static unsigned int namehash_calc(int up, const unsigned char *name,
+                                  size_t len)
+{
+    uint32_t hash = (2166136261u ^ (uint32_t)up) * 16777619u;
+
+    while (len--)
+    {
+        unsigned int c = *name++;
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+
+        hash = (hash ^ c) * 16777619u;
+    }
+
+    return hash & dircache_runinfo.hashmask;
+}
+
+/**
+ * return the entry's name storage and its length
+ */
+static const unsigned char * entry_name_ref(const struct dircache_entry *ce,
+                                            size_t *lenp)
+{
+    if (LIKELY(!ce->tinyname))
+    {
+        *lenp = CE_NAMESIZE(ce->namelen);
+        return get_name(ce->name);
+    }
+
+    size_t len = 0;
+    while (len < MAX_TINYNAME && ce->namebuf[len])
+        len++;
+
+    *lenp = len;
+    return ce->namebuf;
+}
+
+/**
+ * does the file code decode this entry's name before comparing it? (short
+ * name only and not plain ASCII)
+ */
+static bool entry_is_isoname(const struct dircache_entry *ce)
+{
+    if (ce->direntries != 1)
+        return false;
+
+    size_t len;
+    const unsigned char *name = entry_name_ref(ce, &len);
+
+    while (len--)
+    {
+        if (*name++ >= 0x80)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * return the bucket head for the entry's parent and name
+ */
+static int * namehash_headp(const struct dircache_entry *ce)
+{
+    size_t len;
+    const unsigned char *name = entry_name_ref(ce, &len);
+    return &get_namehash_buckets()[namehash_calc(ce->up, name, len)];
+}
+
+/**
+ * add a linked-in entry to the hash; its name and parent must be final
+ */
+static void namehash_insert(struct dircache_entry *ce)
+{
+    int *headp = namehash_headp(ce);
+    ce->hashnext = *headp;
+    *headp = get_index(ce);
+
+    if (entry_is_isoname(ce))
+        dircache.isonames++;
+}
+
+/**
+ * remove an entry from the hash if it is there
+ */
+static void namehash_remove(struct dircache_entry *ce)
+{
+    int idx = get_index(ce);
+
+    for (int *p = namehash_headp(ce); *p; p = &get_entry(*p)->hashnext)
+    {
+        if (*p == idx)
+        {
+            *p = ce->hashnext;
+
+            if (entry_is_isoname(ce))
+                dircache.isonames--;
+
+            break;
+        }
+    }
+}
+
+/**
+ * rebuild the hash from the entries, eg. after loading
+ */
+static void namehash_rebuild(void)
+{
+    namehash_clear();
+    dircache.isonames = 0;
+
+    FOR_EACH_CACHE_ENTRY(ce)
+    {
+        if (ce->up)
+            namehash_insert(ce);
+    }
+}
+#endif /* DIRCACHE_NAMEHASH */
+
 /**
  * set the namesfree hint to a new position
  */
@@ -1072,6 +1263,10 @@ static void remove_entry(struct dircache_runinfo_volume *dcrivolp,
     /* unlink it from its list */
     *prevp = ce->next;
 
+#ifdef DIRCACHE_NAMEHASH
+    namehash_remove(ce);
+#endif
+
     if (dcrivolp)
     {
         /* adjust scanner iterator if needed */
@@ -1279,7 +1474,7 @@ static void sab_process_sub(struct sab *sabp)
         /* first pass: read directory */
         while (1)
         {
-            if (sabp->stack + 1 < sabp->stackend)
+            if (sabp->issab)
             {
                 /* release control and process queued events */
                 dircache_unlock();
@@ -1334,6 +1529,8 @@ static void sab_process_sub(struct sab *sabp)
                 break;
             }
 
+            dircache_runinfo.build_entries++;
+
             /* link it in */
             ce->up = compp->idx;
             ce->next = prev;
@@ -1353,6 +1550,10 @@ static void sab_process_sub(struct sab *sabp)
             ce->wrtdate      = fatentp->wrtdate;
             ce->wrttime      = fatentp->wrttime;
 
+        #ifdef DIRCACHE_NAMEHASH
+            namehash_insert(ce);
+        #endif
+
             /* resolve queued user bindings */
             infop->fatfile.firstcluster = fatentp->firstcluster;
             infop->fatfile.dircluster   = dircluster;
@@ -1410,7 +1611,7 @@ static void sab_process_sub(struct sab *sabp)
 /**
  * scan and build the contents of a directory or volume root
  */
-static void sab_process_dir(struct file_base_info *infop, bool issab)
+static bool sab_process_dir(struct file_base_info *infop, bool issab)
 {
     /* infop should have been fully opened meaning that all its parent
        directory information is filled in and intact; the binding information
@@ -1420,11 +1621,16 @@ static void sab_process_dir(struct file_base_info *infop, bool issab)
     struct dirsab
     {
         struct sab           sab;
+#ifdef DIRCACHE_BREADTHFIRST
+        struct sab_component stack[1]; /* see sab_process_levels() */
+#else
         struct sab_component stack[issab ? DIRCACHE_MAX_DEPTH : 1];
+#endif
     } dirsab;
     struct sab *sabp = &dirsab.sab;
 
     sabp->quit     = false;
+    sabp->issab    = issab;
     sabp->stackend = &sabp->stack[ARRAYLEN(dirsab.stack)];
     sabp->top      = sabp->stackend;
     sabp->info     = *infop;
@@ -1437,6 +1643,8 @@ static void sab_process_dir(struct file_base_info *infop, bool issab)
 
     if (issab)
         DCRIVOL(infop)->sabp = NULL;
+
+    return !sabp->quit;
 }
 
 /**
@@ -1468,6 +1676,117 @@ static void sab_process_volume(struct dircache_volume *dcvolp)
     sab_process_dir(&info, true);
 }
 
+#ifdef DIRCACHE_BREADTHFIRST
+/**
+ * return the volume of the given cache index
+ */
+static int get_idx_volume(int idx)
+{
+    while (idx > 0)
+        idx = get_entry(idx)->up;
+
+    return IF_MV_VOL(-idx - 1);
+}
+
+/**
+ * scan the directories left unscanned by sab_process_volume() and all that
+ * they turn up; entries are allocated in the order they are found, so
+ * walking the entry array visits the tree breadth-first, across all volumes
+ * being built at once; each batch is read in order of first cluster so the
+ * disk mostly moves one way
+ *
+ * entries recycled from the free list land behind the walk so it repeats
+ * until a pass finds nothing to scan
+ */
+static void sab_process_levels(void)
+{
+    struct
+    {
+        int         idx;
+        dc_serial_t serialnum;
+        long        firstcluster;
+    } batch[DIRCACHE_SCAN_BATCH];
+
+    int next = 1;
+    bool scanned = false;
+
+    while (!dircache_runinfo.suspended)
+    {
+        /* gather the next directories that need scanning */
+        int count = 0;
+
+        for (; count < DIRCACHE_SCAN_BATCH &&
+               next <= (int)dircache.numentries; next++)
+        {
+            struct dircache_entry *ce = get_entry(next);
+            if (!ce->serialnum || !(ce->attr & ATTR_DIRECTORY) ||
+                !(ce->frontier & FRONTIER_NEW))
+                continue; /* not a directory waiting to be scanned */
+
+            int volume = get_idx_volume(next);
+            if (DCVOL(volume)->status != DIRCACHE_SCANNING)
+                continue;
+
+            /* insertion sort by first cluster */
+            int i = count++;
+            for (; i > 0 && batch[i-1].firstcluster > ce->firstcluster; i--)
+                batch[i] = batch[i-1];
+
+            batch[i].idx          = next;
+            batch[i].serialnum    = ce->serialnum;
+            batch[i].firstcluster = ce->firstcluster;
+        }
+
+        if (!count)
+        {
+            if (!scanned)
+                break; /* nothing new turned up; done */
+
+            next = 1;
+            scanned = false;
+            continue;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            /* events processed during earlier scans could have removed or
+               replaced the entry */
+            struct dircache_entry *ce = get_entry(batch[i].idx);
+            if (ce->serialnum != batch[i].serialnum)
+                continue;
+
+            int volume = get_idx_volume(batch[i].idx);
+            struct dircache_volume *dcvolp = DCVOL(volume);
+            if (dcvolp->status != DIRCACHE_SCANNING)
+                continue;
+
+            struct file_base_info info;
+            if (fat_open_rootdir(IF_MV(volume,) &info.fatfile) < 0)
+                continue;
+
+            long dircluster = ce->up > 0 ?
+                get_entry(ce->up)->firstcluster : info.fatfile.firstcluster;
+
+            info.fatfile.firstcluster = ce->firstcluster;
+            info.fatfile.dircluster   = dircluster;
+            info.fatfile.e.entry      = ce->direntry;
+            info.fatfile.e.entries    = ce->direntries;
+            info.dcfile.idx           = batch[i].idx;
+            info.dcfile.serialnum     = ce->serialnum;
+
+            scanned = true;
+
+            if (!sab_process_dir(&info, true) &&
+                dcvolp->status == DIRCACHE_SCANNING)
+                return; /* out of space or I/O error, not a volume reset */
+
+            if (dircache_runinfo.suspended)
+                return;
+        }
+    }
+}
+#endif /* DIRCACHE_BREADTHFIRST */
+
 /**
  * this function is the back end to the public API's like readdir()
  */
@@ -1673,6 +1992,78 @@ void dircache_rewinddir_internal(struct file_base_info *infop)
     dircache_dcfile_init(&infop->dcfile);
 }
 
+#ifdef DIRCACHE_NAMEHASH
+/**
+ * find the named entry in the directory of the stream without scanning it;
+ * returns 1 if found with the results as dircache_readdir_internal() would
+ * give them, 0 if it certainly doesn't exist or < 0 if the caller has to
+ * scan the directory because the cache can't tell
+ */
+int dircache_lookup_internal(struct filestr_base *stream,
+                             struct file_base_info *infop,
+                             struct fat_direntry *fatent,
+                             const char *name, bool isodecode)
+{
+    /* call with writer exclusion */
+    struct file_base_info *dirinfop = stream->infop;
+
+    /* assume binding "not found" */
+    infop->dcfile.serialnum = 0;
+
+    /* is parent cached? */
+    if (!dirinfop->dcfile.serialnum)
+        return -1;
+
+    int diridx = dirinfop->dcfile.idx;
+    unsigned int hash = namehash_calc(diridx, (const unsigned char *)name,
+                                      strlen(name));
+    int idx = get_namehash_buckets()[hash];
+
+    while (idx)
+    {
+        struct dircache_entry *ce = get_entry(idx);
+
+        if (ce->up == diridx)
+        {
+            /* decoded names won't compare the same as they are stored */
+            if (!isodecode || !entry_is_isoname(ce))
+            {
+                entry_name_copy(fatent->name, ce);
+                if (!strcasecmp(name, fatent->name))
+                {
+                    /* same as dircache_readdir_internal() */
+                    fatent->shortname[0]     = '\0';
+                    fatent->attr             = ce->attr;
+                    fatent->filesize         = (ce->attr & ATTR_DIRECTORY) ?
+                                                    0 : ce->filesize;
+                    fatent->firstcluster     = ce->firstcluster;
+                    infop->fatfile.e.entry   = ce->direntry;
+                    infop->fatfile.e.entries = ce->direntries;
+                    infop->dcfile.idx        = idx;
+                    infop->dcfile.serialnum  = ce->serialnum;
+                    return 1;
+                }
+            }
+        }
+
+        idx = ce->hashnext;
+    }
+
+    /* a miss only counts if the directory is completely cached and no name
+       had to be skipped above */
+    unsigned int frontier = diridx < 0 ?
+        DCVOL(dirinfop)->frontier : get_entry(diridx)->frontier;
+
+    if ((frontier != FRONTIER_SETTLED && !(stream->flags & FF_CACHEONLY)) ||
+        (isodecode && dircache.isonames))
+        return -1;
+
+    fat_empty_fat_direntry(fatent);
+    infop->fatfile.e.entries = 0;
+    return 0;
+}
+#endif /* DIRCACHE_NAMEHASH */
+
 #else /* !DIRCACHE_NATIVE (for all others) */
 
 #####################
@@ -1847,6 +2238,10 @@ static void reset_cache(void)
     dircache.namesfree    = 0;
     dircache.nextnamefree = 0;
     *get_name(dircache.names - 1) = 0;
+#ifdef DIRCACHE_NAMEHASH
+    dircache.isonames     = 0;
+    namehash_clear();
+#endif
     /* dircache.last_serialnum stays */
     /* dircache.reserve_used stays */
     /* dircache.last_size stays */
@@ -1859,6 +2254,10 @@ static void build_volumes(void)
 {
     buffer_lock();
 
+    dircache_runinfo.build_start   = current_tick;
+    dircache_runinfo.build_end     = 0;
+    dircache_runinfo.build_entries = 0;
+
     for (int i = 0; i < NUM_VOLUMES; i++)
     {
         /* this does reader locking but we already own that */
@@ -1884,11 +2283,31 @@ static void build_volumes(void)
         if (dircache_runinfo.suspended)
             break;
 
+    #ifndef DIRCACHE_BREADTHFIRST
         /* whatever happened, it's ready unless reset */
         dcvolp->build_ticks = current_tick - dcvolp->start_tick;
         dcvolp->status = DIRCACHE_READY;
+    #endif
     }
 
+#ifdef DIRCACHE_BREADTHFIRST
+    /* only the roots are in; now the rest of every volume together */
+    sab_process_levels();
+
+    for (int i = 0; i < NUM_VOLUMES && !dircache_runinfo.suspended; i++)
+    {
+        struct dircache_volume *dcvolp = DCVOL(i);
+        if (dcvolp->status != DIRCACHE_SCANNING)
+            continue;
+
+        /* whatever happened, it's ready unless reset */
+        dcvolp->build_ticks = current_tick - dcvolp->start_tick;
+        dcvolp->status = DIRCACHE_READY;
+    }
+#endif /* DIRCACHE_BREADTHFIRST */
+
+    dircache_runinfo.build_end = current_tick;
+
     size_t reserve_used = reserve_buf_used();
     if (reserve_used > dircache.reserve_used)
         dircache.reserve_used = reserve_used;
@@ -2027,7 +2446,16 @@ static void compact_cache(void)
        but if it ever does that may very well cause deadlock problems since
        we're holding filesystem locks */
     size_t newsize = leadsize + dircache.sizenames + 1;
-    core_shrink(dircache_runinfo.handle, p, newsize + 1);
+    size_t allocsize = newsize + 1;
+#ifdef DIRCACHE_NAMEHASH
+    /* the bucket heads trail the names; bring them along */
+    int *oldbuckets = get_namehash_buckets();
+    allocsize = ALIGN_UP(allocsize, sizeof (int));
+    memmove(p + allocsize, oldbuckets,
+            NAMEHASH_SIZE(dircache_runinfo.hashmask));
+    allocsize += NAMEHASH_SIZE(dircache_runinfo.hashmask);
+#endif
+    core_shrink(dircache_runinfo.handle, p, allocsize);
     dircache_runinfo.bufsize = newsize;
     dircache.reserve_used = 0;
 }
@@ -2377,6 +2805,9 @@ void dircache_fileop_create(struct file_base_info *dirinfop,
         ce->filesize = dinp->size;
 
     insert_file_entry(dirinfop, ce);
+#ifdef DIRCACHE_NAMEHASH
+    namehash_insert(ce);
+#endif
 
     /* file binding will have been queued when it was opened; just resolve */
     infop->dcfile.idx       = idx;
@@ -2459,6 +2890,10 @@ void dircache_fileop_rename(struct file_base_info *dirinfop,
         dc_serial_t serialnum = next_serialnum();
         ce->serialnum = serialnum;
         bindp->info.dcfile.serialnum = serialnum;
+    #ifdef DIRCACHE_NAMEHASH
+        /* out of the hash since remove_file_entry(); the name is final */
+        namehash_insert(ce);
+    #endif
     }
     else
     {
@@ -2876,6 +3311,20 @@ void dircache_get_info(struct dircache_info *info)
 
     info->status     = status;
     info->statusdesc = status_descriptions[status];
+
+    /* progress is measured against the size of the last complete build */
+    if (status != DIRCACHE_SCANNING)
+        info->build_progress = status == DIRCACHE_READY ? 100 : 0;
+    else if (dircache.last_size)
+        info->build_progress = MIN(99, 100ull*dircache.size /
+                                       dircache.last_size);
+    else
+        info->build_progress = 0; /* no idea */
+
+    long ticks = (dircache_runinfo.build_end ? dircache_runinfo.build_end :
+                  current_tick) - dircache_runinfo.build_start;
+    info->build_rate = ticks > 0 ?
+        (unsigned long long)dircache_runinfo.build_entries * HZ / ticks : 0;
     info->last_size  = dircache.last_size;
     info->size_limit = DIRCACHE_LIMIT;
     info->reserve    = DIRCACHE_RESERVE;
@@ -3023,7 +3472,11 @@ void dircache_dcfile_init(struct dircache_file *dcfilep)
 #endif
 
 /* dircache persistence file header magic */
+#ifdef DIRCACHE_NAMEHASH
+#define DIRCACHE_MAGIC  0x00d0c0a2 /* entries carry the hash link */
+#else
 #define DIRCACHE_MAGIC  0x00d0c0a1
+#endif
 
 /* dircache persistence file header */
 struct dircache_maindata
@@ -3167,6 +3620,11 @@ int dircache_load(void)
 
     dircache.reserve_used = 0;
 
+#ifdef DIRCACHE_NAMEHASH
+    /* cheaper to rehash than to store the buckets */
+    namehash_rebuild();
+#endif
+
     /* enable the cache but do not try to build it */
     dircache_enable_internal(false);
 
@@ -18,6 +18,7 @@
  * KIND, either express or implied.
  *
  ****************************************************************************/
+#include <string.h>
 #include "config.h"
 #include "debug.h"
 #include "system.h"
@@ -87,6 +88,9 @@ static struct disk_cache_entry cache_entry[DC_NUM_ENTRIES];
 static cache_map_entry_t cache_map_entry[NUM_VOLUMES][DC_MAP_NUM_ENTRIES];
 static cache_map_entry_t cache_vol_map[NUM_VOLUMES] IBSS_ATTR;
 static uint8_t cache_buffer[DC_NUM_ENTRIES][DC_CACHE_BUFSIZE] CACHEALIGN_ATTR;
+static uint8_t cache_wb_buffer[DC_WRITEBACK_MAX][DC_CACHE_BUFSIZE]
+                              CACHEALIGN_ATTR;
+static struct dc_stats cache_stats;
 struct mutex disk_cache_mutex SHAREDBSS_ATTR;
 
 #define CACHE_MAP_ENTRY(volume, mapnum) \
@@ -169,6 +173,97 @@ static inline void cache_discard_entry(struct disk_cache_entry *dce,
     dce->flags = 0;
 }
 
+/* Writeback: rather than writing each dirty sector alone in whatever order
+ * entries get evicted, dirty entries are gathered and sorted by sector number
+ * so that runs of consecutive sectors go out with a single write and the
+ * rest at least in ascending order.
+ */
+
+/* gather the dirty entries of the volume with sectors in [first, last] into
+   'idx', sorted by sector number, and return how many there are */
+static unsigned int cache_gather_dirty(IF_MV(int volume,)
+                                       unsigned long first,
+                                       unsigned long last,
+                                       unsigned char idx[DC_NUM_ENTRIES])
+{
+    unsigned int count = 0;
+
+    FOR_EACH_BITARRAY_SET_BIT(&CACHE_VOL_MAP(volume), index)
+    {
+        struct disk_cache_entry *dce = &cache_entry[index];
+        unsigned long sector = dce->sector;
+
+        if (!(dce->flags & DCE_DIRTY) || sector < first || sector > last)
+            continue;
+
+        /* insertion sort; there are only a few dozen at most */
+        unsigned int i = count++;
+        for (; i > 0 && cache_entry[idx[i - 1]].sector > sector; i--)
+            idx[i] = idx[i - 1];
+
+        idx[i] = index;
+    }
+
+    return count;
+}
+
+/* write back the sorted entries, coalescing consecutive sectors */
+static void cache_writeback_sorted(IF_MV(int volume,)
+                                   const unsigned char *idx,
+                                   unsigned int count)
+{
+    for (unsigned int i = 0; i < count;)
+    {
+        unsigned int index = idx[i];
+        unsigned long sector = cache_entry[index].sector;
+        unsigned int n = 1;
+        bool adjacent = true; /* buffers already follow each other */
+
+        while (i + n < count && n < DC_WRITEBACK_MAX &&
+               cache_entry[idx[i + n]].sector == sector + n)
+        {
+            if (idx[i + n] != index + n)
+                adjacent = false;
+            n++;
+        }
+
+        void *buf = cache_buffer[index];
+
+        if (!adjacent)
+        {
+            for (unsigned int j = 0; j < n; j++)
+                memcpy(cache_wb_buffer[j], cache_buffer[idx[i + j]],
+                       DC_CACHE_BUFSIZE);
+
+            buf = cache_wb_buffer;
+        }
+
+        dc_writeback_callback(IF_MV(volume,) sector, n, buf);
+
+        for (unsigned int j = 0; j < n; j++)
+            cache_entry[idx[i + j]].flags &= ~DCE_DIRTY;
+
+        cache_stats.writebacks += n;
+        cache_stats.writes++;
+        i += n;
+    }
+}
+
+/* write back a dirty entry about to be evicted together with the dirty
+   sectors around it that can go out with it in the same writes */
+static void cache_writeback_entry(struct disk_cache_entry *dce)
+{
+    unsigned char idx[DC_NUM_ENTRIES];
+    unsigned long sector = dce->sector;
+    unsigned long first = sector >= DC_WRITEBACK_MAX - 1 ?
+                            sector - (DC_WRITEBACK_MAX - 1) : 0;
+    unsigned int count = cache_gather_dirty(IF_MV(dce->volume,) first,
+                                            sector + DC_WRITEBACK_MAX - 1,
+                                            idx);
+
+    cache_writeback_sorted(IF_MV(dce->volume,) idx, count);
+}
+
 /* search the cache for the specified sector, returning a buffer, either
    to the specified sector, if it exists, or a new/evicted entry that must
    be filled */
@@ -185,10 +280,13 @@ void * dc_cache_probe(IF_MV(int volume,) unsigned long sector,
         {
             *flagsp = DCE_INUSE;
             touch_cache_entry(dce);
+            cache_stats.hits++;
             return cache_buffer[index];
         }
     }
 
+    cache_stats.misses++;
+
     /* sector not found so the LRU is the victim */
     struct disk_cache_entry *dce = DCE_LRU();
     cache_lru.head = dce->node.next;
@@ -204,7 +302,7 @@ void * dc_cache_probe(IF_MV(int volume,) unsigned long sector,
         unsigned int old_mapnum = map_sector(sector);
 
         if (old_flags & DCE_DIRTY)
-            dc_writeback_callback(IF_MV(old_volume,) sector, buf);
+            cache_writeback_entry(dce);
 
         if (mapnum == old_mapnum IF_MV( && volume == old_volume ))
             goto finish_setup;
@@ -257,18 +355,9 @@ void dc_commit_all(IF_MV_NONVOID(int volume))
 {
     DEBUGF("dc_commit_all()\n");
 
-    FOR_EACH_BITARRAY_SET_BIT(&CACHE_VOL_MAP(volume), index)
-    {
-        struct disk_cache_entry *dce = &cache_entry[index];
-        unsigned int flags = dce->flags;
-
-        if (flags & DCE_DIRTY)
-        {
-            dc_writeback_callback(IF_MV(volume,) dce->sector,
-                                  cache_buffer[index]);
-            dce->flags = flags & ~DCE_DIRTY;
-        }
-    }
+    unsigned char idx[DC_NUM_ENTRIES];
+    unsigned int count = cache_gather_dirty(IF_MV(volume,) 0, ~0ul, idx);
+    cache_writeback_sorted(IF_MV(volume,) idx, count);
 }
 
 /* discard all cache entries from the specified volume */
@@ -299,7 +388,7 @@ void * dc_get_buffer(void)
         {
             /* must first commit this sector if dirty */
             if (flags & DCE_DIRTY)
-                dc_writeback_callback(IF_MV(dce->volume,) dce->sector, buf);
+                cache_writeback_entry(dce);
 
             cache_discard_entry(dce, index);
         }
@@ -333,6 +422,14 @@ void dc_release_buffer(void *buf)
     dc_unlock_cache();
 }
 
+/* copy the hit/miss/writeback counters */
+void dc_get_stats(struct dc_stats *stats)
+{
+    dc_lock_cache();
+    *stats = cache_stats;
+    dc_unlock_cache();
+}
+
 /* one-time init at startup */
 void dc_init(void)
 {
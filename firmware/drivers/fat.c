@@ -181,6 +181,12 @@ struct fsinfo
 #define FSINFO_FREECOUNT 488
 #define FSINFO_NEXTFREE  492
 
+/* bytes per volume for the map of FAT sector groups with no free cluster */
+#ifndef FAT_FREEMAP_SIZE
+#define FAT_FREEMAP_SIZE 128
+#endif
+#define FAT_FREEMAP_BITS (FAT_FREEMAP_SIZE*8)
+
 #ifdef HAVE_FAT16SUPPORT
 #define BPB_FN_SET16(bpb, fn)      (bpb)->fn##__ = fn##16
 #define BPB_FN_SET32(bpb, fn)      (bpb)->fn##__ = fn##32
@@ -253,6 +259,8 @@ static struct bpb
     uint8_t volume;   /* on which volume is this located (shortcut) */
 #endif
     uint8_t mounted;  /* true if volume is mounted, false otherwise */
+    uint8_t freemap_shift; /* log2 of FAT sectors per freemap bit */
+    uint8_t freemap[FAT_FREEMAP_SIZE]; /* set bit: group has no free cluster */
 #ifdef HAVE_FAT16SUPPORT
     /* some functions are different for different FAT types */
     long BPB_FN_DECL(get_next_cluster, long);
@@ -350,29 +358,50 @@ static void * cache_sector_buffer(IF_MV(struct bpb *fat_bpb,)
     return dc_cache_probe(IF_MV(fat_bpb->volume,) secnum, &flags);
 }
 
-/* flush a cache buffer to storage */
-void dc_writeback_callback(IF_MV(int volume,) unsigned long sector, void *buf)
+/* flush cache buffers to storage */
+void dc_writeback_callback(IF_MV(int volume,) unsigned long sector, int count,
+                           void *buf)
 {
     struct bpb * const fat_bpb = &fat_bpbs[IF_MV_VOL(volume)];
-    unsigned int copies = !IS_FAT_SECTOR(fat_bpb, sector) ?
-                                1 : fat_bpb->bpb_numfats;
-
-    sector += fat_bpb->startsector;
 
-    while (1)
+    while (count > 0)
     {
-        int rc = storage_write_sectors(IF_MD(fat_bpb->drive,) sector, 1, buf);
-        if (rc < 0)
+        /* FAT sectors go to every copy of the FAT so split the run where it
+           enters or leaves the FAT */
+        unsigned long n = count;
+        unsigned int copies = 1;
+
+        if (IS_FAT_SECTOR(fat_bpb, sector))
         {
-            panicf("%s() - Could not write sector %ld"
-                   " (error %d)\n", __func__, sector, rc);
+            n = MIN(n, fat_bpb->fatrgnend - sector);
+            copies = fat_bpb->bpb_numfats;
+        }
+        else if (sector < fat_bpb->fatrgnstart)
+        {
+            n = MIN(n, fat_bpb->fatrgnstart - sector);
         }
 
-        if (--copies == 0)
-            break;
+        unsigned long s = sector + fat_bpb->startsector;
 
-        /* Update next FAT */
-        sector += fat_bpb->fatsize;
+        while (1)
+        {
+            int rc = storage_write_sectors(IF_MD(fat_bpb->drive,) s, n, buf);
+            if (rc < 0)
+            {
+                panicf("%s() - Could not write sector %ld"
+                       " (error %d)\n", __func__, s, rc);
+            }
+
+            if (--copies == 0)
+                break;
+
+            /* Update next FAT */
+            s += fat_bpb->fatsize;
+        }
+
+        sector += n;
+        count  -= n;
+        buf     = (uint8_t *)buf + n*SECTOR_SIZE;
     }
 }
 
@@ -795,6 +824,54 @@ static unsigned long cluster2sec(struct bpb *fat_bpb, long cluster)
             + fat_bpb->firstdatasector;
 }
 
+/* Searching for a free cluster reads the FAT sector by sector from a hint
+ * onwards, which on a nearly full volume means scanning most of the FAT for
+ * every cluster allocated. The freemap has one bit per group of FAT sectors
+ * that gets set once a complete scan of the group found nothing free and is
+ * cleared again as soon as any cluster in it is freed, so later searches
+ * can step over whole groups without touching their sectors. */
+static void freemap_init(struct bpb *fat_bpb)
+{
+    unsigned int shift = 0;
+    while (fat_bpb->fatsize > (unsigned long)FAT_FREEMAP_BITS << shift)
+        shift++;
+
+    fat_bpb->freemap_shift = shift;
+    memset(fat_bpb->freemap, 0, sizeof (fat_bpb->freemap));
+}
+
+static inline bool freemap_is_full(struct bpb *fat_bpb, unsigned long sector)
+{
+    unsigned long bit = sector >> fat_bpb->freemap_shift;
+    return fat_bpb->freemap[bit / 8] & (1 << (bit % 8));
+}
+
+static inline void freemap_set_full(struct bpb *fat_bpb, unsigned long sector,
+                                    bool full)
+{
+    unsigned long bit = sector >> fat_bpb->freemap_shift;
+    if (full)
+        fat_bpb->freemap[bit / 8] |= 1 << (bit % 8);
+    else
+        fat_bpb->freemap[bit / 8] &= ~(1 << (bit % 8));
+}
+
+/* return true if 'sector' is the first of its group */
+static inline bool freemap_group_first(struct bpb *fat_bpb,
+                                       unsigned long sector)
+{
+    return !(sector & ((1ul << fat_bpb->freemap_shift) - 1));
+}
+
+/* return the sector following the group of 'sector' */
+static inline unsigned long freemap_group_end(struct bpb *fat_bpb,
+                                              unsigned long sector)
+{
+    unsigned long end = ((sector >> fat_bpb->freemap_shift) + 1)
+                            << fat_bpb->freemap_shift;
+    return MIN(end, fat_bpb->fatsize);
+}
+
 #ifdef HAVE_FAT16SUPPORT
 static long get_next_cluster16(struct bpb *fat_bpb, long startcluster)
 {
@@ -831,10 +908,24 @@ static long find_free_cluster16(struct bpb *fat_bpb, long startcluster)
     unsigned long entry = startcluster;
     unsigned long sector = entry / CLUSTERS_PER_FAT16_SECTOR;
     unsigned long offset = entry % CLUSTERS_PER_FAT16_SECTOR;
+    bool wholegroup = false; /* group scanned from its start so far */
 
     for (unsigned long i = 0; i < fat_bpb->fatsize; i++)
     {
         unsigned long nr = (i + sector) % fat_bpb->fatsize;
+        unsigned long end = freemap_group_end(fat_bpb, nr);
+
+        if (freemap_is_full(fat_bpb, nr))
+        {
+            /* nothing free in the rest of the group */
+            i += end - nr - 1;
+            offset = 0;
+            continue;
+        }
+
+        if (freemap_group_first(fat_bpb, nr))
+            wholegroup = offset == 0;
+
         uint16_t *sec = cache_sector(fat_bpb, nr + fat_bpb->fatrgnstart);
         if (!sec)
             break;
@@ -859,6 +950,9 @@ static long find_free_cluster16(struct bpb *fat_bpb, long startcluster)
         }
 
         offset = 0;
+
+        if (wholegroup && nr + 1 == end)
+            freemap_set_full(fat_bpb, nr, true);
     }
 
     DEBUGF("%s(%lx) == 0\n", __func__, startcluster);
@@ -904,6 +998,8 @@ static int update_fat_entry16(struct bpb *fat_bpb, unsigned long entry,
         /* being freed */
         if (curval != 0x0000)
             fat_bpb->fsinfo.freecount++;
+
+        freemap_set_full(fat_bpb, sector, false);
     }
 
     DEBUGF("%lu free clusters\n", (unsigned long)fat_bpb->fsinfo.freecount);
@@ -918,9 +1014,13 @@ static int update_fat_entry16(struct bpb *fat_bpb, unsigned long entry,
 static void fat_recalc_free_internal16(struct bpb *fat_bpb)
 {
     unsigned long free = 0;
+    unsigned long groupfree = 0;
 
     for (unsigned long i = 0; i < fat_bpb->fatsize; i++)
     {
+        if (freemap_group_first(fat_bpb, i))
+            groupfree = free;
+
         uint16_t *sec = cache_sector(fat_bpb, i + fat_bpb->fatrgnstart);
         if (!sec)
             break;
@@ -939,6 +1039,9 @@ static void fat_recalc_free_internal16(struct bpb *fat_bpb)
             if (fat_bpb->fsinfo.nextfree == 0xffffffff)
                 fat_bpb->fsinfo.nextfree = c;
         }
+
+        if (i + 1 == freemap_group_end(fat_bpb, i))
+            freemap_set_full(fat_bpb, i, free == groupfree);
     }
 
     fat_bpb->fsinfo.freecount = free;
@@ -990,10 +1093,24 @@ static long find_free_cluster32(struct bpb *fat_bpb, long startcluster)
     unsigned long entry = startcluster;
     unsigned long sector = entry / CLUSTERS_PER_FAT_SECTOR;
     unsigned long offset = entry % CLUSTERS_PER_FAT_SECTOR;
+    bool wholegroup = false; /* group scanned from its start so far */
 
     for (unsigned long i = 0; i < fat_bpb->fatsize; i++)
     {
         unsigned long nr = (i + sector) % fat_bpb->fatsize;
+        unsigned long end = freemap_group_end(fat_bpb, nr);
+
+        if (freemap_is_full(fat_bpb, nr))
+        {
+            /* nothing free in the rest of the group */
+            i += end - nr - 1;
+            offset = 0;
+            continue;
+        }
+
+        if (freemap_group_first(fat_bpb, nr))
+            wholegroup = offset == 0;
+
         uint32_t *sec = cache_sector(fat_bpb, nr + fat_bpb->fatrgnstart);
         if (!sec)
             break;
@@ -1018,6 +1135,9 @@ static long find_free_cluster32(struct bpb *fat_bpb, long startcluster)
         }
 
         offset = 0;
+
+        if (wholegroup && nr + 1 == end)
+            freemap_set_full(fat_bpb, nr, true);
     }
 
     DEBUGF("%s(%lx) == 0\n", __func__, startcluster);
@@ -1061,6 +1181,8 @@ static int update_fat_entry32(struct bpb *fat_bpb, unsigned long entry,
         /* being freed */
         if (curval & 0x0fffffff)
             fat_bpb->fsinfo.freecount++;
+
+        freemap_set_full(fat_bpb, sector, false);
     }
 
     DEBUGF("%lu free clusters\n", (unsigned long)fat_bpb->fsinfo.freecount);
@@ -1076,9 +1198,13 @@ static int update_fat_entry32(struct bpb *fat_bpb, unsigned long entry,
 static void fat_recalc_free_internal32(struct bpb *fat_bpb)
 {
     unsigned long free = 0;
+    unsigned long groupfree = 0;
 
     for (unsigned long i = 0; i < fat_bpb->fatsize; i++)
     {
+        if (freemap_group_first(fat_bpb, i))
+            groupfree = free;
+
         uint32_t *sec = cache_sector(fat_bpb, i + fat_bpb->fatrgnstart);
         if (!sec)
             break;
@@ -1097,6 +1223,9 @@ static void fat_recalc_free_internal32(struct bpb *fat_bpb)
             if (fat_bpb->fsinfo.nextfree == 0xffffffff)
                 fat_bpb->fsinfo.nextfree = c;
         }
+
+        if (i + 1 == freemap_group_end(fat_bpb, i))
+            freemap_set_full(fat_bpb, i, free == groupfree);
     }
 
     fat_bpb->fsinfo.freecount = free;
@@ -1226,6 +1355,8 @@ static int fat_mount_internal(struct bpb *fat_bpb)
         FAT_ERROR(rc * 10 - 7);
     }
 
+    freemap_init(fat_bpb);
+
 #ifdef HAVE_FAT16SUPPORT
     if (fat_bpb->is_fat16)
     {
@@ -1312,6 +1443,286 @@ static union raw_dirent * cache_direntry(struct bpb *fat_bpb,
     return ent;
 }
 
+
+/** Cluster extent cache **/
+
+/* Seeking within a file walks its cluster chain through the FAT. For a few
+ * files at a time, remember the runs of contiguous clusters found on the way
+ * so that a later seek starts at or near the target instead. A map only
+ * remembers runs that were actually walked; appending to a chain leaves it
+ * valid and anything that frees clusters drops the maps of the volume.
+ *
+ * A file too fragmented for its runs to fit switches its map to checkpoints
+ * instead: the same memory then holds the cluster at every 2^shift-th index
+ * in the file, spreading out as the file grows, so that no seek walks more
+ * than 2^shift - 1 steps of the chain once the checkpoints are filled in. */
+#ifndef FAT_EXTENT_MAPS
+#define FAT_EXTENT_MAPS     4   /* files whose runs are remembered */
+#endif
+#ifndef FAT_EXTENT_COUNT
+#define FAT_EXTENT_COUNT    16  /* runs remembered per file */
+#endif
+#define FAT_EXTENT_MIN_WALK 8   /* chain steps a seek takes to get a map */
+
+struct fat_extent
+{
+    long clusternum;            /* index of the run's first cluster in file */
+    long cluster;               /* run's first cluster */
+    long count;                 /* number of clusters in the run */
+};
+
+/* checkpoints per map; an even number so that they can be thinned out by
+   halves */
+#define FAT_EXTENT_CHECKPOINTS \
+    ((FAT_EXTENT_COUNT * sizeof (struct fat_extent) / sizeof (long)) & ~1)
+
+static struct fat_extent_map
+{
+    struct bpb        *bpb;     /* volume of the file (NULL = unused) */
+    long              firstcluster; /* first cluster of the file */
+    unsigned long     lastuse;  /* LRU stamp */
+    int               count;    /* number of valid runs (0 = checkpoints) */
+    int               shift;    /* log2 of the checkpoint spacing */
+    union
+    {
+        struct fat_extent ext[FAT_EXTENT_COUNT]; /* runs by clusternum */
+        long cp[FAT_EXTENT_CHECKPOINTS]; /* cluster at index k << shift in
+                                            file (0 = not known) */
+    };
+} fat_extent_maps[FAT_EXTENT_MAPS];
+
+static unsigned long fat_extent_lastuse;
+
+/* Streams of a file share its map, and so do the threads reading through
+ * them, so the pool is only touched with the cache lock held. A map is found
+ * again by volume and first cluster for every lookup or note and never kept
+ * across anything that blocks, since another stream may have recycled it for
+ * a different file in the meantime. */
+
+/* return the map for the file or, if 'create', a new one if it has none;
+   call with the cache lock held */
+static struct fat_extent_map * extent_map_get(struct bpb *fat_bpb,
+                                              long firstcluster, bool create)
+{
+    if (firstcluster <= 0)
+        return NULL; /* empty file or FAT16 root dir */
+
+    struct fat_extent_map *map = NULL;
+
+    for (int i = 0; i < FAT_EXTENT_MAPS; i++)
+    {
+        struct fat_extent_map *m = &fat_extent_maps[i];
+        if (m->bpb == fat_bpb && m->firstcluster == firstcluster)
+        {
+            m->lastuse = ++fat_extent_lastuse;
+            return m;
+        }
+
+        if (!map || !m->bpb || (map->bpb && m->lastuse < map->lastuse))
+            map = m;
+    }
+
+    if (!create)
+        return NULL;
+
+    /* recycle the least recently used */
+    map->bpb          = fat_bpb;
+    map->firstcluster = firstcluster;
+    map->lastuse      = ++fat_extent_lastuse;
+    map->count        = 1;
+    map->shift        = 0;
+    map->ext[0].clusternum = 0;
+    map->ext[0].cluster    = firstcluster;
+    map->ext[0].count      = 1;
+    return map;
+}
+
+/* return true if the file has a map */
+static bool extent_map_exists(struct bpb *fat_bpb, long firstcluster)
+{
+    dc_lock_cache();
+    bool exists = extent_map_get(fat_bpb, firstcluster, false) != NULL;
+    dc_unlock_cache();
+    return exists;
+}
+
+/* forget every map of the volume */
+static void extent_map_discard(struct bpb *fat_bpb)
+{
+    dc_lock_cache();
+
+    for (int i = 0; i < FAT_EXTENT_MAPS; i++)
+    {
+        if (fat_extent_maps[i].bpb == fat_bpb)
+            fat_extent_maps[i].bpb = NULL;
+    }
+
+    dc_unlock_cache();
+}
+
+/* return the index of the last run starting at or before 'clusternum' */
+static int extent_find(const struct fat_extent_map *map, long clusternum)
+{
+    /* the first run always starts at 0 */
+    int lo = 0, hi = map->count - 1;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+        if (map->ext[mid].clusternum <= clusternum)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return lo;
+}
+
+/* find the known cluster nearest to and not after 'clusternum', giving the
+   file a map first if 'create'; returns its index in the file and the
+   cluster in *clusterp, or -1 if the file has no map */
+static long extent_lookup(struct bpb *fat_bpb, long firstcluster,
+                          long clusternum, long *clusterp, bool create)
+{
+    long known = -1;
+
+    dc_lock_cache();
+
+    struct fat_extent_map *map = extent_map_get(fat_bpb, firstcluster, create);
+    if (map && !map->count)
+    {
+        /* checkpoints; the first one is always there */
+        long k = MIN(clusternum >> map->shift,
+                     (long)FAT_EXTENT_CHECKPOINTS - 1);
+        while (!map->cp[k])
+            k--;
+
+        known = k << map->shift;
+        *clusterp = map->cp[k];
+    }
+    else if (map)
+    {
+        const struct fat_extent *ext = &map->ext[extent_find(map, clusternum)];
+        known = MIN(clusternum, ext->clusternum + ext->count - 1);
+        *clusterp = ext->cluster + (known - ext->clusternum);
+    }
+
+    dc_unlock_cache();
+    return known;
+}
+
+/* add 'cluster' at 'clusternum' to a map of checkpoints */
+static void extent_checkpoint_note(struct fat_extent_map *map,
+                                   long clusternum, long cluster)
+{
+    while (clusternum >> map->shift >= (long)FAT_EXTENT_CHECKPOINTS)
+    {
+        /* beyond the last one; keep every other checkpoint and double the
+           spacing */
+        for (unsigned int k = 0; k < FAT_EXTENT_CHECKPOINTS / 2; k++)
+            map->cp[k] = map->cp[2*k];
+
+        memset(&map->cp[FAT_EXTENT_CHECKPOINTS / 2], 0,
+               FAT_EXTENT_CHECKPOINTS / 2 * sizeof (long));
+        map->shift++;
+    }
+
+    if (!(clusternum & ((1l << map->shift) - 1)))
+        map->cp[clusternum >> map->shift] = cluster;
+}
+
+/* turn a full map of runs into checkpoints spaced widely enough to cover
+   the runs and 'clusternum' */
+static void extent_map_to_checkpoints(struct fat_extent_map *map,
+                                      long clusternum)
+{
+    struct fat_extent ext[FAT_EXTENT_COUNT];
+    int count = map->count;
+    memcpy(ext, map->ext, count * sizeof (struct fat_extent));
+
+    const struct fat_extent *lastext = &ext[count-1];
+    long last = MAX(clusternum, lastext->clusternum + lastext->count - 1);
+    map->count = 0;
+    map->shift = 0;
+    while (last >> map->shift >= (long)FAT_EXTENT_CHECKPOINTS)
+        map->shift++;
+
+    /* keep whichever checkpoints the runs cover */
+    int i = 0;
+    for (unsigned int k = 0; k < FAT_EXTENT_CHECKPOINTS; k++)
+    {
+        long n = (long)k << map->shift;
+        while (i + 1 < count && ext[i+1].clusternum <= n)
+            i++;
+
+        map->cp[k] = n < ext[i].clusternum + ext[i].count ?
+                        ext[i].cluster + (n - ext[i].clusternum) : 0;
+    }
+}
+
+/* add 'cluster' at 'clusternum' to the map */
+static void extent_map_note(struct fat_extent_map *map, long clusternum,
+                            long cluster)
+{
+    if (!map->count)
+    {
+        extent_checkpoint_note(map, clusternum, cluster);
+        return;
+    }
+
+    int i = extent_find(map, clusternum);
+    struct fat_extent *ext = &map->ext[i];
+    long end = ext->clusternum + ext->count;
+
+    if (clusternum < end)
+        return; /* known */
+
+    if (clusternum == end && cluster == ext->cluster + ext->count)
+    {
+        /* grows this run; join the next one if it now touches it */
+        ext->count++;
+
+        if (i + 1 < map->count && ext[1].clusternum == end + 1 &&
+            ext[1].cluster == cluster + 1)
+        {
+            ext->count += ext[1].count;
+            memmove(&ext[1], &ext[2],
+                    (map->count - i - 2) * sizeof (struct fat_extent));
+            map->count--;
+        }
+
+        return;
+    }
+
+    if (map->count >= FAT_EXTENT_COUNT)
+    {
+        /* full; too fragmented for runs */
+        extent_map_to_checkpoints(map, clusternum);
+        extent_checkpoint_note(map, clusternum, cluster);
+        return;
+    }
+
+    /* start a new run after run i */
+    memmove(&ext[2], &ext[1], (map->count - i - 1) * sizeof (struct fat_extent));
+    ext[1].clusternum = clusternum;
+    ext[1].cluster    = cluster;
+    ext[1].count      = 1;
+    map->count++;
+}
+
+/* remember that 'cluster' is at 'clusternum' in the file, if it has a map */
+static void extent_note(struct bpb *fat_bpb, long firstcluster,
+                        long clusternum, long cluster)
+{
+    dc_lock_cache();
+
+    struct fat_extent_map *map = extent_map_get(fat_bpb, firstcluster, false);
+    if (map)
+        extent_map_note(map, clusternum, cluster);
+
+    dc_unlock_cache();
+}
+
 static long next_write_cluster(struct bpb *fat_bpb, long oldcluster)
 {
     DEBUGF("%s(old:%lx)\n", __func__, oldcluster);
@@ -1935,6 +2346,8 @@ static int free_direntries(struct bpb *fat_bpb, struct fat_file *file)
 
 static int free_cluster_chain(struct bpb *fat_bpb, long startcluster)
 {
+    extent_map_discard(fat_bpb);
+
     for (long last = startcluster, next; last; last = next)
     {
         next = get_next_cluster(fat_bpb, last);
@@ -2270,6 +2683,7 @@ int fat_closewrite(struct fat_filestr *filestr, uint32_t size,
     if (!size && file->firstcluster)
     {
         /* empty file */
+        extent_map_discard(fat_bpb);
         rc = update_fat_entry(fat_bpb, file->firstcluster, 0);
         if (rc < 0)
             FAT_ERROR(rc * 10 - 2);
@@ -2411,6 +2825,9 @@ long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
 
     eof = false;
 
+    /* only files that were seeked far enough to get a map use one */
+    bool mapped = extent_map_exists(fat_bpb, file->firstcluster);
+
     if (!sector)
     {
         /* look up first sector of file */
@@ -2453,8 +2870,19 @@ long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
         if (++sectornum >= fat_bpb->bpb_secperclus)
         {
             /* out of sectors in this cluster; get the next cluster */
-            long newcluster = write ? next_write_cluster(fat_bpb, cluster) :
-                                      get_next_cluster(fat_bpb, cluster);
+            long newcluster = 0;
+
+            if (mapped && extent_lookup(fat_bpb, file->firstcluster,
+                                        clusternum + 1, &newcluster, false)
+                                != clusternum + 1)
+                newcluster = 0; /* not known */
+
+            if (!newcluster)
+            {
+                newcluster = write ? next_write_cluster(fat_bpb, cluster) :
+                                     get_next_cluster(fat_bpb, cluster);
+            }
+
             if (newcluster)
             {
                 cluster = newcluster;
@@ -2462,6 +2890,10 @@ long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
                 clusternum++;
                 sectornum = 0;
 
+                if (mapped)
+                    extent_note(fat_bpb, file->firstcluster, clusternum,
+                                cluster);
+
                 /* jumped clusters right at start? */
                 if (!count)
                     last = sector;
@@ -2474,21 +2906,32 @@ long fat_readwrite(struct fat_filestr *filestr, unsigned long sectorcount,
             }
         }
 
-        /* find sequential sectors and transfer them all at once */
-        if (sector != last || count >= FAT_MAX_TRANSFER_SIZE)
+        /* take the rest of this cluster at once, or what is left wanted */
+        unsigned long run = MIN(fat_bpb->bpb_secperclus - sectornum,
+                                sectorcount - transferred - count);
+        sectornum += run - 1;
+
+        while (run)
         {
-            /* not sequential/over limit */
-            rc = transfer(fat_bpb, last - count + 1, count, buf, write);
-            if (rc < 0)
-                FAT_ERROR(rc * 10 - 2);
+            /* find sequential sectors and transfer them all at once; runs
+               of contiguous clusters coalesce up to the limit */
+            if (sector != last || count >= FAT_MAX_TRANSFER_SIZE)
+            {
+                /* not sequential/over limit */
+                rc = transfer(fat_bpb, last - count + 1, count, buf, write);
+                if (rc < 0)
+                    FAT_ERROR(rc * 10 - 2);
+
+                transferred += count;
+                buf += count * SECTOR_SIZE;
+                count = 0;
+            }
 
-            transferred += count;
-            buf += count * SECTOR_SIZE;
-            count = 0;
+            unsigned long n = MIN(run, FAT_MAX_TRANSFER_SIZE - count);
+            count += n;
+            run -= n;
+            last = sector += n;
         }
-
-        count++;
-        last = ++sector;
     }
 
     if (count)
@@ -2570,16 +3013,28 @@ int fat_seek(struct fat_filestr *filestr, unsigned long seeksector)
         clusternum = seeksector / fat_bpb->bpb_secperclus;
         sectornum = seeksector % fat_bpb->bpb_secperclus;
 
-        long numclusters = clusternum;
+        long startnum = 0;
 
         if (filestr->clusternum && clusternum >= filestr->clusternum)
         {
             /* seek forward from current position */
             cluster = filestr->lastcluster;
-            numclusters -= filestr->clusternum;
+            startnum = filestr->clusternum;
         }
 
-        for (long i = 0; i < numclusters; i++)
+        /* long walks are worth remembering */
+        long knowncluster;
+        long known = extent_lookup(fat_bpb, file->firstcluster, clusternum,
+                                   &knowncluster,
+                                   clusternum - startnum >= FAT_EXTENT_MIN_WALK);
+        bool mapped = known >= 0;
+        if (known > startnum)
+        {
+            cluster = knowncluster;
+            startnum = known;
+        }
+
+        for (long i = startnum; i < clusternum; i++)
         {
             cluster = get_next_cluster(fat_bpb, cluster);
 
@@ -2589,6 +3044,9 @@ int fat_seek(struct fat_filestr *filestr, unsigned long seeksector)
                        "(sector %lu, cluster %ld)\n", seeksector, i);
                 FAT_ERROR(FAT_SEEK_EOF);
             }
+
+            if (mapped)
+                extent_note(fat_bpb, file->firstcluster, i + 1, cluster);
         }
 
         sector = cluster2sec(fat_bpb, cluster) + sectornum;
@@ -2620,6 +3078,8 @@ int fat_truncate(const struct fat_filestr *filestr)
     long last = filestr->lastcluster;
     long next = 0;
 
+    extent_map_discard(fat_bpb);
+
     /* truncate trailing clusters after the current position */
     if (last)
     {
@@ -2806,6 +3266,7 @@ int fat_mount(IF_MV(int volume,) IF_MD(int drive,) unsigned long startsector)
 
     /* it worked */
     fat_bpb->mounted = true;
+    extent_map_discard(fat_bpb);
 
     /* calculate freecount if unset */
     if (fat_bpb->fsinfo.freecount == 0xffffffff)
@@ -2830,6 +3291,7 @@ int fat_unmount(IF_MV_NONVOID(int volume))
 
     /* free the entries for this volume */
     cache_discard(IF_MV(fat_bpb));
+    extent_map_discard(fat_bpb);
     fat_bpb->mounted = false;
 
     return 0;
@@ -123,6 +123,8 @@
 #define FIXEDSETTINGSFILE   ROCKBOX_DIR "/fixed.cfg"
 
 #define PLAYLIST_CONTROL_FILE   ROCKBOX_DIR "/.playlist_control"
+#define PLAYLIST_INDEX_FILE     ROCKBOX_DIR "/.playlist_index"
+#define PLAYLIST_CHECKPOINT_FILE ROCKBOX_DIR "/.playlist_checkpoint"
 #define NVRAM_FILE              ROCKBOX_DIR "/nvram.bin"
 #define GLYPH_CACHE_FILE        ROCKBOX_DIR "/.glyphcache"
 
@@ -51,6 +51,17 @@
 #define DIRCACHE_MIN     (1024*1024*1) /* 1 MB - provision min size */
 #define DIRCACHE_LIMIT   (1024*1024*6) /* 6 MB - provision max size */
 
+/* keep a hash of the entries by parent and name so that path lookups don't
+   have to walk whole directories; costs one index per entry plus a table of
+   bucket heads at the end of the buffer (native only) */
+#define DIRCACHE_NAMEHASH
+
+/* build by reading the tree a level at a time, directories in each batch in
+   order of their first cluster and all volumes at once, instead of depth-
+   first volume by volume (native only) */
+#define DIRCACHE_BREADTHFIRST
+#define DIRCACHE_SCAN_BATCH 16     /* directories sorted together */
+
 /* make it easy to change serialnumber size without modifying anything else;
    32 bits allows 21845 builds before wrapping in a 6MB cache that is filled
    exclusively with entries and nothing else (32 byte entries), making that
@@ -75,6 +86,9 @@ typedef uint32_t dc_serial_t;
 #if CONFIG_PLATFORM & PLATFORM_NATIVE
 /* native dircache is lower-level than on a hosted target */
 #define DIRCACHE_NATIVE
+#else
+#undef DIRCACHE_NAMEHASH
+#undef DIRCACHE_BREADTHFIRST
 #endif
 
 struct dircache_file
@@ -124,6 +138,12 @@ int dircache_readdir_internal(struct filestr_base *stream,
                               struct file_base_info *infop,
                               struct fat_direntry *fatent);
 void dircache_rewinddir_internal(struct file_base_info *info);
+#ifdef DIRCACHE_NAMEHASH
+int dircache_lookup_internal(struct filestr_base *stream,
+                             struct file_base_info *infop,
+                             struct fat_direntry *fatent,
+                             const char *name, bool isodecode);
+#endif /* DIRCACHE_NAMEHASH */
 #endif /* DIRCACHE_NATIVE */
 
 
@@ -190,6 +210,8 @@ struct dircache_info
     size_t       reserve_used;   /* amount of reserve used */
     unsigned int entry_count;    /* number of cache entries */
     long         build_ticks;    /* total time used to build cache */
+    unsigned int build_progress; /* estimated percent done if scanning */
+    unsigned int build_rate;     /* entries/s added by the last/current build */
 };
 
 void dircache_get_info(struct dircache_info *info);
@@ -190,6 +190,21 @@ static inline void rewinddir_internal(struct file_base_info *infop)
 #endif
 }
 
+/* find a name in a directory without scanning if the cache can tell;
+   < 0 means it can't and the caller has to scan */
+static inline int lookup_internal(struct filestr_base *stream,
+                                  struct file_base_info *infop,
+                                  struct fat_direntry *fatent,
+                                  const char *name, bool isodecode)
+{
+#if defined(HAVE_DIRCACHE) && defined(DIRCACHE_NAMEHASH)
+    return dircache_lookup_internal(stream, infop, fatent, name, isodecode);
+#else
+    (void)stream; (void)infop; (void)fatent; (void)name; (void)isodecode;
+    return -1;
+#endif
+}
+
 
 /** Misc. stuff **/
 
@@ -45,9 +45,18 @@ void dc_discard_all(IF_MV_NONVOID(int volume));
 
 void dc_init(void) INIT_ATTR;
 
-/* in addition to filling, writeback is implemented by the client */
+/* in addition to filling, writeback is implemented by the client; 'count'
+   consecutive sectors are written from 'buf' */
 extern void dc_writeback_callback(IF_MV(int volume, ) unsigned long sector,
-                                  void *buf);
+                                  int count, void *buf);
+
+struct dc_stats
+{
+    unsigned long hits;       /* probes that found the sector cached */
+    unsigned long misses;     /* probes that had to take over an entry */
+    unsigned long writebacks; /* dirty sectors written back */
+    unsigned long writes;     /* writeback calls made for them */
+};
 
 
 /** These synchronize and can be called by anyone **/
@@ -56,5 +65,7 @@ extern void dc_writeback_callback(IF_MV(int volume, ) unsigned long sector,
 void * dc_get_buffer(void);
 /* return buffer to the cache by buffer */
 void dc_release_buffer(void *buf);
+/* copy the hit/miss/writeback counters */
+void dc_get_stats(struct dc_stats *stats);
 
 #endif /* DISK_CACHE_H */
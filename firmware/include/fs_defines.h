@@ -90,16 +90,23 @@
  * One map per volume is maintained in order to avoid collisions between
  * volumes that would slow cache probing. IOC_MAP_NUM_ENTRIES is the number
  * for each map per volume. The buffers themselves are shared.
+ *
+ * Dirty sectors with consecutive numbers are written back together, up to
+ * DC_WRITEBACK_MAX at a time, going through a staging buffer of that many
+ * sectors if their cache buffers aren't adjacent.
  */
 #if MEMORYSIZE < 8
 #define DC_NUM_ENTRIES      32
 #define DC_MAP_NUM_ENTRIES  128
+#define DC_WRITEBACK_MAX    4
 #elif MEMORYSIZE <= 32
 #define DC_NUM_ENTRIES      48
 #define DC_MAP_NUM_ENTRIES  128
+#define DC_WRITEBACK_MAX    8
 #else /* MEMORYSIZE > 32 */
 #define DC_NUM_ENTRIES      64
 #define DC_MAP_NUM_ENTRIES  256
+#define DC_WRITEBACK_MAX    16
 #endif /* MEMORYSIZE */
 
 /* this _could_ be larger than a sector if that would ever be useful */
@@ -0,0 +1,372 @@
+/***************************************************************************
+*             __________               __   ___.
+*   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+*   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+*   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+*   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+*                     \/            \/     \/    \/            \/
+* $Id$
+*
+* Replays an allocation trace against buflib and reports allocation latency,
+* the amount of data moved by compaction and the peak fragmentation.
+*
+* To record a trace build the simulator with -DBUFLIB_TRACE added to
+* EXTRA_DEFINES in the generated Makefile and keep its stderr:
+*
+*   ./rockboxui 2> session.log
+*   ./buflib_replay session.log
+*
+* Every context seen in the trace (core_ctx, the skin buffer, ...) is
+* replayed separately. Operations buflib requested from within a shrink
+* callback are not replayed, the replay's own shrink callback gives up the
+* requested amount instead.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "buflib.h"
+#include "system.h"
+
+#define MAX_CONTEXTS    8
+#define MAX_HANDLES     4096
+#define LATENCY_BUCKETS 32 /* log2(ns) */
+
+struct replay_ctx {
+    unsigned long id;       /* context address in the recording */
+    struct buflib_context ctx;
+    void *pool;
+    size_t pool_size;
+    /* recorded handle -> replayed handle and its current size, and back */
+    int handles[MAX_HANDLES];
+    size_t sizes[MAX_HANDLES];
+    int slots[MAX_HANDLES];
+    /* statistics */
+    unsigned long n_alloc, n_alloc_failed, n_free, n_shrink, n_skipped;
+    unsigned long n_moves, rec_moves;
+    unsigned long long bytes_moved, rec_bytes_moved;
+    unsigned long latency[LATENCY_BUCKETS];
+    unsigned long long latency_total, latency_max;
+    double peak_frag;
+    size_t peak_frag_free;
+};
+
+static struct replay_ctx contexts[MAX_CONTEXTS];
+static int num_contexts;
+/* the context currently being operated on, for the callbacks */
+static struct replay_ctx *cur;
+
+static struct replay_ctx *get_context(unsigned long id)
+{
+    for (int i = 0; i < num_contexts; i++)
+        if (contexts[i].id == id)
+            return &contexts[i];
+    return NULL;
+}
+
+static int replayed_to_slot(struct replay_ctx *rc, int handle)
+{
+    if (handle <= 0 || handle >= MAX_HANDLES || !rc->slots[handle])
+        return -1;
+    return rc->slots[handle];
+}
+
+static int move_callback(int handle, void* current, void* new)
+{
+    (void)current;(void)new;
+    int slot = replayed_to_slot(cur, handle);
+    cur->n_moves++;
+    if (slot >= 0)
+        cur->bytes_moved += cur->sizes[slot];
+    return BUFLIB_CB_OK;
+}
+
+static int shrink_callback(int handle, unsigned hints, void* start, size_t old_size)
+{
+    (void)old_size;
+    int slot = replayed_to_slot(cur, handle);
+    size_t wanted = ALIGN_UP(hints & BUFLIB_SHRINK_SIZE_MASK, sizeof(union buflib_data));
+    if (slot < 0 || wanted == 0 || wanted >= cur->sizes[slot])
+        return BUFLIB_CB_CANNOT_SHRINK;
+
+    size_t new_size = cur->sizes[slot] - wanted;
+    char *new_start = start;
+    if (!(hints & BUFLIB_SHRINK_POS_BACK))
+        new_start += wanted;
+    if (!buflib_shrink(&cur->ctx, handle, new_start, new_size))
+        return BUFLIB_CB_CANNOT_SHRINK;
+
+    cur->sizes[slot] = new_size;
+    return BUFLIB_CB_OK;
+}
+
+static struct buflib_callbacks ops_table[4] = {
+    { .move_callback = NULL,          .shrink_callback = NULL },
+    { .move_callback = move_callback, .shrink_callback = NULL },
+    { .move_callback = NULL,          .shrink_callback = shrink_callback },
+    { .move_callback = move_callback, .shrink_callback = shrink_callback },
+};
+
+static struct buflib_callbacks *flags_to_ops(const char *flags)
+{
+    int idx = (flags[0] == 'm' ? 1 : 0) | (flags[1] == 's' ? 2 : 0);
+    return &ops_table[idx];
+}
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void account_latency(struct replay_ctx *rc, unsigned long long ns)
+{
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (1ull << (bucket + 1)) <= ns)
+        bucket++;
+    rc->latency[bucket]++;
+    rc->latency_total += ns;
+    if (ns > rc->latency_max)
+        rc->latency_max = ns;
+}
+
+/* Walks the blocks without compacting. Fragmentation is the share of free
+ * space that is not part of the largest contiguous free region */
+static void account_fragmentation(struct replay_ctx *rc)
+{
+    struct buflib_context *ctx = &rc->ctx;
+    size_t total = 0, largest = 0;
+    for (union buflib_data *this = ctx->buf_start; this < ctx->alloc_end;
+                            this += labs(this->val))
+    {
+        if (this->val < 0)
+        {
+            total += -this->val;
+            largest = MAX(largest, (size_t)-this->val);
+        }
+    }
+    size_t end = ctx->last_handle - ctx->alloc_end;
+    total += end;
+    largest = MAX(largest, end);
+    if (total == 0)
+        return;
+
+    double frag = 1.0 - (double)largest / total;
+    if (frag > rc->peak_frag)
+    {
+        rc->peak_frag = frag;
+        rc->peak_frag_free = total * sizeof(union buflib_data);
+    }
+}
+
+/* recorded handles index the mapping tables directly */
+static int map_slot(long recorded)
+{
+    if (recorded <= 0 || recorded >= MAX_HANDLES)
+        return -1;
+    return recorded;
+}
+
+/* Lines look like "buflib_trace: <in_cb> <op> <ctx> <args...>", names of
+ * allocations come last as they may contain spaces */
+static void replay_line(char *line)
+{
+    char op[16], flags[3];
+    unsigned long id;
+    long a, b, c;
+    int in_cb, n, slot;
+    struct replay_ctx *rc;
+
+    if (strncmp(line, "buflib_trace: ", 14))
+        return;
+    line += 14;
+    line[strcspn(line, "\r\n")] = '\0';
+
+    if (sscanf(line, "%d %15s %lx%n", &in_cb, op, &id, &n) < 3)
+        return;
+    line += n;
+
+    if (!strcmp(op, "init"))
+    {
+        if (sscanf(line, "%ld", &a) < 1)
+            return;
+        rc = get_context(id);
+        if (!rc)
+        {
+            if (num_contexts == MAX_CONTEXTS)
+                return;
+            rc = &contexts[num_contexts++];
+        }
+        free(rc->pool);
+        memset(rc, 0, sizeof(*rc));
+        rc->id = id;
+        rc->pool_size = a;
+        rc->pool = malloc(a);
+        buflib_init(&rc->ctx, rc->pool, a);
+        return;
+    }
+
+    rc = get_context(id);
+    if (!rc)
+        return;
+    cur = rc;
+
+    if (!strcmp(op, "alloc") || !strcmp(op, "max"))
+    {
+        if (sscanf(line, "%ld %ld %2s %n", &a, &b, flags, &n) < 3)
+            return;
+        const char *name = line + n;
+        size_t size = b;
+        int handle;
+
+        /* always pass callbacks, buflib would move allocations with NULL
+         * ops without telling */
+        unsigned long long start = now_ns();
+        if (op[0] == 'm')
+            handle = buflib_alloc_maximum(&rc->ctx, name, &size,
+                                          flags_to_ops(flags));
+        else
+            handle = buflib_alloc_ex(&rc->ctx, size, *name ? name : NULL,
+                                     flags_to_ops(flags));
+        account_latency(rc, now_ns() - start);
+
+        rc->n_alloc++;
+        slot = map_slot(a);
+        if (handle <= 0)
+            rc->n_alloc_failed++;
+        else if (slot >= 0 && handle < MAX_HANDLES)
+        {
+            rc->handles[slot] = handle;
+            rc->sizes[slot] = size;
+            rc->slots[handle] = slot;
+        }
+        else /* failed in the recording or out of slots, don't keep it */
+            buflib_free(&rc->ctx, handle);
+    }
+    else if (!strcmp(op, "free"))
+    {
+        if (sscanf(line, "%ld", &a) < 1)
+            return;
+        slot = map_slot(a);
+        if (slot < 0 || rc->handles[slot] <= 0)
+        {
+            rc->n_skipped++;
+            return;
+        }
+        rc->slots[rc->handles[slot]] = 0;
+        rc->handles[slot] = buflib_free(&rc->ctx, rc->handles[slot]);
+        rc->n_free++;
+    }
+    else if (!strcmp(op, "shrink"))
+    {
+        /* handle, offset of the new start, new size */
+        if (sscanf(line, "%ld %ld %ld", &a, &b, &c) < 3)
+            return;
+        slot = map_slot(a);
+        if (in_cb || slot < 0 || rc->handles[slot] <= 0
+            || (size_t)(b + c) > rc->sizes[slot])
+        {
+            rc->n_skipped++;
+            return;
+        }
+        char *start = buflib_get_data(&rc->ctx, rc->handles[slot]);
+        if (buflib_shrink(&rc->ctx, rc->handles[slot], start + b, c))
+            rc->sizes[slot] = c;
+        rc->n_shrink++;
+    }
+    else if (!strcmp(op, "move"))
+    {
+        if (sscanf(line, "%ld %ld", &a, &b) < 2)
+            return;
+        rc->rec_moves++;
+        rc->rec_bytes_moved += b;
+        return;
+    }
+    else if (!strcmp(op, "out"))
+    {
+        if (sscanf(line, "%ld", &a) < 1)
+            return;
+        size_t size = a;
+        buflib_buffer_out(&rc->ctx, &size);
+    }
+    else if (!strcmp(op, "in"))
+    {
+        if (sscanf(line, "%ld", &a) < 1)
+            return;
+        buflib_buffer_in(&rc->ctx, a);
+    }
+    else
+        return;
+
+    account_fragmentation(rc);
+}
+
+static unsigned long long percentile(struct replay_ctx *rc, int pct)
+{
+    unsigned long want = (rc->n_alloc * pct + 99) / 100, seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += rc->latency[i];
+        if (seen >= want)
+            return 1ull << (i + 1);
+    }
+    return rc->latency_max;
+}
+
+static void print_report(struct replay_ctx *rc)
+{
+    printf("context 0x%lx, %lu bytes\n", rc->id, (unsigned long)rc->pool_size);
+    printf("  allocs:        %lu (%lu failed)\n", rc->n_alloc, rc->n_alloc_failed);
+    printf("  frees:         %lu, shrinks: %lu, skipped: %lu\n",
+           rc->n_free, rc->n_shrink, rc->n_skipped);
+    if (rc->n_alloc)
+    {
+        printf("  alloc latency: avg %llu ns, p50 < %llu ns, p90 < %llu ns, "
+               "p99 < %llu ns, max %llu ns\n",
+               rc->latency_total / rc->n_alloc, percentile(rc, 50),
+               percentile(rc, 90), percentile(rc, 99), rc->latency_max);
+        for (int i = 0; i < LATENCY_BUCKETS; i++)
+            if (rc->latency[i])
+                printf("    < %10llu ns: %lu\n", 1ull << (i + 1), rc->latency[i]);
+    }
+    printf("  moved:         %llu bytes in %lu moves (recorded: %llu bytes in %lu moves)\n",
+           rc->bytes_moved, rc->n_moves, rc->rec_bytes_moved, rc->rec_moves);
+    printf("  peak fragmentation: %.1f%% of %lu free bytes\n",
+           rc->peak_frag * 100, (unsigned long)rc->peak_frag_free);
+}
+
+int main(int argc, char **argv)
+{
+    char line[256];
+    FILE *f = stdin;
+
+    if (argc > 1 && !(f = fopen(argv[1], "r")))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), f))
+        replay_line(line);
+
+    for (int i = 0; i < num_contexts; i++)
+    {
+        buflib_check_valid(&contexts[i].ctx);
+        print_report(&contexts[i]);
+    }
+
+    if (f != stdin)
+        fclose(f);
+    return 0;
+}
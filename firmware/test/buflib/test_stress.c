@@ -0,0 +1,191 @@
+/***************************************************************************
+*             __________               __   ___.
+*   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+*   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+*   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+*   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+*                     \/            \/     \/    \/            \/
+* $Id$
+*
+* Randomized stress test: mixes movable, unmovable and shrinkable
+* allocations, frees and shrinks and verifies after every step that the
+* payload of every live allocation survived compaction intact.
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License
+* as published by the Free Software Foundation; either version 2
+* of the License, or (at your option) any later version.
+*
+* This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+* KIND, either express or implied.
+*
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "buflib.h"
+#include "util.h"
+
+#define BUFLIB_BUFFER_SIZE (64<<10)
+#define MAX_ALLOCS         128
+#define ITERATIONS         20000
+
+static char buflib_buffer[BUFLIB_BUFFER_SIZE];
+static struct buflib_context ctx;
+#define assert(x) do { if (!(x)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #x); exit(1); } } while(0)
+
+static struct {
+    int handle;
+    size_t size;
+    unsigned char seed;
+} allocs[MAX_ALLOCS];
+
+static unsigned long rnd_state = 1;
+
+static unsigned rnd(unsigned max)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return (rnd_state >> 16) % max;
+}
+
+static int find_slot(int handle)
+{
+    for (int i = 0; i < MAX_ALLOCS; i++)
+        if (allocs[i].handle == handle)
+            return i;
+    return -1;
+}
+
+static void fill(int slot)
+{
+    unsigned char *p = buflib_get_data(&ctx, allocs[slot].handle);
+    for (size_t i = 0; i < allocs[slot].size; i++)
+        p[i] = allocs[slot].seed + i;
+}
+
+static void verify_all(void)
+{
+    buflib_check_valid(&ctx);
+    for (int i = 0; i < MAX_ALLOCS; i++)
+    {
+        if (allocs[i].handle <= 0)
+            continue;
+        unsigned char *p = buflib_get_data(&ctx, allocs[i].handle);
+        for (size_t j = 0; j < allocs[i].size; j++)
+            assert(p[j] == (unsigned char)(allocs[i].seed + j));
+    }
+}
+
+static int move_callback(int handle, void* current, void* new)
+{
+    (void)handle;(void)current;(void)new;
+    return BUFLIB_CB_OK;
+}
+
+/* give up the requested amount, keeping the pattern intact. Claiming
+ * success without shrinking would make buflib retry forever */
+static int shrink_callback(int handle, unsigned hints, void* start, size_t old_size)
+{
+    (void)old_size;
+    int slot = find_slot(handle);
+    size_t wanted = hints & BUFLIB_SHRINK_SIZE_MASK;
+    if (slot < 0 || wanted == 0 || wanted >= allocs[slot].size)
+        return BUFLIB_CB_CANNOT_SHRINK;
+
+    bool front = !(hints & BUFLIB_SHRINK_POS_BACK);
+    size_t new_size = allocs[slot].size - wanted;
+    if (!buflib_shrink(&ctx, handle, (char*)start + (front ? wanted : 0),
+                       new_size))
+        return BUFLIB_CB_CANNOT_SHRINK;
+
+    if (front)
+        allocs[slot].seed += wanted;
+    allocs[slot].size = new_size;
+    return BUFLIB_CB_OK;
+}
+
+static struct buflib_callbacks movable_ops = {
+    .move_callback = move_callback,
+    .shrink_callback = NULL,
+};
+
+static struct buflib_callbacks shrinkable_ops = {
+    .move_callback = move_callback,
+    .shrink_callback = shrink_callback,
+};
+
+static struct buflib_callbacks pinned_ops = {
+    .move_callback = NULL,
+    .shrink_callback = shrink_callback,
+};
+
+int main(int argc, char **argv)
+{
+    (void)argc; (void)argv;
+    int n_alloc = 0, n_failed = 0, n_free = 0, n_shrink = 0;
+
+    buflib_init(&ctx, buflib_buffer, BUFLIB_BUFFER_SIZE);
+
+    for (int iter = 0; iter < ITERATIONS; iter++)
+    {
+        int slot = rnd(MAX_ALLOCS);
+        unsigned op = rnd(10);
+
+        if (allocs[slot].handle <= 0)
+        {
+            struct buflib_callbacks *ops;
+            unsigned kind = rnd(8);
+            if (kind == 0)
+                ops = &pinned_ops;
+            else if (kind < 3)
+                ops = &shrinkable_ops;
+            else if (kind < 5)
+                ops = &movable_ops;
+            else
+                ops = NULL;
+
+            /* mostly small allocations with the occasional large one */
+            size_t size = rnd(8) ? 1 + rnd(512) : 1 + rnd(8<<10);
+            int handle = buflib_alloc_ex(&ctx, size, "stress", ops);
+            if (handle <= 0)
+            {
+                n_failed++;
+                continue;
+            }
+            /* a shrink callback may have run already, make sure the slot
+             * is set up before it can be looked up */
+            allocs[slot].handle = handle;
+            allocs[slot].size = size;
+            allocs[slot].seed = rnd(256);
+            fill(slot);
+            n_alloc++;
+        }
+        else if (op < 6)
+        {
+            allocs[slot].handle = buflib_free(&ctx, allocs[slot].handle);
+            n_free++;
+        }
+        else if (allocs[slot].size > 16)
+        {
+            /* shrink from the front or back, keeping the pattern intact */
+            unsigned char *p = buflib_get_data(&ctx, allocs[slot].handle);
+            size_t cut = 1 + rnd(allocs[slot].size / 2);
+            bool front = rnd(2);
+            size_t new_size = allocs[slot].size - cut;
+            assert(buflib_shrink(&ctx, allocs[slot].handle,
+                                 front ? p + cut : p, new_size));
+            if (front)
+                allocs[slot].seed += cut;
+            allocs[slot].size = new_size;
+            n_shrink++;
+        }
+
+        verify_all();
+    }
+
+    printf("%d allocs (%d failed), %d frees, %d shrinks\n",
+           n_alloc, n_failed, n_free, n_shrink);
+    buflib_print_blocks(&ctx, &print_handle);
+
+    return 0;
+}
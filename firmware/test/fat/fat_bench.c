@@ -0,0 +1,329 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Benchmark of the FAT driver's data path on top of the RAM disk driver:
+ * formats a small FAT32 volume in RAM, writes one contiguous and one
+ * fragmented file and reports how fat_readwrite() splits sequential reads
+ * into storage transfers, how long random seeks take and how long it takes
+ * to fill the volume and to fail to allocate once it is full.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include "config.h"
+#include "fat.h"
+#include "disk_cache.h"
+#include "storage.h"
+
+/* see drivers/ramdisk.c */
+#define RAMDISK_SECTORS 16384
+
+#define SECPERCLUS      8
+#define RSVDSECCNT      32
+#define FILE_SECTORS    (4096)          /* 2 MB per test file */
+#define READ_REPEAT     20
+#define SEEK_COUNT      20000
+#define FULL_COUNT      2000
+
+int ramdisk_read_sectors(unsigned long start, int count, void* buf);
+int ramdisk_write_sectors(unsigned long start, int count, const void* buf);
+
+volatile long current_tick;
+
+int find_first_set_bit(uint32_t val)
+{
+    return val ? __builtin_ctz(val) : 32;
+}
+
+void mutex_init(struct mutex *m) { (void)m; }
+void mutex_lock(struct mutex *m) { (void)m; }
+void mutex_unlock(struct mutex *m) { (void)m; }
+
+void panicf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "***PANIC*** ");
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    exit(1);
+}
+
+void debugf(const char *fmt, ...)
+{
+    (void)fmt;
+}
+
+/* long names aren't used here */
+unsigned char* utf8encode(unsigned long ucs, unsigned char *utf8)
+{
+    *utf8++ = ucs;
+    return utf8;
+}
+
+unsigned long utf8length(const unsigned char *utf8)
+{
+    return strlen((const char *)utf8);
+}
+
+const unsigned char* utf8decode(const unsigned char *utf8, unsigned short *ucs)
+{
+    *ucs = *utf8;
+    return utf8 + 1;
+}
+
+/* transfer statistics */
+static struct
+{
+    unsigned long calls;
+    unsigned long sectors;
+    unsigned long maxcount;
+} stats;
+
+int storage_read_sectors(unsigned long start, int count, void* buf)
+{
+    stats.calls++;
+    stats.sectors += count;
+    if ((unsigned long)count > stats.maxcount)
+        stats.maxcount = count;
+
+    return ramdisk_read_sectors(start, count, buf);
+}
+
+int storage_write_sectors(unsigned long start, int count, const void* buf)
+{
+    return ramdisk_write_sectors(start, count, buf);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void put16(unsigned char *p, unsigned int v)
+{
+    p[0] = v; p[1] = v >> 8;
+}
+
+static void put32(unsigned char *p, unsigned long v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+/* lay down a FAT32 volume with an empty root directory in cluster 2 */
+static void format(void)
+{
+    static unsigned char sec[SECTOR_SIZE];
+    unsigned long clusters = (RAMDISK_SECTORS - RSVDSECCNT) / SECPERCLUS;
+    unsigned long fatsz = (clusters * 4 + 8 + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+    memset(sec, 0, sizeof (sec));
+    for (unsigned long i = 0; i < RAMDISK_SECTORS; i++)
+        ramdisk_write_sectors(i, 1, sec);
+
+    sec[0] = 0xeb; sec[1] = 0x58; sec[2] = 0x90;
+    memcpy(&sec[3], "ROCKBOX ", 8);
+    put16(&sec[11], SECTOR_SIZE);
+    sec[13] = SECPERCLUS;
+    put16(&sec[14], RSVDSECCNT);
+    sec[16] = 2;                        /* FATs */
+    sec[21] = 0xf8;                     /* media */
+    put32(&sec[32], RAMDISK_SECTORS);
+    put32(&sec[36], fatsz);
+    put32(&sec[44], 2);                 /* root cluster */
+    put16(&sec[48], 1);                 /* FSInfo sector */
+    sec[510] = 0x55; sec[511] = 0xaa;
+    ramdisk_write_sectors(0, 1, sec);
+
+    memset(sec, 0, sizeof (sec));
+    put32(&sec[0], 0x41615252);
+    put32(&sec[484], 0x61417272);
+    put32(&sec[488], 0xffffffff);       /* free count: recalculate */
+    put32(&sec[492], 3);                /* next free */
+    sec[510] = 0x55; sec[511] = 0xaa;
+    ramdisk_write_sectors(1, 1, sec);
+
+    memset(sec, 0, sizeof (sec));
+    put32(&sec[0], 0x0ffffff8);
+    put32(&sec[4], 0x0fffffff);
+    put32(&sec[8], 0x0ffffff8);         /* root dir */
+    ramdisk_write_sectors(RSVDSECCNT, 1, sec);
+    ramdisk_write_sectors(RSVDSECCNT + fatsz, 1, sec);
+}
+
+/* write files sector by sector in turns of 'step' sectors so that each one
+   gets fragmented unless there is only one */
+static void write_files(struct fat_file *files, int nfiles, int step)
+{
+    static unsigned char buf[SECTOR_SIZE];
+    struct fat_filestr str[nfiles];
+
+    for (int i = 0; i < nfiles; i++)
+    {
+        memset(&files[i], 0, sizeof (files[i]));
+        fat_filestr_init(&str[i], &files[i]);
+    }
+
+    for (int done = 0; done < FILE_SECTORS; done += step)
+    {
+        for (int i = 0; i < nfiles; i++)
+        {
+            for (int j = 0; j < step; j++)
+            {
+                memset(buf, done + j, sizeof (buf));
+                if (fat_readwrite(&str[i], 1, buf, true) != 1)
+                    panicf("write failed\n");
+            }
+        }
+    }
+
+    for (int i = 0; i < nfiles; i++)
+        fat_closewrite(&str[i], FILE_SECTORS * SECTOR_SIZE, NULL);
+}
+
+static void bench_read(const char *name, struct fat_file *file,
+                       unsigned long chunk)
+{
+    static unsigned char buf[FILE_SECTORS * SECTOR_SIZE];
+    struct fat_filestr str;
+
+    memset(&stats, 0, sizeof (stats));
+    double t = now();
+
+    for (int r = 0; r < READ_REPEAT; r++)
+    {
+        fat_filestr_init(&str, file);
+        for (unsigned long done = 0; done < FILE_SECTORS; done += chunk)
+        {
+            long count = MIN(chunk, FILE_SECTORS - done);
+            if (fat_readwrite(&str, count, buf + done * SECTOR_SIZE, false)
+                    != count)
+                panicf("read failed\n");
+        }
+    }
+
+    /* write_files() marks each sector with its number */
+    for (unsigned long i = 0; i < FILE_SECTORS; i++)
+    {
+        if (buf[i * SECTOR_SIZE] != (unsigned char)i)
+            panicf("%s: sector %lu has wrong data\n", name, i);
+    }
+
+    t = now() - t;
+    double mb = (double)READ_REPEAT * FILE_SECTORS * SECTOR_SIZE / 1048576;
+    printf("%-12s chunk %5lu: %7.1f MB/s, %6.1f transfers/MB, "
+           "%5.1f sectors/transfer (max %lu)\n",
+           name, chunk, mb / t, stats.calls / mb,
+           (double)stats.sectors / stats.calls, stats.maxcount);
+}
+
+static void bench_seek(const char *name, struct fat_file *file)
+{
+    static unsigned char buf[SECTOR_SIZE];
+    struct fat_filestr str;
+    fat_filestr_init(&str, file);
+    srand(1);
+
+    double t = now();
+
+    for (int i = 0; i < SEEK_COUNT; i++)
+    {
+        unsigned long sector = rand() % FILE_SECTORS;
+        if (fat_seek(&str, sector) < 0 ||
+            fat_readwrite(&str, 1, buf, false) != 1)
+            panicf("seek failed\n");
+
+        if (buf[0] != (unsigned char)sector)
+            panicf("%s: seek to sector %lu read the wrong data\n", name,
+                   sector);
+    }
+
+    t = now() - t;
+    printf("%-12s random seek + read: %6.2f us\n", name,
+           t * 1e6 / SEEK_COUNT);
+}
+
+static void bench_fill(void)
+{
+    static unsigned char buf[SECTOR_SIZE];
+    struct fat_file file;
+    struct fat_filestr str;
+    memset(&file, 0, sizeof (file));
+    fat_filestr_init(&str, &file);
+
+    double t = now();
+    unsigned long sectors = 0;
+
+    while (fat_readwrite(&str, 1, buf, true) == 1)
+        sectors++;
+
+    t = now() - t;
+    printf("fill         %lu clusters: %6.2f us per cluster\n",
+           sectors / SECPERCLUS, t * 1e6 * SECPERCLUS / sectors);
+
+    /* every further write has to look for a free cluster and fail */
+    t = now();
+
+    for (int i = 0; i < FULL_COUNT; i++)
+    {
+        if (fat_readwrite(&str, 1, buf, true) == 1)
+            panicf("wrote to a full volume\n");
+    }
+
+    t = now() - t;
+    printf("full volume  failed write: %6.2f us\n", t * 1e6 / FULL_COUNT);
+}
+
+int main(void)
+{
+    dc_init();
+    fat_init();
+    format();
+
+    if (fat_mount(IF_MV(0,) IF_MD(0,) 0) < 0)
+        panicf("mount failed\n");
+
+    struct fat_file contig, frag[2];
+    write_files(&contig, 1, SECPERCLUS);
+    write_files(frag, 2, SECPERCLUS);
+
+    static const unsigned long chunks[] = { 1, 13, 128, 2048 };
+    for (unsigned int i = 0; i < sizeof (chunks) / sizeof (chunks[0]); i++)
+    {
+        bench_read("contiguous", &contig, chunks[i]);
+        bench_read("fragmented", &frag[0], chunks[i]);
+    }
+
+    bench_seek("contiguous", &contig);
+    bench_seek("fragmented", &frag[0]);
+
+    bench_fill();
+
+    struct dc_stats dcs;
+    dc_get_stats(&dcs);
+    printf("disk cache   %lu hits, %lu misses, %lu sectors written back "
+           "in %lu writes\n", dcs.hits, dcs.misses, dcs.writebacks,
+           dcs.writes);
+
+    fat_unmount(IF_MV(0));
+    return 0;
+}
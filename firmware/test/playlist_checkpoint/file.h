@@ -0,0 +1,39 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ * Host stand-in for the Rockbox file API used by apps/playlist_checkpoint.c.
+ * write() and rename() go through the test so that it can stop the program
+ * at any byte, like a crash or a pulled battery would.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef _TEST_FILE_H_
+#define _TEST_FILE_H_
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define MAX_PATH 260
+
+off_t filesize(int fd);
+ssize_t test_write(int fd, const void *buf, size_t count);
+int test_rename(const char *old, const char *new);
+
+#define write  test_write
+#define rename test_rename
+
+#endif /* _TEST_FILE_H_ */
@@ -0,0 +1,467 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ * Crash consistency test of the playlist checkpoint (apps/playlist_checkpoint.c).
+ *
+ * A model playlist is edited the way the current playlist is: every edit
+ * appends a command to a control file, every few commands the control file
+ * is synced and a checkpoint is written to a temporary file that is renamed
+ * into place, and now and then the control file is rewritten from scratch
+ * after removing the checkpoint. The whole session is run again with the
+ * program stopped at every write boundary and in the middle of every write,
+ * then the control file and the checkpoint are truncated at every length.
+ * Each time, resuming from the checkpoint and the rest of the control file
+ * must give the same playlist as replaying the whole control file.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <sys/stat.h>
+#include "file.h"
+#include "playlist_checkpoint.h"
+
+#undef write
+#undef rename
+
+#define WORK_DIR        "work"
+#define CONTROL_FILE    WORK_DIR "/control"
+#define CHECKPOINT_FILE WORK_DIR "/checkpoint"
+#define TEMP_FILE       CHECKPOINT_FILE "_temp"
+#define STALE_FILE      WORK_DIR "/stale"
+
+#define MAX_TRACKS          700
+#define SESSION_STEPS       300
+#define CHECKPOINT_COMMANDS 8   /* 64 in playlist.c */
+#define REWRITE_STEPS       120 /* rewrite the control file this often */
+
+struct state
+{
+    unsigned long indices[MAX_TRACKS];
+    int amount;
+    int index;  /* last position edited, stands in for the other fields */
+};
+
+/* bytes that may still be written before the program "crashes", or -1 */
+static long budget = -1;
+static long written;
+static jmp_buf crash;
+
+/* start of every write of the session without a crash, for crash points */
+static long write_start[1 << 14];
+static long write_len[1 << 14];
+static int  writes;
+static bool record;
+
+static unsigned int rand_state;
+
+static int rnd(int n)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return (rand_state >> 8) % n;
+}
+
+off_t filesize(int fd)
+{
+    struct stat st;
+    return fstat(fd, &st) < 0 ? -1 : st.st_size;
+}
+
+ssize_t test_write(int fd, const void *buf, size_t count)
+{
+    size_t n = count;
+
+    if (record && writes < (int)(sizeof (write_start) / sizeof (long)))
+    {
+        write_start[writes] = written;
+        write_len[writes++] = count;
+    }
+
+    if (budget >= 0 && (long)n > budget)
+        n = budget;
+
+    ssize_t ret = n > 0 ? write(fd, buf, n) : 0;
+    if (ret > 0)
+    {
+        written += ret;
+        if (budget >= 0)
+            budget -= ret;
+    }
+
+    if (n < count)
+        longjmp(crash, 1);
+
+    return ret;
+}
+
+/* renaming counts as one byte */
+int test_rename(const char *old, const char *new)
+{
+    if (record && writes < (int)(sizeof (write_start) / sizeof (long)))
+    {
+        write_start[writes] = written;
+        write_len[writes++] = 1;
+    }
+
+    if (budget == 0)
+        longjmp(crash, 1);
+    if (budget > 0)
+        budget--;
+
+    written++;
+    return rename(old, new);
+}
+
+/* apply one command line, as resuming does */
+static void apply(struct state *s, const char *line)
+{
+    int pos, seed;
+    unsigned long val;
+
+    if (sscanf(line, "A:%d:%lu", &pos, &val) == 2)
+    {
+        memmove(&s->indices[pos + 1], &s->indices[pos],
+                (s->amount - pos) * sizeof (s->indices[0]));
+        s->indices[pos] = val;
+        s->amount++;
+        s->index = pos;
+    }
+    else if (sscanf(line, "D:%d", &pos) == 1)
+    {
+        s->amount--;
+        memmove(&s->indices[pos], &s->indices[pos + 1],
+                (s->amount - pos) * sizeof (s->indices[0]));
+        s->index = pos;
+    }
+    else if (sscanf(line, "S:%d", &seed) == 1)
+    {
+        unsigned int r = seed;
+        for (int i = s->amount - 1; i > 0; i--)
+        {
+            r = r * 1103515245 + 12345;
+            int j = (r >> 8) % (i + 1);
+            unsigned long t = s->indices[i];
+            s->indices[i] = s->indices[j];
+            s->indices[j] = t;
+        }
+        s->index = 0;
+    }
+}
+
+/* replay the complete lines of the control file from pos on */
+static void replay(int fd, uint32_t pos, struct state *s)
+{
+    static char buf[1 << 20];
+    off_t size = filesize(fd);
+    char *line, *end;
+
+    lseek(fd, 0, SEEK_SET);
+    if (size < 0 || read(fd, buf, size) != size)
+    {
+        printf("can't read the control file\n");
+        exit(1);
+    }
+
+    for (line = &buf[pos]; (end = memchr(line, '\n', &buf[size] - line));
+         line = end + 1)
+    {
+        *end = '\0';
+        apply(s, line);
+    }
+}
+
+static void command(int fd, struct state *s, const char *fmt, int a, int b)
+{
+    char line[32];
+    int len = snprintf(line, sizeof (line), fmt, a, b);
+
+    apply(s, line);
+    test_write(fd, line, len);
+}
+
+static void checkpoint(int fd, const struct state *s)
+{
+    struct playlist_checkpoint cp;
+    volatile unsigned long *indices = (volatile unsigned long *)s->indices;
+
+    /* the session is stopped, not powered off, so fsync() changes nothing */
+    memset(&cp, 0, sizeof (cp));
+    cp.amount = s->amount;
+    cp.index = s->index;
+
+    if (playlist_checkpoint_mark(&cp, fd) &&
+        playlist_checkpoint_write(TEMP_FILE, &cp, &indices))
+        test_rename(TEMP_FILE, CHECKPOINT_FILE);
+    else
+        remove(TEMP_FILE);
+}
+
+/* write the control file again from the state, like recreate_control() */
+static int rewrite(int fd, const struct state *s)
+{
+    struct state copy = { .amount = 0 };
+
+    remove(CHECKPOINT_FILE);
+    close(fd);
+    fd = open(CONTROL_FILE, O_CREAT|O_RDWR|O_TRUNC, 0666);
+
+    for (int i = 0; i < s->amount; i++)
+        command(fd, &copy, "A:%d:%d\n", i, s->indices[i]);
+
+    return fd;
+}
+
+/* one editing session; stops early when the budget runs out */
+static void session(void)
+{
+    static struct state s;
+    int commands = 0;
+    int fd = -1;
+
+    rand_state = 1;
+    s.amount = 0;
+    s.index = 0;
+
+    if (setjmp(crash))
+    {
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    remove(CHECKPOINT_FILE);
+    remove(TEMP_FILE);
+    fd = open(CONTROL_FILE, O_CREAT|O_RDWR|O_TRUNC, 0666);
+
+    for (int step = 0; step < SESSION_STEPS; step++)
+    {
+        int op = rnd(8);
+
+        if (step % REWRITE_STEPS == REWRITE_STEPS - 1)
+        {
+            fd = rewrite(fd, &s);
+            commands = 0;
+        }
+
+        if ((op < 5 || s.amount == 0) && s.amount < MAX_TRACKS)
+            command(fd, &s, "A:%d:%d\n", rnd(s.amount + 1), rnd(100000));
+        else if (op < 7 && s.amount > 0)
+            command(fd, &s, "D:%d\n", rnd(s.amount), 0);
+        else
+            command(fd, &s, "S:%d\n", rnd(1 << 30), 0);
+
+        if (++commands >= CHECKPOINT_COMMANDS)
+        {
+            checkpoint(fd, &s);
+            commands = 0;
+        }
+    }
+
+    close(fd);
+}
+
+static int checkpoints_used, failures;
+
+/* resume from the checkpoint if there's a usable one and compare the result
+   with a replay of the whole control file; returns true if it was used */
+static bool check(const char *what, long n)
+{
+    static struct state full, resumed;
+    struct playlist_checkpoint cp;
+    volatile unsigned long *indices = resumed.indices;
+    uint32_t pos = 0;
+
+    int fd = open(CONTROL_FILE, O_RDONLY);
+    if (fd < 0)
+        return false; /* crashed before creating it */
+
+    memset(&full, 0, sizeof (full));
+    memset(&resumed, 0, sizeof (resumed));
+    replay(fd, 0, &full);
+
+    int cp_fd = playlist_checkpoint_open(CHECKPOINT_FILE, &cp, fd, MAX_TRACKS);
+    if (cp_fd >= 0)
+    {
+        if (playlist_checkpoint_read_indices(cp_fd, &cp, &indices))
+        {
+            resumed.amount = cp.amount;
+            resumed.index = cp.index;
+            pos = cp.control_size;
+        }
+        close(cp_fd);
+    }
+
+    replay(fd, pos, &resumed);
+    close(fd);
+
+    if (full.amount != resumed.amount || full.index != resumed.index ||
+        memcmp(full.indices, resumed.indices,
+               full.amount * sizeof (full.indices[0])))
+    {
+        printf("%s %ld: resuming from control file byte %u gives %d tracks, "
+               "replaying all of it %d\n", what, n, (unsigned)pos,
+               resumed.amount, full.amount);
+        failures++;
+    }
+
+    if (pos > 0)
+        checkpoints_used++;
+
+    return pos > 0;
+}
+
+static void copy_file(const char *from, const char *to, off_t len)
+{
+    static char buf[1 << 20];
+    int in = open(from, O_RDONLY);
+    int out = open(to, O_CREAT|O_WRONLY|O_TRUNC, 0666);
+    ssize_t n = read(in, buf, len);
+
+    if (n < 0 || write(out, buf, n) != n)
+        exit(1);
+
+    close(in);
+    close(out);
+}
+
+int main(void)
+{
+    int crashes = 0, truncations = 0;
+
+    mkdir(WORK_DIR, 0777);
+
+    /* a whole session, noting where every write starts */
+    record = true;
+    session();
+    record = false;
+
+    long total = written;
+    int cp_size, control_size;
+    {
+        struct stat st;
+        stat(CHECKPOINT_FILE, &st);
+        cp_size = st.st_size;
+        stat(CONTROL_FILE, &st);
+        control_size = st.st_size;
+    }
+
+    if (!check("session", total))
+    {
+        printf("no checkpoint at the end of the session\n");
+        return 1;
+    }
+
+    /* the same session, stopped at the start, after the first byte, in the
+       middle and before the last byte of every write */
+    for (int w = 0; w < writes; w++)
+    {
+        long at[4] = { write_start[w], write_start[w] + 1,
+                       write_start[w] + write_len[w] / 2,
+                       write_start[w] + write_len[w] - 1 };
+
+        for (int i = 0; i < 4; i++)
+        {
+            if (at[i] >= total || (i > 0 && at[i] <= at[i - 1]))
+                continue;
+
+            budget = at[i];
+            written = 0;
+            session();
+            budget = -1;
+            check("crash at byte", at[i]);
+            crashes++;
+        }
+    }
+
+    /* a control file that lost its end, with the checkpoint of the
+       complete session */
+    written = 0;
+    session();
+    copy_file(CONTROL_FILE, STALE_FILE, control_size);
+    for (int len = control_size; len >= 0; len--)
+    {
+        copy_file(STALE_FILE, CONTROL_FILE, len);
+        check("control file cut to", len);
+        truncations++;
+    }
+    copy_file(STALE_FILE, CONTROL_FILE, control_size);
+
+    /* a checkpoint that lost its end or has a byte changed */
+    copy_file(CHECKPOINT_FILE, STALE_FILE, cp_size);
+    for (int len = 0; len < cp_size; len++)
+    {
+        copy_file(STALE_FILE, CHECKPOINT_FILE, len);
+        if (check("checkpoint cut to", len))
+        {
+            printf("checkpoint cut to %d bytes was used\n", len);
+            failures++;
+        }
+        truncations++;
+    }
+    for (int at = sizeof (struct playlist_checkpoint); at < cp_size; at++)
+    {
+        int fd;
+        unsigned char c;
+
+        copy_file(STALE_FILE, CHECKPOINT_FILE, cp_size);
+        fd = open(CHECKPOINT_FILE, O_RDWR);
+        pread(fd, &c, 1, at);
+        c ^= 0x10;
+        pwrite(fd, &c, 1, at);
+        close(fd);
+
+        if (check("checkpoint changed at", at))
+        {
+            printf("checkpoint changed at byte %d was used\n", at);
+            failures++;
+        }
+    }
+
+    /* a checkpoint left behind from before the control file was rewritten */
+    {
+        int fd = open(CONTROL_FILE, O_RDWR);
+        struct state s;
+
+        /* long enough to cover the old checkpoint */
+        memset(&s, 0, sizeof (s));
+        replay(fd, 0, &s);
+        while (s.amount < MAX_TRACKS)
+            s.indices[s.amount++] = 1;
+        fd = rewrite(fd, &s);
+        close(fd);
+        copy_file(STALE_FILE, CHECKPOINT_FILE, cp_size);
+
+        if (check("rewritten control file", 0))
+        {
+            printf("checkpoint of the old control file was used\n");
+            failures++;
+        }
+    }
+
+    remove(CONTROL_FILE);
+    remove(CHECKPOINT_FILE);
+    remove(TEMP_FILE);
+    remove(STALE_FILE);
+    rmdir(WORK_DIR);
+
+    printf("%d writes, %d crashes, %d truncations, %d resumed from a "
+           "checkpoint: %s\n", writes, crashes, truncations,
+           checkpoints_used, failures ? "FAILED" : "passed");
+
+    return failures ? 1 : 0;
+}
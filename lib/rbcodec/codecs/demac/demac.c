@@ -50,8 +50,10 @@ avoided by writing the decoded data one sample at a time.
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 
 #include "demac.h"
+#include "filter.h"
 #include "wavwrite.h"
 
 #ifndef __WIN32__
@@ -257,12 +259,107 @@ int ape_decode(char* infile, char* outfile)
         return 0;
 }
 
+/* Filter benchmark - run the filters of each compression level over
+   synthetic residuals and print their throughput, with a checksum of the
+   output so that builds with different vector math can be compared. */
+
+#define BENCH_SAMPLES   (44100*10)  /* 10 seconds per channel */
+#define BENCH_VERSION   3990
+
+static filter_int benchbuf16[(16*3 + FILTER_HISTORY_SIZE) * 2];
+static filter_int benchbuf32[(32*3 + FILTER_HISTORY_SIZE) * 2];
+static filter_int benchbuf64[(64*3 + FILTER_HISTORY_SIZE) * 2];
+static filter_int benchbuf256[(256*3 + FILTER_HISTORY_SIZE) * 2];
+static filter_int benchbuf1280[(1280*3 + FILTER_HISTORY_SIZE) * 2];
+
+static void bench_filters(int level, int channel, int32_t* data, int count)
+{
+    /* Same order as decode_chunk() */
+    switch (level)
+    {
+        case 2000:
+            apply_filter_16_11(BENCH_VERSION,channel,data,count);
+            break;
+
+        case 3000:
+            apply_filter_64_11(BENCH_VERSION,channel,data,count);
+            break;
+
+        case 4000:
+            apply_filter_32_10(BENCH_VERSION,channel,data,count);
+            apply_filter_256_13(BENCH_VERSION,channel,data,count);
+            break;
+
+        case 5000:
+            apply_filter_16_11(BENCH_VERSION,channel,data,count);
+            apply_filter_256_13(BENCH_VERSION,channel,data,count);
+            apply_filter_1280_15(BENCH_VERSION,channel,data,count);
+            break;
+    }
+}
+
+static void filter_bench(void)
+{
+    int level, ch, n, i;
+    uint32_t seed, sum;
+    clock_t start;
+    double secs;
+
+    for (level = 2000; level <= 5000; level += 1000)
+    {
+        init_filter_16_11(benchbuf16);
+        init_filter_32_10(benchbuf32);
+        init_filter_64_11(benchbuf64);
+        init_filter_256_13(benchbuf256);
+        init_filter_1280_15(benchbuf1280);
+
+        seed = 1;
+        sum = 0;
+        secs = 0;
+
+        for (n = 0; n < BENCH_SAMPLES; n += BLOCKS_PER_LOOP)
+        {
+            int count = MIN(BLOCKS_PER_LOOP, BENCH_SAMPLES - n);
+
+            for (ch = 0; ch < 2; ch++)
+            {
+                int32_t* data = ch ? decoded1 : decoded0;
+
+                /* Small residuals with some zeros, as after the predictor */
+                for (i = 0; i < count; i++)
+                {
+                    seed = seed * 1664525 + 1013904223;
+                    data[i] = (seed >> 28) ? ((int32_t)seed >> 21) : 0;
+                }
+
+                start = clock();
+                bench_filters(level, ch, data, count);
+                secs += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+                for (i = 0; i < count; i++)
+                    sum = (sum << 1 | sum >> 31) ^ (uint32_t)data[i];
+            }
+        }
+
+        printf("level %d: %8.2f Msamples/s, %7.1fx realtime, checksum %08lx\n",
+               level, secs > 0 ? 2.0 * BENCH_SAMPLES / secs / 1e6 : 0,
+               secs > 0 ? BENCH_SAMPLES / 44100.0 / secs : 0,
+               (unsigned long)sum);
+    }
+}
+
 int main(int argc, char* argv[])
 {
     int res;
 
+    if (argc == 2 && !strcmp(argv[1], "-b")) {
+        filter_bench();
+        return 0;
+    }
+
     if (argc != 3) {
-        fprintf(stderr,"Usage: demac infile.ape outfile.wav\n");
+        fprintf(stderr,"Usage: demac infile.ape outfile.wav\n"
+                       "       demac -b (filter benchmark)\n");
         return 0;
     }        
 
@@ -48,9 +48,17 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
 #elif defined(CPU_ARM) && (ARM_ARCH >= 5)
 /* Assume all our ARMv5 targets are ARMv5te(j) */
 #include "vector_math16_armv5te.h"
-#elif (defined(__i386__) || defined(__i486__))  && defined(__MMX__) \
-    || defined(__x86_64__)
+#elif defined(__AVX2__)
+#include "vector_math16_avx2.h"
+#elif defined(__SSE2__)
+/* Includes all x86_64 */
+#include "vector_math16_sse2.h"
+#elif (defined(__i386__) || defined(__i486__)) && defined(__MMX__)
 #include "vector_math16_mmx.h"
+#elif defined(__aarch64__) && defined(__ARM_NEON) && defined(DEMAC_NEON64)
+/* Untested, opt in with -DDEMAC_NEON64. It can become the default once
+   "demac -b" gives f663921b, 03950374, 76d4209c and 645fb270 with it */
+#include "vector_math16_neon64.h"
 #else
 #include "vector_math_generic.h"
 #endif
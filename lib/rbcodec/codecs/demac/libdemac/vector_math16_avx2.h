@@ -0,0 +1,90 @@
+/*
+
+libdemac - A Monkey's Audio decoder
+
+$Id$
+
+Copyright (C) Dave Chapman 2007
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+*/
+
+/* AVX2 vector math, 16 taps per register. All vectors are read unaligned,
+   as for SSE2. */
+
+#include <immintrin.h>
+
+#define FUSED_VECTOR_MATH
+
+static inline int32_t vector_sp_sum(__m256i acc)
+{
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+/* Calculate scalarproduct, then add a 2nd vector (fused for performance) */
+static inline int32_t vector_sp_add(int16_t* v1, int16_t* f2, int16_t* s2)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int i;
+
+    for (i = 0; i < ORDER; i += 16)
+    {
+        __m256i c = _mm256_loadu_si256((__m256i *)(v1 + i));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(c,
+                  _mm256_loadu_si256((__m256i *)(f2 + i))));
+        _mm256_storeu_si256((__m256i *)(v1 + i), _mm256_add_epi16(c,
+            _mm256_loadu_si256((__m256i *)(s2 + i))));
+    }
+
+    return vector_sp_sum(acc);
+}
+
+/* Calculate scalarproduct, then subtract a 2nd vector (fused for performance) */
+static inline int32_t vector_sp_sub(int16_t* v1, int16_t* f2, int16_t* s2)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int i;
+
+    for (i = 0; i < ORDER; i += 16)
+    {
+        __m256i c = _mm256_loadu_si256((__m256i *)(v1 + i));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(c,
+                  _mm256_loadu_si256((__m256i *)(f2 + i))));
+        _mm256_storeu_si256((__m256i *)(v1 + i), _mm256_sub_epi16(c,
+            _mm256_loadu_si256((__m256i *)(s2 + i))));
+    }
+
+    return vector_sp_sum(acc);
+}
+
+static inline int32_t scalarproduct(int16_t* v1, int16_t* v2)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int i;
+
+    for (i = 0; i < ORDER; i += 16)
+    {
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(
+                  _mm256_loadu_si256((__m256i *)(v1 + i)),
+                  _mm256_loadu_si256((__m256i *)(v2 + i))));
+    }
+
+    return vector_sp_sum(acc);
+}
@@ -0,0 +1,85 @@
+/*
+
+libdemac - A Monkey's Audio decoder
+
+$Id$
+
+Copyright (C) Dave Chapman 2007
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+*/
+
+/* AArch64 NEON vector math, 8 taps per register. vld1q/vst1q don't need
+   any alignment. Only used when DEMAC_NEON64 is defined, see filter.c */
+
+#include <arm_neon.h>
+
+#define FUSED_VECTOR_MATH
+
+/* Calculate scalarproduct, then add a 2nd vector (fused for performance) */
+static inline int32_t vector_sp_add(int16_t* v1, int16_t* f2, int16_t* s2)
+{
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+    int i;
+
+    for (i = 0; i < ORDER; i += 8)
+    {
+        int16x8_t c = vld1q_s16(v1 + i);
+        int16x8_t f = vld1q_s16(f2 + i);
+        acc0 = vmlal_s16(acc0, vget_low_s16(c), vget_low_s16(f));
+        acc1 = vmlal_high_s16(acc1, c, f);
+        vst1q_s16(v1 + i, vaddq_s16(c, vld1q_s16(s2 + i)));
+    }
+
+    return vaddvq_s32(vaddq_s32(acc0, acc1));
+}
+
+/* Calculate scalarproduct, then subtract a 2nd vector (fused for performance) */
+static inline int32_t vector_sp_sub(int16_t* v1, int16_t* f2, int16_t* s2)
+{
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+    int i;
+
+    for (i = 0; i < ORDER; i += 8)
+    {
+        int16x8_t c = vld1q_s16(v1 + i);
+        int16x8_t f = vld1q_s16(f2 + i);
+        acc0 = vmlal_s16(acc0, vget_low_s16(c), vget_low_s16(f));
+        acc1 = vmlal_high_s16(acc1, c, f);
+        vst1q_s16(v1 + i, vsubq_s16(c, vld1q_s16(s2 + i)));
+    }
+
+    return vaddvq_s32(vaddq_s32(acc0, acc1));
+}
+
+static inline int32_t scalarproduct(int16_t* v1, int16_t* v2)
+{
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+    int i;
+
+    for (i = 0; i < ORDER; i += 8)
+    {
+        int16x8_t c = vld1q_s16(v1 + i);
+        int16x8_t f = vld1q_s16(v2 + i);
+        acc0 = vmlal_s16(acc0, vget_low_s16(c), vget_low_s16(f));
+        acc1 = vmlal_high_s16(acc1, c, f);
+    }
+
+    return vaddvq_s32(vaddq_s32(acc0, acc1));
+}
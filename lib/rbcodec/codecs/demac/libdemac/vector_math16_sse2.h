@@ -0,0 +1,132 @@
+/*
+
+libdemac - A Monkey's Audio decoder
+
+$Id$
+
+Copyright (C) Dave Chapman 2007
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110, USA
+
+*/
+
+/* SSE2 vector math, 8 taps per register. The history and adaption vectors
+   move by one tap per sample and the filter buffers are only pointer
+   aligned in Rockbox, so all vectors are read unaligned. */
+
+#include <emmintrin.h>
+
+#define FUSED_VECTOR_MATH
+
+#if ORDER > 16
+#define SP_STEP 16  /* two registers per step, summed separately */
+#else
+#define SP_STEP 8
+#endif
+
+static inline int32_t vector_sp_sum(__m128i acc)
+{
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+}
+
+/* Calculate scalarproduct, then add a 2nd vector (fused for performance) */
+static inline int32_t vector_sp_add(int16_t* v1, int16_t* f2, int16_t* s2)
+{
+    __m128i acc0 = _mm_setzero_si128();
+#if SP_STEP > 8
+    __m128i acc1 = _mm_setzero_si128();
+#endif
+    int i;
+
+    for (i = 0; i < ORDER; i += SP_STEP)
+    {
+        __m128i c0 = _mm_loadu_si128((__m128i *)(v1 + i));
+        acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(c0,
+                   _mm_loadu_si128((__m128i *)(f2 + i))));
+        _mm_storeu_si128((__m128i *)(v1 + i), _mm_add_epi16(c0,
+            _mm_loadu_si128((__m128i *)(s2 + i))));
+#if SP_STEP > 8
+        __m128i c1 = _mm_loadu_si128((__m128i *)(v1 + i + 8));
+        acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(c1,
+                   _mm_loadu_si128((__m128i *)(f2 + i + 8))));
+        _mm_storeu_si128((__m128i *)(v1 + i + 8), _mm_add_epi16(c1,
+            _mm_loadu_si128((__m128i *)(s2 + i + 8))));
+#endif
+    }
+
+#if SP_STEP > 8
+    acc0 = _mm_add_epi32(acc0, acc1);
+#endif
+    return vector_sp_sum(acc0);
+}
+
+/* Calculate scalarproduct, then subtract a 2nd vector (fused for performance) */
+static inline int32_t vector_sp_sub(int16_t* v1, int16_t* f2, int16_t* s2)
+{
+    __m128i acc0 = _mm_setzero_si128();
+#if SP_STEP > 8
+    __m128i acc1 = _mm_setzero_si128();
+#endif
+    int i;
+
+    for (i = 0; i < ORDER; i += SP_STEP)
+    {
+        __m128i c0 = _mm_loadu_si128((__m128i *)(v1 + i));
+        acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(c0,
+                   _mm_loadu_si128((__m128i *)(f2 + i))));
+        _mm_storeu_si128((__m128i *)(v1 + i), _mm_sub_epi16(c0,
+            _mm_loadu_si128((__m128i *)(s2 + i))));
+#if SP_STEP > 8
+        __m128i c1 = _mm_loadu_si128((__m128i *)(v1 + i + 8));
+        acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(c1,
+                   _mm_loadu_si128((__m128i *)(f2 + i + 8))));
+        _mm_storeu_si128((__m128i *)(v1 + i + 8), _mm_sub_epi16(c1,
+            _mm_loadu_si128((__m128i *)(s2 + i + 8))));
+#endif
+    }
+
+#if SP_STEP > 8
+    acc0 = _mm_add_epi32(acc0, acc1);
+#endif
+    return vector_sp_sum(acc0);
+}
+
+static inline int32_t scalarproduct(int16_t* v1, int16_t* v2)
+{
+    __m128i acc0 = _mm_setzero_si128();
+#if SP_STEP > 8
+    __m128i acc1 = _mm_setzero_si128();
+#endif
+    int i;
+
+    for (i = 0; i < ORDER; i += SP_STEP)
+    {
+        acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(
+                   _mm_loadu_si128((__m128i *)(v1 + i)),
+                   _mm_loadu_si128((__m128i *)(v2 + i))));
+#if SP_STEP > 8
+        acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(
+                   _mm_loadu_si128((__m128i *)(v1 + i + 8)),
+                   _mm_loadu_si128((__m128i *)(v2 + i + 8))));
+#endif
+    }
+
+#if SP_STEP > 8
+    acc0 = _mm_add_epi32(acc0, acc1);
+#endif
+    return vector_sp_sum(acc0);
+}
@@ -34,6 +34,28 @@ static int32_t decoded3[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_LARGE_IRAM;
 static int32_t decoded4[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_XLARGE_IRAM;
 static int32_t decoded5[MAX_BLOCKSIZE] IBSS_ATTR_FLAC_XLARGE_IRAM;
 
+#ifdef HAVE_CODEC_WORKER
+/* Decode each mono or stereo frame on the worker (the COP, or another host
+   core) while the previous one goes through pcmbuf_insert() and the DSP on
+   the codec thread. The frames alternate between fc and fc_ahead, each with
+   its own output buffers. fc and decoded0/1 are in IRAM, which both PP
+   cores see uncached; fc_ahead and job are shared uncached too. ahead0/1
+   are only read by the CPU and fill whole cache lines, so the commit and
+   discard around a job can't clobber anything next to them. */
+#define FLAC_DECODE_AHEAD
+
+static FLACContext fc_ahead SHAREDBSS_ATTR;
+static int32_t ahead0[MAX_BLOCKSIZE] CACHEALIGN_ATTR;
+static int32_t ahead1[MAX_BLOCKSIZE] CACHEALIGN_ATTR;
+
+static struct decode_job {
+    FLACContext *fc;
+    int8_t *buf;
+    size_t size;
+    int res;
+} job SHAREDBSS_ATTR;
+#endif
+
 #define MAX_SUPPORTED_SEEKTABLE_SIZE 5000
 
 /* Notes about seeking:
@@ -74,6 +96,36 @@ struct FLACseekpoints {
 static struct FLACseekpoints seekpoints[MAX_SUPPORTED_SEEKTABLE_SIZE];
 static int nseekpoints;
 
+#define FRAME_INDEX_SIZE 4096
+
+/* Notes about the frame index:
+
+   Many files have no seek table, or only a point every 10 seconds, so the
+   bisection in flac_seek() has to probe the stream several times. To
+   avoid that, the file offset of every frame that is played is remembered
+   in an index kept in the codec buffer for the rest of the track.
+
+   The index is direct-mapped: the track is split into FRAME_INDEX_SIZE
+   equal spans of samples and each slot keeps the earliest frame played
+   that starts in its span. Seeks use the closest known frames around the
+   target as exact bounds for the bisection, so seeking back into a part
+   that has been played lands on the right frame or decodes forward from
+   a frame just before it. Frames only found while seeking aren't indexed,
+   a false sync could otherwise mislead every later seek.
+
+   The index takes 4096*8=32768 bytes. A 4 minute 44.1KHz track has one slot per
+   frame at the reference encoder's blocksize of 4096. Streams that don't
+   give their total number of samples aren't indexed.
+*/
+
+struct FLACframe {
+    uint32_t sample;
+    uint32_t offset;    /* 0 for an empty slot */
+};
+
+static struct FLACframe *frame_index;
+static uint32_t frame_index_span;
+
 static int8_t *bit_buffer;
 static size_t buff_size;
 
@@ -202,14 +254,90 @@ static bool flac_init(FLACContext* fc, int first_frame_offset)
     }
 
    if (found_streaminfo) {
-       fc->bitrate = ((int64_t) (fc->filesize-fc->metadatalength) * 8) 
-                     / fc->length;
+       /* no length when STREAMINFO leaves the total samples unknown */
+       if (fc->length > 0)
+           fc->bitrate = ((int64_t) (fc->filesize-fc->metadatalength) * 8)
+                         / fc->length;
        return true;
    } else {
        return false;
    }
 }
 
+static void frame_index_init(FLACContext* fc)
+{
+    frame_index = NULL;
+    if (fc->totalsamples == 0)
+        return;
+
+    frame_index = malloc(FRAME_INDEX_SIZE * sizeof(struct FLACframe));
+    if (frame_index == NULL)
+        return;
+
+    ci->memset(frame_index, 0, FRAME_INDEX_SIZE * sizeof(struct FLACframe));
+    frame_index_span = fc->totalsamples / FRAME_INDEX_SIZE + 1;
+}
+
+/* Remember the frame starting at sample from file offset */
+static void frame_index_add(uint32_t sample, uint32_t offset)
+{
+    struct FLACframe *f;
+    uint32_t slot;
+
+    if (frame_index == NULL)
+        return;
+
+    slot = sample / frame_index_span;
+    if (slot >= FRAME_INDEX_SIZE)
+        return;
+
+    f = &frame_index[slot];
+    if (f->offset == 0 || sample < f->sample) {
+        f->sample = sample;
+        f->offset = offset;
+    }
+}
+
+/* Narrow the bounds to the closest known frames around target_sample */
+static void frame_index_bounds(uint32_t target_sample,
+                               unsigned long *lower_bound,
+                               unsigned long *lower_bound_sample,
+                               unsigned long *upper_bound,
+                               unsigned long *upper_bound_sample)
+{
+    uint32_t slot;
+    int i;
+
+    if (frame_index == NULL)
+        return;
+
+    slot = target_sample / frame_index_span;
+    if (slot >= FRAME_INDEX_SIZE)
+        slot = FRAME_INDEX_SIZE-1;
+
+    for (i = slot; i >= 0; i--) {
+        struct FLACframe *f = &frame_index[i];
+        if (f->offset != 0 && f->sample <= target_sample) {
+            if (f->sample > *lower_bound_sample) {
+                *lower_bound = f->offset;
+                *lower_bound_sample = f->sample;
+            }
+            break;
+        }
+    }
+
+    for (i = slot; i < FRAME_INDEX_SIZE; i++) {
+        struct FLACframe *f = &frame_index[i];
+        if (f->offset != 0 && f->sample > target_sample) {
+            if (f->sample < *upper_bound_sample) {
+                *upper_bound = f->offset;
+                *upper_bound_sample = f->sample;
+            }
+            break;
+        }
+    }
+}
+
 /* Synchronize to next frame in stream - adapted from libFLAC 1.1.3b2 */
 static bool frame_sync(FLACContext* fc) {
     unsigned int x = 0;
@@ -287,7 +415,8 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
     lower_bound = fc->metadatalength;
     lower_bound_sample = 0;
     upper_bound = fc->filesize;
-    upper_bound_sample = fc->totalsamples>0 ? fc->totalsamples : target_sample;
+    /* past the target when the total is unknown, or 0 would be unreachable */
+    upper_bound_sample = fc->totalsamples>0 ? fc->totalsamples : target_sample+1;
 
     /* Refine the bounds if we have a seektable with suitable points. */
     if(nseekpoints > 0) {
@@ -312,6 +441,17 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
         }
     }
 
+    /* Refine them further with the frames seen so far. */
+    frame_index_bounds(target_sample, &lower_bound, &lower_bound_sample,
+                       &upper_bound, &upper_bound_sample);
+
+    /* Bounds are frame starts, decode forward from a close enough one. */
+    if(target_sample >= lower_bound_sample &&
+       target_sample - lower_bound_sample < 4*(unsigned)fc->max_blocksize) {
+        pos = (off_t)lower_bound;
+        needs_seek = false;
+    }
+
     while(1) {
         /* Check if bounds are still ok. */
         if(lower_bound_sample >= upper_bound_sample ||
@@ -399,6 +539,7 @@ static bool flac_seek(FLACContext* fc, uint32_t target_sample) {
         if(target_sample < this_frame_sample) {
             upper_bound_sample = this_frame_sample;
             upper_bound = ci->curpos;
+            needs_seek = true;
         }
         else { /* Target is beyond this frame. */
             /* We are close, continue in decoding next frames. */
@@ -440,6 +581,42 @@ static bool flac_seek_offset(FLACContext* fc, uint32_t offset) {
     return true;
 }
 
+#ifdef FLAC_DECODE_AHEAD
+static void decode_job(void *arg)
+{
+    struct decode_job *j = arg;
+    j->res = flac_decode_frame(j->fc, j->buf, j->size, codec_worker_yield);
+}
+
+/* Copy the stream state of one context to the other, leaving each with its
+   own output buffers */
+static void context_copy(FLACContext *dst, const FLACContext *src)
+{
+    int32_t *decoded[MAX_CHANNELS];
+
+    ci->memcpy(decoded, dst->decoded, sizeof(decoded));
+    *dst = *src;
+    ci->memcpy(dst->decoded, decoded, sizeof(decoded));
+}
+
+/* Start decoding the frame in buf on the worker, following the one just
+   decoded into 'cur'. Returns the context it is decoded into. */
+static FLACContext *decode_ahead_start(FLACContext *cur, int8_t *buf,
+                                       size_t size)
+{
+    FLACContext *next = (cur == &fc) ? &fc_ahead : &fc;
+
+    context_copy(next, cur);
+    next->sample_skip = 0;
+    job.fc = next;
+    job.buf = buf;
+    job.size = size;
+    codec_worker_submit(decode_job, &job);
+
+    return next;
+}
+#endif /* FLAC_DECODE_AHEAD */
+
 /* this is the codec entry point */
 enum codec_status codec_main(enum codec_entry_call_reason reason)
 {
@@ -462,6 +639,12 @@ enum codec_status codec_run(void)
     int res;
     int frame;
     intptr_t param;
+    FLACContext *cur;
+    bool ahead;
+#ifdef FLAC_DECODE_AHEAD
+    FLACContext *next = NULL;
+    bool decode_ahead;
+#endif
 
     if (codec_init()) {
         LOGF("FLAC: Error initialising codec\n");
@@ -477,6 +660,8 @@ enum codec_status codec_run(void)
         return CODEC_ERROR;
     }
 
+    frame_index_init(&fc);
+
     ci->configure(DSP_SET_FREQUENCY, ci->id3->frequency);
     ci->configure(DSP_SET_STEREO_MODE, fc.channels == 1 ?
                   STEREO_MONO : STEREO_NONINTERLEAVED);
@@ -496,6 +681,13 @@ enum codec_status codec_run(void)
 
     /* The main decoding loop */
     frame=0;
+    cur = &fc;
+    ahead = false;
+#ifdef FLAC_DECODE_AHEAD
+    decode_ahead = fc.channels <= 2 && codec_worker_create();
+    fc_ahead.decoded[0] = ahead0;
+    fc_ahead.decoded[1] = ahead1;
+#endif
     buf = ci->request_buffer(&bytesleft, MAX_FRAMESIZE);
     while (bytesleft) {
         long action = ci->get_command(&param);
@@ -505,6 +697,13 @@ enum codec_status codec_run(void)
 
         /* Deal with any pending seek requests */
         if (action == CODEC_ACTION_SEEK_TIME) {
+#ifdef FLAC_DECODE_AHEAD
+            /* seeking works on fc, and drops the frame decoded ahead */
+            if (cur != &fc)
+                context_copy(&fc, cur);
+            cur = &fc;
+            ahead = false;
+#endif
             if (flac_seek(&fc,(uint32_t)(((uint64_t)param
                 *ci->id3->frequency)/1000))) {
                 /* Refill the input buffer */
@@ -515,30 +714,55 @@ enum codec_status codec_run(void)
             ci->seek_complete();
         }
 
-        if((res=flac_decode_frame(&fc,buf,
+        if(!ahead && (res=flac_decode_frame(cur,buf,
                              bytesleft,ci->yield)) < 0) {
              LOGF("FLAC: Frame %d, error %d\n",frame,res);
+             codec_worker_quit();
              return CODEC_ERROR;
         }
-        consumed=fc.gb.index/8;
+        consumed=cur->gb.index/8;
         frame++;
 
+        frame_index_add(cur->samplenumber, ci->curpos);
+
+        ci->advance_buffer(consumed);
+
+        buf = ci->request_buffer(&bytesleft, MAX_FRAMESIZE);
+
+        ahead = false;
+#ifdef FLAC_DECODE_AHEAD
+        if (decode_ahead && bytesleft) {
+            next = decode_ahead_start(cur, buf, bytesleft);
+            ahead = true;
+        }
+#endif
+
         ci->yield();
-        ci->pcmbuf_insert(&fc.decoded[0][fc.sample_skip], &fc.decoded[1][fc.sample_skip],
-                          fc.blocksize - fc.sample_skip);
+        ci->pcmbuf_insert(&cur->decoded[0][cur->sample_skip],
+                          &cur->decoded[1][cur->sample_skip],
+                          cur->blocksize - cur->sample_skip);
         
-        fc.sample_skip = 0;
+        cur->sample_skip = 0;
 
         /* Update the elapsed-time indicator */
-        samplesdone=fc.samplenumber+fc.blocksize;
+        samplesdone=cur->samplenumber+cur->blocksize;
         elapsedtime=((uint64_t)samplesdone*1000)/(ci->id3->frequency);
         ci->set_elapsed(elapsedtime);
 
-        ci->advance_buffer(consumed);
-
-        buf = ci->request_buffer(&bytesleft, MAX_FRAMESIZE);
+#ifdef FLAC_DECODE_AHEAD
+        if (ahead) {
+            codec_worker_wait();
+            if ((res=job.res) < 0) {
+                LOGF("FLAC: Frame %d, error %d\n",frame,res);
+                codec_worker_quit();
+                return CODEC_ERROR;
+            }
+            cur = next;
+        }
+#endif
     }
 
+    codec_worker_quit();
     LOGF("FLAC: Decoded %lu samples\n",(unsigned long)samplesdone);
     return CODEC_OK;
 }
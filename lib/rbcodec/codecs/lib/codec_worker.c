@@ -0,0 +1,197 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Worker thread that runs one codec job at a time, so a codec can decode
+ * its next frame there while the codec thread passes the current one through
+ * pcmbuf_insert() and the DSP. That is the second core on dual core targets
+ * and a POSIX thread the host can run on another of its cores on hosted
+ * Linux builds. */
+
+#include "codeclib.h"
+
+#if NUM_CORES > 1
+
+static int worker_stack[DEFAULT_STACK_SIZE/sizeof(int)];
+static unsigned int worker_thread_id = 0;
+
+/* seen by both cores, so kept out of the caches */
+static struct semaphore job_pending SHAREDBSS_ATTR;
+static struct semaphore job_done SHAREDBSS_ATTR;
+static void (* volatile job_fn)(void *arg) SHAREDBSS_ATTR;
+static void * volatile job_arg SHAREDBSS_ATTR;
+static volatile bool worker_die SHAREDBSS_ATTR;
+
+static void worker_thread(void)
+{
+    while (1)
+    {
+        ci->semaphore_wait(&job_pending, TIMEOUT_BLOCK);
+
+        if (worker_die)
+            break;
+
+        /* the job's input was written by the other core */
+        ci->commit_discard_dcache();
+        job_fn(job_arg);
+        /* and its output is read there */
+        ci->commit_dcache();
+
+        ci->semaphore_release(&job_done);
+    }
+}
+
+bool codec_worker_create(void)
+{
+    ci->semaphore_init(&job_pending, 1, 0);
+    ci->semaphore_init(&job_done, 1, 0);
+    worker_die = false;
+
+    worker_thread_id = ci->create_thread(worker_thread, worker_stack,
+                                         sizeof(worker_stack), 0,
+                                         "codec worker"
+                                         IF_PRIO(, PRIORITY_PLAYBACK)
+                                         IF_COP(, COP));
+
+    return worker_thread_id != 0;
+}
+
+void codec_worker_submit(void (*fn)(void *arg), void *arg)
+{
+    job_fn = fn;
+    job_arg = arg;
+    /* write back the job's input for the worker */
+    ci->commit_dcache();
+    ci->semaphore_release(&job_pending);
+}
+
+void codec_worker_wait(void)
+{
+    ci->semaphore_wait(&job_done, TIMEOUT_BLOCK);
+    /* nothing the job wrote is dirty here, drop any stale copies of it */
+    ci->commit_discard_dcache();
+}
+
+void codec_worker_quit(void)
+{
+    if (worker_thread_id == 0)
+        return;
+
+    worker_die = true;
+    ci->semaphore_release(&job_pending);
+    ci->thread_wait(worker_thread_id);
+    worker_thread_id = 0;
+    ci->commit_discard_dcache();
+}
+
+#elif defined(HAVE_CODEC_WORKER)
+
+#include <pthread.h>
+#include <signal.h>
+
+static pthread_t worker_thread_id;
+static bool worker_running = false;
+
+/* job_pending and job_done are only changed with job_lock held, which also
+   orders the job's data between the threads */
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_cond = PTHREAD_COND_INITIALIZER;
+static bool job_pending, job_done;
+static void (*job_fn)(void *arg);
+static void *job_arg;
+static bool worker_die;
+
+static void * worker_thread(void *unused)
+{
+    (void)unused;
+
+    while (1)
+    {
+        pthread_mutex_lock(&job_lock);
+        while (!job_pending)
+            pthread_cond_wait(&job_cond, &job_lock);
+        job_pending = false;
+        pthread_mutex_unlock(&job_lock);
+
+        if (worker_die)
+            break;
+
+        job_fn(job_arg);
+
+        pthread_mutex_lock(&job_lock);
+        job_done = true;
+        pthread_cond_broadcast(&job_cond);
+        pthread_mutex_unlock(&job_lock);
+    }
+
+    return NULL;
+}
+
+bool codec_worker_create(void)
+{
+    sigset_t all, old;
+
+    job_pending = job_done = false;
+    worker_die = false;
+
+    /* the kernel's signals (tick, thread switches) are for the Rockbox
+       threads, keep the worker from ever taking one */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    worker_running = pthread_create(&worker_thread_id, NULL,
+                                    worker_thread, NULL) == 0;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    return worker_running;
+}
+
+void codec_worker_submit(void (*fn)(void *arg), void *arg)
+{
+    pthread_mutex_lock(&job_lock);
+    job_fn = fn;
+    job_arg = arg;
+    job_pending = true;
+    pthread_cond_broadcast(&job_cond);
+    pthread_mutex_unlock(&job_lock);
+}
+
+void codec_worker_wait(void)
+{
+    pthread_mutex_lock(&job_lock);
+    while (!job_done)
+        pthread_cond_wait(&job_cond, &job_lock);
+    job_done = false;
+    pthread_mutex_unlock(&job_lock);
+}
+
+void codec_worker_quit(void)
+{
+    if (!worker_running)
+        return;
+
+    pthread_mutex_lock(&job_lock);
+    worker_die = true;
+    job_pending = true;
+    pthread_cond_broadcast(&job_cond);
+    pthread_mutex_unlock(&job_lock);
+
+    pthread_join(worker_thread_id, NULL);
+    worker_running = false;
+}
+
+#endif /* HAVE_CODEC_WORKER */
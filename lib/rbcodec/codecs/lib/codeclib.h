@@ -152,6 +152,42 @@ static inline unsigned int bs_generic(unsigned int v, int mode)
 int codec_init(void);
 void codec_set_replaygain(const struct mp3entry *id3);
 
+/* Decode ahead on a worker (codec_worker.c): a submitted job runs there
+ * while the codec thread carries on, and the codec must not touch the job's
+ * data again until codec_worker_wait() returns. Only one job can be pending.
+ * The worker is the COP on dual core targets and a POSIX thread on hosted
+ * Linux builds, which is not a Rockbox thread, so a job must not call the
+ * kernel and yields through codec_worker_yield() only. Elsewhere the job
+ * runs inside submit. */
+#if NUM_CORES > 1 || \
+    ((CONFIG_PLATFORM & PLATFORM_HOSTED) && defined(__linux__))
+#define HAVE_CODEC_WORKER
+#endif
+
+#ifdef HAVE_CODEC_WORKER
+bool codec_worker_create(void);
+void codec_worker_submit(void (*fn)(void *arg), void *arg);
+void codec_worker_wait(void);
+void codec_worker_quit(void);
+#if NUM_CORES > 1
+#define codec_worker_yield ci->yield
+#else
+/* the other cores keep the codec thread running */
+static inline void codec_worker_yield(void)
+    { }
+#endif
+#else
+#define codec_worker_yield ci->yield
+static inline bool codec_worker_create(void)
+    { return true; }
+static inline void codec_worker_submit(void (*fn)(void *arg), void *arg)
+    { fn(arg); }
+static inline void codec_worker_wait(void)
+    { }
+static inline void codec_worker_quit(void)
+    { }
+#endif
+
 #ifdef RB_PROFILE
 void __cyg_profile_func_enter(void *this_fn, void *call_site)
     NO_PROF_ATTR ICODE_ATTR;
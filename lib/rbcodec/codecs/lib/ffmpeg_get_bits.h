@@ -88,13 +88,24 @@ static inline av_const int sign_extend(int val, unsigned bits)
 #   define ALT_BITSTREAM_READER
 #endif
 
+/* ROCKBOX: a codec can opt in to the 64-bit cached reader by defining
+ * CACHED_BITSTREAM_READER before including this file. It is only used
+ * where 64-bit shifts are cheap, everywhere else the ALT reader is kept. */
+#if defined(CACHED_BITSTREAM_READER) && \
+    !((CONFIG_PLATFORM & PLATFORM_HOSTED) || \
+      (defined(CPU_ARM) && ARM_ARCH >= 7))
+#   undef CACHED_BITSTREAM_READER
+#endif
+
 /*
 #if !defined(LIBMPEG2_BITSTREAM_READER) && !defined(A32_BITSTREAM_READER) && !defined(ALT_BITSTREAM_READER)
 #   if ARCH_ARM && !HAVE_FAST_UNALIGNED
 #       define A32_BITSTREAM_READER
 #   else
 */
+#ifndef CACHED_BITSTREAM_READER
 #       define ALT_BITSTREAM_READER
+#endif
 /*
 //#define LIBMPEG2_BITSTREAM_READER
 //#define A32_BITSTREAM_READER
@@ -108,6 +119,10 @@ typedef struct GetBitContext {
     const uint8_t *buffer, *buffer_end;
 #ifdef ALT_BITSTREAM_READER
     int index;
+#elif defined CACHED_BITSTREAM_READER
+    int index;
+    int cache_bits;
+    uint64_t cache;
 #elif defined LIBMPEG2_BITSTREAM_READER
     uint8_t *buffer_ptr;
     uint32_t cache;
@@ -244,6 +259,64 @@ static inline void skip_bits_long(GetBitContext *s, int n){
     s->index += n;
 }
 
+#elif defined CACHED_BITSTREAM_READER
+/* ROCKBOX: keeps up to 64 bits of the stream in the context and reloads
+ * them from the bit index only when fewer than 32 are left, so most reads
+ * are a compare, a shift and no load. index always counts the bits
+ * consumed, like with the ALT reader. */
+
+#   define MIN_CACHE_BITS 32
+
+#   define OPEN_READER(name, gb)\
+        unsigned int name##_index= (gb)->index;\
+        int name##_bits= (gb)->cache_bits;\
+        uint64_t name##_cache= (gb)->cache;\
+
+#   define CLOSE_READER(name, gb)\
+        (gb)->index= name##_index;\
+        (gb)->cache_bits= name##_bits;\
+        (gb)->cache= name##_cache;\
+
+#   define UPDATE_CACHE(name, gb)\
+    if(name##_bits < MIN_CACHE_BITS){\
+        name##_cache= AV_RB64( ((const uint8_t *)(gb)->buffer)+(name##_index>>3) ) << (name##_index&0x07);\
+        name##_bits= 64 - (name##_index&0x07);\
+    }\
+
+#   define SKIP_CACHE(name, gb, num)\
+        name##_cache <<= (num);\
+        name##_bits -= (num);\
+
+#   define SKIP_COUNTER(name, gb, num)\
+        name##_index += (num);\
+
+#   define SKIP_BITS(name, gb, num)\
+        {\
+            SKIP_CACHE(name, gb, num)\
+            SKIP_COUNTER(name, gb, num)\
+        }\
+
+#   define LAST_SKIP_BITS(name, gb, num) SKIP_BITS(name, gb, num)
+#   define LAST_SKIP_CACHE(name, gb, num) SKIP_CACHE(name, gb, num)
+
+#   define SHOW_UBITS(name, gb, num)\
+        ((uint32_t)(name##_cache >> (64-(num))))
+
+#   define SHOW_SBITS(name, gb, num)\
+        ((int32_t)((int64_t)name##_cache >> (64-(num))))
+
+#   define GET_CACHE(name, gb)\
+        ((uint32_t)(name##_cache >> 32))
+
+static inline int get_bits_count(const GetBitContext *s){
+    return s->index;
+}
+
+static inline void skip_bits_long(GetBitContext *s, int n){
+    s->index += n;
+    s->cache_bits = 0;
+}
+
 #elif defined LIBMPEG2_BITSTREAM_READER
 //libmpeg2 like reader
 
@@ -433,7 +506,11 @@ static inline unsigned int show_bits(GetBitContext *s, int n){
     OPEN_READER(re, s)
     UPDATE_CACHE(re, s)
     tmp= SHOW_UBITS(re, s, n);
+#ifdef CACHED_BITSTREAM_READER
+    CLOSE_READER(re, s) /* keep the refill */
+#else
 //    CLOSE_READER(re, s)
+#endif
     return tmp;
 }
 
@@ -541,6 +618,10 @@ static inline void init_get_bits(GetBitContext *s,
     s->buffer_end= buffer + buffer_size;
 #ifdef ALT_BITSTREAM_READER
     s->index=0;
+#elif defined CACHED_BITSTREAM_READER
+    s->index=0;
+    s->cache_bits=0;
+    s->cache=0;
 #elif defined LIBMPEG2_BITSTREAM_READER
     s->buffer_ptr = (uint8_t*)((intptr_t)buffer&(~1));
     s->bit_count = 16 + 8*((intptr_t)buffer&1);
@@ -223,6 +223,11 @@ union unaligned_16 { uint16_t l; } __attribute__((packed)) av_alias;
 #endif
 
 #ifndef AV_RB64
+/* two unaligned long reads, ldrd would fault on an unaligned address */
+#if defined CPU_COLDFIRE || (defined CPU_ARM && ARM_ARCH >= 6)
+#define AV_RB64(x) (((uint64_t)AV_RB32(x) << 32) | \
+                    AV_RB32((const uint8_t*)(x) + 4))
+#else
 #   define AV_RB64(x)                                   \
     (((uint64_t)((const uint8_t*)(x))[0] << 56) |       \
      ((uint64_t)((const uint8_t*)(x))[1] << 48) |       \
@@ -233,6 +238,7 @@ union unaligned_16 { uint16_t l; } __attribute__((packed)) av_alias;
      ((uint64_t)((const uint8_t*)(x))[6] <<  8) |       \
       (uint64_t)((const uint8_t*)(x))[7])
 #endif
+#endif
 #ifndef AV_WB64
 #   define AV_WB64(p, d) do {                   \
         ((uint8_t*)(p))[7] = (d);               \
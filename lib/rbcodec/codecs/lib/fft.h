@@ -58,6 +58,8 @@ typedef struct FFTContext {
 // internal api  (fft<->mdct)
 //int fft_calc_unscaled(FFTContext *s, FFTComplex *z);
 //void ff_fft_permute_c(FFTContext *s, FFTComplex *z); // internal only?
+/* in-place split radix FFT of 2^nbits points, 2 <= nbits <= 12, taking its
+   input in the order given by revtab (see ff_imdct_half) */
 void ff_fft_calc_c(int nbits, FFTComplex *z);
 
 #endif // CODECLIB_FFT_H_INCLUDED
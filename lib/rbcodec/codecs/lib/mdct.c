@@ -137,18 +137,22 @@ void ff_imdct_half(unsigned int nbits, fixed32 *output, const fixed32 *input)
 #else
         while(LIKELY(p_revtab < p_revtab_end))
         {
-            j = (*p_revtab)>>revtab_shift;
-            XNPROD31(*in2, *in1, T[1], T[0], &z[j].re, &z[j].im );
+            /* rotate into registers first: a store into z[] could alias the
+               input or the table, forcing reloads between the two pairs */
+            fixed32 r0, i0, r1, i1;
+            XNPROD31_R(in2[0], in1[0], T[1], T[0], r0, i0);
             T += step;
-            in1 += 2;
-            in2 -= 2;
-            p_revtab++;
-            j = (*p_revtab)>>revtab_shift;
-            XNPROD31(*in2, *in1, T[1], T[0], &z[j].re, &z[j].im );
+            XNPROD31_R(in2[-2], in1[2], T[1], T[0], r1, i1);
             T += step;
-            in1 += 2;
-            in2 -= 2;
-            p_revtab++;
+            in1 += 4;
+            in2 -= 4;
+            j = p_revtab[0]>>revtab_shift;
+            z[j].re = r0;
+            z[j].im = i0;
+            j = p_revtab[1]>>revtab_shift;
+            z[j].re = r1;
+            z[j].im = i1;
+            p_revtab += 2;
         }
 #endif
     }
@@ -212,18 +216,20 @@ void ff_imdct_half(unsigned int nbits, fixed32 *output, const fixed32 *input)
 #else
         while(LIKELY(p_revtab < p_revtab_end))
         {
-            j = (*p_revtab)>>revtab_shift;
-            XNPROD31(*in2, *in1, T[0], T[1], &z[j].re, &z[j].im);
+            fixed32 r0, i0, r1, i1;
+            XNPROD31_R(in2[0], in1[0], T[0], T[1], r0, i0);
             T -= step;
-            in1 += 2;
-            in2 -= 2;
-            p_revtab++;
-            j = (*p_revtab)>>revtab_shift;
-            XNPROD31(*in2, *in1, T[0], T[1], &z[j].re, &z[j].im);
+            XNPROD31_R(in2[-2], in1[2], T[0], T[1], r1, i1);
             T -= step;
-            in1 += 2;
-            in2 -= 2;
-            p_revtab++;
+            in1 += 4;
+            in2 -= 4;
+            j = p_revtab[0]>>revtab_shift;
+            z[j].re = r0;
+            z[j].im = i0;
+            j = p_revtab[1]>>revtab_shift;
+            z[j].re = r1;
+            z[j].im = i1;
+            p_revtab += 2;
         }
 #endif
     }
@@ -23,6 +23,12 @@
 //#include "types.h"
 #include "fft.h"
 
+/* The transforms shared by all codecs. There is no per-size setup: the
+ * twiddles come from sincos_lookup0/1 and the split radix order from
+ * revtab in mdct_lookup.c, which are sized for the largest transform and
+ * read with a stride for the smaller ones, so a codec only needs to pass
+ * nbits. ff_imdct_calc/half take 6 <= nbits <= 13, ff_fft_calc_c
+ * 2 <= nbits <= 12 (see fft.h). */
 void ff_imdct_calc(unsigned int nbits, fixed32 *output, const fixed32 *input);
 void ff_imdct_half(unsigned int nbits, fixed32 *output, const fixed32 *input);
 
@@ -979,6 +979,82 @@ static void ps_data_decode(ps_info *ps)
 #endif
 }
 
+/* One link of the decorrelation allpass chain: the fractional delay
+ * z^(-d(m)) * Q_Fract_allpass[k,m] of the link's delay line, the
+ * -a(m) * g_DecaySlope[k] feedforward from R0 and the feedback into the
+ * delay line, fused so that the operands stay in registers */
+static INLINE void ps_allpass_link(complex_t R0, complex_t delay,
+                                   const complex_t Q_Fract_allpass,
+                                   real_t g_DecaySlope_filt)
+{
+    complex_t tmp;
+
+    ComplexMult(&RE(tmp), &IM(tmp), RE(delay), IM(delay),
+                RE(Q_Fract_allpass), IM(Q_Fract_allpass));
+
+    RE(tmp) -= MUL_F(g_DecaySlope_filt, RE(R0));
+    IM(tmp) -= MUL_F(g_DecaySlope_filt, IM(R0));
+
+    RE(delay) = RE(R0) + MUL_F(g_DecaySlope_filt, RE(tmp));
+    IM(delay) = IM(R0) + MUL_F(g_DecaySlope_filt, IM(tmp));
+
+    RE(R0) = RE(tmp);
+    IM(R0) = IM(tmp);
+}
+
+/* Allpass filter one subband over the time slots [n0, n1). 'in', 'out',
+ * 'delay' and 'delay_ser' point at the subband in the first row of their
+ * arrays, whose rows are 'stride' subbands apart. G_TransientRatio points
+ * at the subband's parameter band in the first row of the ratio table */
+static void ps_allpass_band(const ps_info *ps, const qmf_t *in, qmf_t *out,
+                            int stride, complex_t *delay,
+                            complex_t *delay_ser[NO_ALLPASS_LINKS],
+                            const complex_t Phi_Fract,
+                            const complex_t *Q_Fract_allpass,
+                            const real_t *g_DecaySlope_filt,
+                            const real_t *G_TransientRatio,
+                            uint8_t n0, uint8_t n1)
+{
+    uint8_t temp_delay = ps->saved_delay;
+    uint8_t temp_delay_ser[NO_ALLPASS_LINKS];
+    uint8_t n, m;
+
+    for (m = 0; m < NO_ALLPASS_LINKS; m++)
+        temp_delay_ser[m] = ps->delay_buf_index_ser[m];
+
+    for (n = n0; n < n1; n++)
+    {
+        complex_t R0;
+        real_t *d = delay[temp_delay*stride];
+
+        /* z^(-2) * Phi_Fract[k] */
+        ComplexMult(&RE(R0), &IM(R0), RE(d), IM(d),
+                    RE(Phi_Fract), IM(Phi_Fract));
+        RE(d) = QMF_RE(in[n*stride]);
+        IM(d) = QMF_IM(in[n*stride]);
+
+        for (m = 0; m < NO_ALLPASS_LINKS; m++)
+        {
+            ps_allpass_link(R0, delay_ser[m][temp_delay_ser[m]*stride],
+                            Q_Fract_allpass[m], g_DecaySlope_filt[m]);
+        }
+
+        /* duck if a past transient is found */
+        QMF_RE(out[n*stride]) = MUL_R(G_TransientRatio[n*34], RE(R0));
+        QMF_IM(out[n*stride]) = MUL_R(G_TransientRatio[n*34], IM(R0));
+
+        /* Update delay buffer index */
+        if (++temp_delay >= 2)
+            temp_delay = 0;
+
+        for (m = 0; m < NO_ALLPASS_LINKS; m++)
+        {
+            if (++temp_delay_ser[m] >= ps->num_sample_delay_ser[m])
+                temp_delay_ser[m] = 0;
+        }
+    }
+}
+
 /* decorrelate the mono signal using an allpass filter */
 static void ps_decorrelate(ps_info *ps, 
                            qmf_t X_left[MAX_NTSRPS][64], 
@@ -986,11 +1062,9 @@ static void ps_decorrelate(ps_info *ps,
                            qmf_t X_hybrid_left[32][32], 
                            qmf_t X_hybrid_right[32][32])
 {
-    uint8_t gr, n, m, bk;
-    uint8_t temp_delay = 0;
+    uint8_t gr, n, m, bk, n0, n1;
     uint8_t sb, maxsb;
     const complex_t *Phi_Fract_SubQmf;
-    uint8_t temp_delay_ser[NO_ALLPASS_LINKS];
     real_t P_SmoothPeakDecayDiffNrg, nrg;
     static real_t P[32][34];
     static real_t G_TransientRatio[32][34];
@@ -1117,9 +1191,22 @@ static void ps_decorrelate(ps_info *ps,
 #endif
 
     /* apply stereo decorrelation filter to the signal */
+    n0 = ps->border_position[0];
+    n1 = ps->border_position[ps->num_env];
+
     for (gr = 0; gr < ps->num_groups; gr++)
     {
-        if (gr < ps->num_hybrid_groups)
+        const uint8_t hybrid = (gr < ps->num_hybrid_groups);
+        /* the hybrid and QMF subbands only differ in where their samples
+         * and delay lines are kept */
+        const int stride = hybrid ? 32 : 64;
+        const qmf_t *in = hybrid ? X_hybrid_left[0] : X_left[0];
+        qmf_t *out = hybrid ? X_hybrid_right[0] : X_right[0];
+
+        /* select b(k) for reading the transient ratio */
+        bk = (~NEGATE_IPD_MASK) & ps->map_group2bk[gr];
+
+        if (hybrid)
             maxsb = ps->group_border[gr] + 1;
         else
             maxsb = ps->group_border[gr + 1];
@@ -1129,9 +1216,40 @@ static void ps_decorrelate(ps_info *ps,
         {
             real_t g_DecaySlope;
             real_t g_DecaySlope_filt[NO_ALLPASS_LINKS];
+            complex_t *delay_ser[NO_ALLPASS_LINKS];
+            const complex_t *Q_Fract_allpass;
+            const real_t *Phi_Fract;
+            complex_t *delay;
+
+            if (!hybrid && sb > ps->nr_allpass_bands)
+            {
+                /* delay, never hybrid subbands here */
+                uint8_t idx = ps->delay_buf_index_delay[sb];
+
+                for (n = n0; n < n1; n++)
+                {
+                    complex_t R0;
+
+                    RE(R0) = RE(ps->delay_Qmf[idx][sb]);
+                    IM(R0) = IM(ps->delay_Qmf[idx][sb]);
+                    RE(ps->delay_Qmf[idx][sb]) = QMF_RE(in[n*stride + sb]);
+                    IM(ps->delay_Qmf[idx][sb]) = QMF_IM(in[n*stride + sb]);
+
+                    /* duck if a past transient is found */
+                    QMF_RE(out[n*stride + sb]) = MUL_R(G_TransientRatio[n][bk], RE(R0));
+                    QMF_IM(out[n*stride + sb]) = MUL_R(G_TransientRatio[n][bk], IM(R0));
+
+                    /* delay_D depends on the samplerate, it can hold the values 14 and 1 */
+                    if (++idx >= ps->delay_D[sb])
+                        idx = 0;
+                }
+
+                ps->delay_buf_index_delay[sb] = idx;
+                continue;
+            }
 
             /* g_DecaySlope: [0..1] */
-            if (gr < ps->num_hybrid_groups || sb <= ps->decay_cutoff)
+            if (hybrid || sb <= ps->decay_cutoff)
             {
                 g_DecaySlope = FRAC_CONST(1.0);
             } else {
@@ -1151,177 +1269,41 @@ static void ps_decorrelate(ps_info *ps,
                 g_DecaySlope_filt[m] = MUL_F(g_DecaySlope, filter_a[m]);
             }
 
-
-            /* set delay indices */
-            temp_delay = ps->saved_delay;
-            for (n = 0; n < NO_ALLPASS_LINKS; n++)
-                temp_delay_ser[n] = ps->delay_buf_index_ser[n];
-
-            for (n = ps->border_position[0]; n < ps->border_position[ps->num_env]; n++)
+            /* fetch parameters */
+            if (hybrid)
             {
-                complex_t tmp, tmp0, R0;
-
-                if (gr < ps->num_hybrid_groups)
-                {
-                    /* hybrid filterbank input */
-                    RE(inputLeft) = QMF_RE(X_hybrid_left[n][sb]);
-                    IM(inputLeft) = QMF_IM(X_hybrid_left[n][sb]);
-                } else {
-                    /* QMF filterbank input */
-                    RE(inputLeft) = QMF_RE(X_left[n][sb]);
-                    IM(inputLeft) = QMF_IM(X_left[n][sb]);
-                }
-
-                if (sb > ps->nr_allpass_bands && gr >= ps->num_hybrid_groups)
-                {
-                    /* delay */
-
-                    /* never hybrid subbands here, always QMF subbands */
-                    RE(tmp) = RE(ps->delay_Qmf[ps->delay_buf_index_delay[sb]][sb]);
-                    IM(tmp) = IM(ps->delay_Qmf[ps->delay_buf_index_delay[sb]][sb]);
-                    RE(R0) = RE(tmp);
-                    IM(R0) = IM(tmp);
-                    RE(ps->delay_Qmf[ps->delay_buf_index_delay[sb]][sb]) = RE(inputLeft);
-                    IM(ps->delay_Qmf[ps->delay_buf_index_delay[sb]][sb]) = IM(inputLeft);
-                } else {
-                    /* allpass filter */
-                    uint8_t m;
-                    complex_t Phi_Fract;
-
-                    /* fetch parameters */
-                    if (gr < ps->num_hybrid_groups)
-                    {
-                        /* select data from the hybrid subbands */
-                        RE(tmp0) = RE(ps->delay_SubQmf[temp_delay][sb]);
-                        IM(tmp0) = IM(ps->delay_SubQmf[temp_delay][sb]);
-
-                        RE(ps->delay_SubQmf[temp_delay][sb]) = RE(inputLeft);
-                        IM(ps->delay_SubQmf[temp_delay][sb]) = IM(inputLeft);
-
-                        RE(Phi_Fract) = RE(Phi_Fract_SubQmf[sb]);
-                        IM(Phi_Fract) = IM(Phi_Fract_SubQmf[sb]);
-                    } else {
-                        /* select data from the QMF subbands */
-                        RE(tmp0) = RE(ps->delay_Qmf[temp_delay][sb]);
-                        IM(tmp0) = IM(ps->delay_Qmf[temp_delay][sb]);
-
-                        RE(ps->delay_Qmf[temp_delay][sb]) = RE(inputLeft);
-                        IM(ps->delay_Qmf[temp_delay][sb]) = IM(inputLeft);
-
-                        RE(Phi_Fract) = RE(Phi_Fract_Qmf[sb]);
-                        IM(Phi_Fract) = IM(Phi_Fract_Qmf[sb]);
-                    }
-
-                    /* z^(-2) * Phi_Fract[k] */
-                    ComplexMult(&RE(tmp), &IM(tmp), RE(tmp0), IM(tmp0), RE(Phi_Fract), IM(Phi_Fract));
-
-                    RE(R0) = RE(tmp);
-                    IM(R0) = IM(tmp);
-                    for (m = 0; m < NO_ALLPASS_LINKS; m++)
-                    {
-                        complex_t Q_Fract_allpass, tmp2;
-
-                        /* fetch parameters */
-                        if (gr < ps->num_hybrid_groups)
-                        {
-                            /* select data from the hybrid subbands */
-                            RE(tmp0) = RE(ps->delay_SubQmf_ser[m][temp_delay_ser[m]][sb]);
-                            IM(tmp0) = IM(ps->delay_SubQmf_ser[m][temp_delay_ser[m]][sb]);
-
-                            if (ps->use34hybrid_bands)
-                            {
-                                RE(Q_Fract_allpass) = RE(Q_Fract_allpass_SubQmf34[sb][m]);
-                                IM(Q_Fract_allpass) = IM(Q_Fract_allpass_SubQmf34[sb][m]);
-                            } else {
-                                RE(Q_Fract_allpass) = RE(Q_Fract_allpass_SubQmf20[sb][m]);
-                                IM(Q_Fract_allpass) = IM(Q_Fract_allpass_SubQmf20[sb][m]);
-                            }
-                        } else {
-                            /* select data from the QMF subbands */
-                            RE(tmp0) = RE(ps->delay_Qmf_ser[m][temp_delay_ser[m]][sb]);
-                            IM(tmp0) = IM(ps->delay_Qmf_ser[m][temp_delay_ser[m]][sb]);
-
-                            RE(Q_Fract_allpass) = RE(Q_Fract_allpass_Qmf[sb][m]);
-                            IM(Q_Fract_allpass) = IM(Q_Fract_allpass_Qmf[sb][m]);
-                        }
-
-                        /* delay by a fraction */
-                        /* z^(-d(m)) * Q_Fract_allpass[k,m] */
-                        ComplexMult(&RE(tmp), &IM(tmp), RE(tmp0), IM(tmp0), RE(Q_Fract_allpass), IM(Q_Fract_allpass));
-
-                        /* -a(m) * g_DecaySlope[k] */
-                        RE(tmp) += -MUL_F(g_DecaySlope_filt[m], RE(R0));
-                        IM(tmp) += -MUL_F(g_DecaySlope_filt[m], IM(R0));
-
-                        /* -a(m) * g_DecaySlope[k] * Q_Fract_allpass[k,m] * z^(-d(m)) */
-                        RE(tmp2) = RE(R0) + MUL_F(g_DecaySlope_filt[m], RE(tmp));
-                        IM(tmp2) = IM(R0) + MUL_F(g_DecaySlope_filt[m], IM(tmp));
-
-                        /* store sample */
-                        if (gr < ps->num_hybrid_groups)
-                        {
-                            RE(ps->delay_SubQmf_ser[m][temp_delay_ser[m]][sb]) = RE(tmp2);
-                            IM(ps->delay_SubQmf_ser[m][temp_delay_ser[m]][sb]) = IM(tmp2);
-                        } else {
-                            RE(ps->delay_Qmf_ser[m][temp_delay_ser[m]][sb]) = RE(tmp2);
-                            IM(ps->delay_Qmf_ser[m][temp_delay_ser[m]][sb]) = IM(tmp2);
-                        }
-
-                        /* store for next iteration (or as output value if last iteration) */
-                        RE(R0) = RE(tmp);
-                        IM(R0) = IM(tmp);
-                    }
-                }
-
-                /* select b(k) for reading the transient ratio */
-                bk = (~NEGATE_IPD_MASK) & ps->map_group2bk[gr];
-
-                /* duck if a past transient is found */
-                RE(R0) = MUL_R(G_TransientRatio[n][bk], RE(R0));
-                IM(R0) = MUL_R(G_TransientRatio[n][bk], IM(R0));
-
-                if (gr < ps->num_hybrid_groups)
-                {
-                    /* hybrid */
-                    QMF_RE(X_hybrid_right[n][sb]) = RE(R0);
-                    QMF_IM(X_hybrid_right[n][sb]) = IM(R0);
-                } else {
-                    /* QMF */
-                    QMF_RE(X_right[n][sb]) = RE(R0);
-                    QMF_IM(X_right[n][sb]) = IM(R0);
-                }
-
-                /* Update delay buffer index */
-                if (++temp_delay >= 2)
-                {
-                    temp_delay = 0;
-                }
-
-                /* update delay indices */
-                if (sb > ps->nr_allpass_bands && gr >= ps->num_hybrid_groups)
-                {
-                    /* delay_D depends on the samplerate, it can hold the values 14 and 1 */
-                    if (++ps->delay_buf_index_delay[sb] >= ps->delay_D[sb])
-                    {
-                        ps->delay_buf_index_delay[sb] = 0;
-                    }
-                }
-
+                delay = &ps->delay_SubQmf[0][sb];
                 for (m = 0; m < NO_ALLPASS_LINKS; m++)
-                {
-                    if (++temp_delay_ser[m] >= ps->num_sample_delay_ser[m])
-                    {
-                        temp_delay_ser[m] = 0;
-                    }
-                }
+                    delay_ser[m] = &ps->delay_SubQmf_ser[m][0][sb];
+                Phi_Fract = Phi_Fract_SubQmf[sb];
+                Q_Fract_allpass = ps->use34hybrid_bands ?
+                    Q_Fract_allpass_SubQmf34[sb] : Q_Fract_allpass_SubQmf20[sb];
+            } else {
+                delay = &ps->delay_Qmf[0][sb];
+                for (m = 0; m < NO_ALLPASS_LINKS; m++)
+                    delay_ser[m] = &ps->delay_Qmf_ser[m][0][sb];
+                Phi_Fract = Phi_Fract_Qmf[sb];
+                Q_Fract_allpass = Q_Fract_allpass_Qmf[sb];
             }
+
+            ps_allpass_band(ps, in + sb, out + sb, stride, delay, delay_ser,
+                            Phi_Fract, Q_Fract_allpass, g_DecaySlope_filt,
+                            &G_TransientRatio[0][bk], n0, n1);
         }
     }
 
-    /* update delay indices */
-    ps->saved_delay = temp_delay;
-    for (m = 0; m < NO_ALLPASS_LINKS; m++)
-        ps->delay_buf_index_ser[m] = temp_delay_ser[m];
+    /* update delay indices, every subband advanced them by n1 - n0 */
+    for (n = n0; n < n1; n++)
+    {
+        if (++ps->saved_delay >= 2)
+            ps->saved_delay = 0;
+
+        for (m = 0; m < NO_ALLPASS_LINKS; m++)
+        {
+            if (++ps->delay_buf_index_ser[m] >= ps->num_sample_delay_ser[m])
+                ps->delay_buf_index_ser[m] = 0;
+        }
+    }
 }
 
 #ifdef FIXED_POINT
@@ -1391,6 +1373,9 @@ static void ps_mix_phase(ps_info *ps,
     uint8_t sb, maxsb;
     uint8_t env;
     uint8_t nr_ipdopd_par;
+    qmf_t *left, *right, *pLeft, *pRight;
+    int stride;
+    uint8_t rotate;
     complex_t h11 = {0,0}, h12 = {0,0}, h21 = {0,0}, h22 = {0,0};
     complex_t H11 = {0,0}, H12 = {0,0}, H21 = {0,0}, H22 = {0,0};
     complex_t deltaH11= {0,0}, deltaH12 = {0,0}, deltaH21= {0,0}, deltaH22= {0,0};
@@ -1425,6 +1410,18 @@ static void ps_mix_phase(ps_info *ps,
         /* use one channel per group in the subqmf domain */
         maxsb = (gr < ps->num_hybrid_groups) ? ps->group_border[gr] + 1 : ps->group_border[gr + 1];
 
+        /* the hybrid and QMF subbands only differ in where they are kept */
+        if (gr < ps->num_hybrid_groups)
+        {
+            left = X_hybrid_left[0];
+            right = X_hybrid_right[0];
+            stride = 32;
+        } else {
+            left = X_left[0];
+            right = X_right[0];
+            stride = 64;
+        }
+
         for (env = 0; env < ps->num_env; env++)
         {
             if (ps->icc_mode < 3)
@@ -1719,6 +1716,7 @@ static void ps_mix_phase(ps_info *ps,
             }
 
             /* apply H_xy to the current envelope band of the decorrelated subband */
+            rotate = (ps->enable_ipdopd) && (bk < nr_ipdopd_par);
             for (n = ps->border_position[env]; n < ps->border_position[env + 1]; n++)
             {
                 /* addition finalises the interpolation over every n */
@@ -1726,7 +1724,7 @@ static void ps_mix_phase(ps_info *ps,
                 RE(H12) += RE(deltaH12);
                 RE(H21) += RE(deltaH21);
                 RE(H22) += RE(deltaH22);
-                if ((ps->enable_ipdopd) && (bk < nr_ipdopd_par))
+                if (rotate)
                 {
                     IM(H11) += IM(deltaH11);
                     IM(H12) += IM(deltaH12);
@@ -1735,23 +1733,40 @@ static void ps_mix_phase(ps_info *ps,
                 }
 
                 /* channel is an alias to the subband */
+                pLeft = &left[n*stride];
+                pRight = &right[n*stride];
+
+                if (!rotate)
+                {
+                    /* without IPD/OPD H_xy is real, which is the common case */
+                    for (sb = ps->group_border[gr]; sb < maxsb; sb++)
+                    {
+                        complex_t inLeft, inRight;
+
+                        /* load decorrelated samples */
+                        RE(inLeft) =  QMF_RE(pLeft[sb]);
+                        IM(inLeft) =  QMF_IM(pLeft[sb]);
+                        RE(inRight) = QMF_RE(pRight[sb]);
+                        IM(inRight) = QMF_IM(pRight[sb]);
+
+                        /* apply mixing */
+                        QMF_RE(pLeft[sb])  = MUL_C(RE(H11), RE(inLeft)) + MUL_C(RE(H21), RE(inRight));
+                        QMF_IM(pLeft[sb])  = MUL_C(RE(H11), IM(inLeft)) + MUL_C(RE(H21), IM(inRight));
+                        QMF_RE(pRight[sb]) = MUL_C(RE(H12), RE(inLeft)) + MUL_C(RE(H22), RE(inRight));
+                        QMF_IM(pRight[sb]) = MUL_C(RE(H12), IM(inLeft)) + MUL_C(RE(H22), IM(inRight));
+                    }
+                    continue;
+                }
+
                 for (sb = ps->group_border[gr]; sb < maxsb; sb++)
                 {
                     complex_t inLeft, inRight;
 
                     /* load decorrelated samples */
-                    if (gr < ps->num_hybrid_groups)
-                    {
-                        RE(inLeft) =  RE(X_hybrid_left[n][sb]);
-                        IM(inLeft) =  IM(X_hybrid_left[n][sb]);
-                        RE(inRight) = RE(X_hybrid_right[n][sb]);
-                        IM(inRight) = IM(X_hybrid_right[n][sb]);
-                    } else {
-                        RE(inLeft) =  RE(X_left[n][sb]);
-                        IM(inLeft) =  IM(X_left[n][sb]);
-                        RE(inRight) = RE(X_right[n][sb]);
-                        IM(inRight) = IM(X_right[n][sb]);
-                    }
+                    RE(inLeft) =  QMF_RE(pLeft[sb]);
+                    IM(inLeft) =  QMF_IM(pLeft[sb]);
+                    RE(inRight) = QMF_RE(pRight[sb]);
+                    IM(inRight) = QMF_IM(pRight[sb]);
 
                     /* apply mixing */
                     RE(tempLeft) =  MUL_C(RE(H11), RE(inLeft)) + MUL_C(RE(H21), RE(inRight));
@@ -1759,29 +1774,17 @@ static void ps_mix_phase(ps_info *ps,
                     RE(tempRight) = MUL_C(RE(H12), RE(inLeft)) + MUL_C(RE(H22), RE(inRight));
                     IM(tempRight) = MUL_C(RE(H12), IM(inLeft)) + MUL_C(RE(H22), IM(inRight));
 
-                    /* only perform imaginary operations when needed */
-                    if ((ps->enable_ipdopd) && (bk < nr_ipdopd_par))
-                    {
-                        /* apply rotation */
-                        RE(tempLeft)  -= MUL_C(IM(H11), IM(inLeft)) + MUL_C(IM(H21), IM(inRight));
-                        IM(tempLeft)  += MUL_C(IM(H11), RE(inLeft)) + MUL_C(IM(H21), RE(inRight));
-                        RE(tempRight) -= MUL_C(IM(H12), IM(inLeft)) + MUL_C(IM(H22), IM(inRight));
-                        IM(tempRight) += MUL_C(IM(H12), RE(inLeft)) + MUL_C(IM(H22), RE(inRight));
-                    }
+                    /* apply rotation */
+                    RE(tempLeft)  -= MUL_C(IM(H11), IM(inLeft)) + MUL_C(IM(H21), IM(inRight));
+                    IM(tempLeft)  += MUL_C(IM(H11), RE(inLeft)) + MUL_C(IM(H21), RE(inRight));
+                    RE(tempRight) -= MUL_C(IM(H12), IM(inLeft)) + MUL_C(IM(H22), IM(inRight));
+                    IM(tempRight) += MUL_C(IM(H12), RE(inLeft)) + MUL_C(IM(H22), RE(inRight));
 
                     /* store final samples */
-                    if (gr < ps->num_hybrid_groups)
-                    {
-                        RE(X_hybrid_left[n][sb])  = RE(tempLeft);
-                        IM(X_hybrid_left[n][sb])  = IM(tempLeft);
-                        RE(X_hybrid_right[n][sb]) = RE(tempRight);
-                        IM(X_hybrid_right[n][sb]) = IM(tempRight);
-                    } else {
-                        RE(X_left[n][sb])  = RE(tempLeft);
-                        IM(X_left[n][sb])  = IM(tempLeft);
-                        RE(X_right[n][sb]) = RE(tempRight);
-                        IM(X_right[n][sb]) = IM(tempRight);
-                    }
+                    QMF_RE(pLeft[sb])  = RE(tempLeft);
+                    QMF_IM(pLeft[sb])  = IM(tempLeft);
+                    QMF_RE(pRight[sb]) = RE(tempRight);
+                    QMF_IM(pRight[sb]) = IM(tempRight);
                 }
             }
 
@@ -50,6 +50,78 @@
     #define FAAD_ANALYSIS_SCALE3(X) ((X)/32.0f)
 #endif
 
+#if defined(FIXED_POINT) && !defined(SBR_LOW_POWER) && \
+    (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ >= 5)
+#include <smmintrin.h>
+
+/* The windows below sum MUL_F()s, each rounded on its own, of runs of
+ * consecutive samples by coefficients that are 10 or 20 apart in qmf_c[].
+ * With the coefficients copied tap by tap into qmf_c_ana[] and qmf_c_syn[]
+ * four outputs take two SSE4.1 pmuldq per tap, and adding up the 64-bit
+ * lanes keeps the same low 32 bits as the 32-bit sums. The rest of the
+ * build stays baseline x86, the kernel is only taken when the CPU has
+ * SSE4.1. */
+#define QMF_SSE4
+
+/* 1 when the tables are filled in and the CPU has SSE4.1, 0 without it */
+static int qmf_sse4 = -1;
+static real_t qmf_c_ana[5][64] __attribute__((aligned(16)));
+static real_t qmf_c_syn[10][64] __attribute__((aligned(16)));
+static const uint16_t qmf_ana_offset[5] = { 0, 64, 128, 192, 256 };
+static const uint16_t qmf_syn_offset[10] = {
+    0, 192, 256, 448, 512, 704, 768, 960, 1024, 1216 };
+
+static int qmf_use_sse4(void)
+{
+    int n, j;
+
+    if (qmf_sse4 >= 0)
+        return qmf_sse4;
+
+    for (n = 0; n < 64; n++)
+    {
+        for (j = 0; j < 5; j++)
+            qmf_c_ana[j][n] = qmf_c[(n < 32 ? n*20 : n*20 - 639) + 2*j];
+        for (j = 0; j < 10; j++)
+            qmf_c_syn[j][n] = qmf_c[n*10 + j];
+    }
+
+    qmf_sse4 = __builtin_cpu_supports("sse4.1") ? 1 : 0;
+    return qmf_sse4;
+}
+
+/* out[n] = (sum of MUL_F(x[offset[j] + n], c[j][n]) over the taps j)
+ * >> shift, for n = 0 .. 63 */
+static __attribute__((target("sse4.1")))
+void qmf_window_sse4(real_t *out, const real_t *x, const uint16_t *offset,
+                     const real_t (*c)[64], int taps, int shift)
+{
+    const __m128i round = _mm_set1_epi64x(1 << (FRAC_BITS-1));
+    __m128i a, b, even, odd;
+    int n, j;
+
+    for (n = 0; n < 64; n += 4)
+    {
+        even = odd = _mm_setzero_si128();
+        for (j = 0; j < taps; j++)
+        {
+            a = _mm_loadu_si128((const __m128i *)&x[offset[j] + n]);
+            b = _mm_load_si128((const __m128i *)&c[j][n]);
+            even = _mm_add_epi64(even, _mm_srli_epi64(
+                   _mm_add_epi64(_mm_mul_epi32(a, b), round), FRAC_BITS));
+            odd  = _mm_add_epi64(odd, _mm_srli_epi64(
+                   _mm_add_epi64(_mm_mul_epi32(_mm_srli_epi64(a, 32),
+                                               _mm_srli_epi64(b, 32)),
+                                 round), FRAC_BITS));
+        }
+        a = _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xcc);
+        _mm_storeu_si128((__m128i *)&out[n],
+                         _mm_sra_epi32(a, _mm_cvtsi32_si128(shift)));
+    }
+}
+#endif /* FIXED_POINT && !SBR_LOW_POWER && x86 */
+
 
 void sbr_qmf_analysis_32(sbr_info *sbr, qmfa_info *qmfa, const real_t *input,
                          qmf_t X[MAX_NTSR][64], uint8_t offset, uint8_t kx)
@@ -85,25 +157,33 @@ void sbr_qmf_analysis_32(sbr_info *sbr, qmfa_info *qmfa, const real_t *input,
         }
 
         /* window and summation to create array u */
-        for (n = 0; n < 32; n++)
-        {
-            idx0 = qmfa->x_index + n; idx1 = n * 20;
-            u[n] = FAAD_ANALYSIS_SCALE1(
-                   MUL_F(qmfa->x[idx0      ], qmf_c[idx1    ]) +
-                   MUL_F(qmfa->x[idx0 +  64], qmf_c[idx1 + 2]) +
-                   MUL_F(qmfa->x[idx0 + 128], qmf_c[idx1 + 4]) +
-                   MUL_F(qmfa->x[idx0 + 192], qmf_c[idx1 + 6]) +
-                   MUL_F(qmfa->x[idx0 + 256], qmf_c[idx1 + 8]));
-        }
-        for (n = 32; n < 64; n++)
+#ifdef QMF_SSE4
+        if (qmf_use_sse4())
+            qmf_window_sse4(u, &qmfa->x[qmfa->x_index], qmf_ana_offset,
+                            qmf_c_ana, 5, 4);
+        else
+#endif
         {
-            idx0 = qmfa->x_index + n; idx1 = n * 20 - 639;
-            u[n] = FAAD_ANALYSIS_SCALE1(
-                   MUL_F(qmfa->x[idx0      ], qmf_c[idx1    ]) +
-                   MUL_F(qmfa->x[idx0 +  64], qmf_c[idx1 + 2]) +
-                   MUL_F(qmfa->x[idx0 + 128], qmf_c[idx1 + 4]) +
-                   MUL_F(qmfa->x[idx0 + 192], qmf_c[idx1 + 6]) +
-                   MUL_F(qmfa->x[idx0 + 256], qmf_c[idx1 + 8]));
+            for (n = 0; n < 32; n++)
+            {
+                idx0 = qmfa->x_index + n; idx1 = n * 20;
+                u[n] = FAAD_ANALYSIS_SCALE1(
+                       MUL_F(qmfa->x[idx0      ], qmf_c[idx1    ]) +
+                       MUL_F(qmfa->x[idx0 +  64], qmf_c[idx1 + 2]) +
+                       MUL_F(qmfa->x[idx0 + 128], qmf_c[idx1 + 4]) +
+                       MUL_F(qmfa->x[idx0 + 192], qmf_c[idx1 + 6]) +
+                       MUL_F(qmfa->x[idx0 + 256], qmf_c[idx1 + 8]));
+            }
+            for (n = 32; n < 64; n++)
+            {
+                idx0 = qmfa->x_index + n; idx1 = n * 20 - 639;
+                u[n] = FAAD_ANALYSIS_SCALE1(
+                       MUL_F(qmfa->x[idx0      ], qmf_c[idx1    ]) +
+                       MUL_F(qmfa->x[idx0 +  64], qmf_c[idx1 + 2]) +
+                       MUL_F(qmfa->x[idx0 + 128], qmf_c[idx1 + 4]) +
+                       MUL_F(qmfa->x[idx0 + 192], qmf_c[idx1 + 6]) +
+                       MUL_F(qmfa->x[idx0 + 256], qmf_c[idx1 + 8]));
+            }
         }
 
         /* update ringbuffer index */
@@ -533,6 +613,15 @@ void sbr_qmf_synthesis_64(sbr_info *sbr, qmfs_info *qmfs, qmf_t X[MAX_NTSR][64],
                : "d0", "d1", "d2", "d3", "d4", "d5", "memory");
         }
 #else
+#ifdef QMF_SSE4
+        if (qmf_use_sse4())
+        {
+            qmf_window_sse4(&output[out], p_buf_1, qmf_syn_offset, qmf_c_syn,
+                            10, 1);
+            out += 64;
+        }
+        else
+#endif
         for (k = 0; k < 64; k++)
         {
             idx0 = k*10;
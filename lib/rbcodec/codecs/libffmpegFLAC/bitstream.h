@@ -7,6 +7,8 @@
 #define BITSTREAM_H
 
 #include <inttypes.h>
+/* FLAC and Shorten read most of their input through Rice codes */
+#define CACHED_BITSTREAM_READER
 #include "ffmpeg_get_bits.h"
 
 #ifndef BUILD_STANDALONE
@@ -106,10 +106,11 @@ static int64_t get_utf8(GetBitContext *gb)
         ones++;
 
     if     (ones==0) bytes=0;
-    else if(ones==1) return -1;
+    else if(ones==1 || ones>7) return -1;
     else             bytes= ones - 1;
     
-    val= get_bits(gb, 7-ones);
+    /* the cached reader can't read 0 bits */
+    val= ones<7 ? get_bits(gb, 7-ones) : 0;
     while(bytes--){
         const int tmp = get_bits(gb, 8);
         
@@ -134,6 +135,66 @@ static int get_crc8(const uint8_t *buf, int count)
     return crc;
 }
 
+/* Reads count signed Rice codes with parameter k, keeping the bit reader
+   open across the whole partition. Codes that fit in the cache are taken
+   apart with a single count of the leading zeros, longer ones fall back to
+   scanning the quotient 16 bits at a time. */
+static inline void decode_rice(GetBitContext *gb, int32_t *dst, int count, int k)
+{
+    OPEN_READER(re, gb);
+
+    while (count-- > 0)
+    {
+        unsigned int buf, v;
+        int q;
+
+        UPDATE_CACHE(re, gb);
+        buf = GET_CACHE(re, gb);
+        q = 31 - av_log2(buf);
+
+        /* av_log2(0) is 0 as well, an all zero cache holds no whole code */
+        if (buf != 0 && q + 1 + k <= MIN_CACHE_BITS)
+        {
+            v = (q << k) | ((buf << q << 1) >> 1 >> (31 - k));
+            LAST_SKIP_BITS(re, gb, q + 1 + k);
+        }
+        else
+        {
+            q = 0;
+            while (SHOW_UBITS(re, gb, 16) == 0)
+            {
+                q += 16;
+                LAST_SKIP_BITS(re, gb, 16);
+                UPDATE_CACHE(re, gb);
+            }
+            buf = 31 - av_log2(GET_CACHE(re, gb));
+            q += buf;
+            LAST_SKIP_BITS(re, gb, buf + 1);
+            UPDATE_CACHE(re, gb);
+
+            v = 0;
+            if (k > 16)
+            {
+                v = SHOW_UBITS(re, gb, k - 16) << 16;
+                LAST_SKIP_BITS(re, gb, k - 16);
+                UPDATE_CACHE(re, gb);
+                v |= SHOW_UBITS(re, gb, 16);
+                LAST_SKIP_BITS(re, gb, 16);
+            }
+            else if (k)
+            {
+                v = SHOW_UBITS(re, gb, k);
+                LAST_SKIP_BITS(re, gb, k);
+            }
+            v += q << k;
+        }
+
+        *dst++ = (v >> 1) ^ -(v & 1);
+    }
+
+    CLOSE_READER(re, gb);
+}
+
 static int decode_residuals(FLACContext *s, int32_t* decoded, int pred_order) ICODE_ATTR_FLAC;
 static int decode_residuals(FLACContext *s, int32_t* decoded, int pred_order)
 {
@@ -160,13 +221,12 @@ static int decode_residuals(FLACContext *s, int32_t* decoded, int pred_order)
             //fprintf(stderr,"fixed len partition\n");
             tmp = get_bits(&s->gb, 5);
             for (; i < samples; i++, sample++)
-                decoded[sample] = get_sbits(&s->gb, tmp);
+                decoded[sample] = tmp ? get_sbits_long(&s->gb, tmp) : 0;
         }
         else
         {
-            for (; i < samples; i++, sample++){
-                decoded[sample] = get_sr_golomb_flac(&s->gb, tmp, INT_MAX, 0);
-            }
+            decode_rice(&s->gb, decoded + sample, samples - i, tmp);
+            sample += samples - i;
         }
         i= 0;
     }
@@ -221,6 +281,53 @@ static int decode_subframe_fixed(FLACContext *s, int32_t* decoded, int pred_orde
     return 0;
 }
 
+#if !defined(CPU_COLDFIRE) && !defined(CPU_ARM)
+/* Predictors for targets without hand-written ones, one per order so the
+   compiler can unroll and vectorise the dot product. The coefficients are
+   passed reversed so that they line up with the history data[i..i+order-1]
+   preceding the sample data[i+order] being restored. */
+#define LPC_DECODE(order) \
+static void lpc_decode_##order(int count, int qlevel, \
+                               const int *coeffs, int32_t *data) \
+{ \
+    int i, j; \
+    for (i = 0; i < count; i++) { \
+        int sum = 0; \
+        for (j = 0; j < order; j++) \
+            sum += coeffs[j] * data[i+j]; \
+        data[i+order] += sum >> qlevel; \
+    } \
+} \
+static void lpc_decode_wide_##order(int count, int qlevel, \
+                                    const int *coeffs, int32_t *data) \
+{ \
+    int i, j; \
+    for (i = 0; i < count; i++) { \
+        int64_t wsum = 0; \
+        for (j = 0; j < order; j++) \
+            wsum += (int64_t)coeffs[j] * data[i+j]; \
+        data[i+order] += wsum >> qlevel; \
+    } \
+}
+
+#define LPC_ORDERS(X) \
+    X(1)  X(2)  X(3)  X(4)  X(5)  X(6)  X(7)  X(8) \
+    X(9)  X(10) X(11) X(12) X(13) X(14) X(15) X(16) \
+    X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) \
+    X(25) X(26) X(27) X(28) X(29) X(30) X(31) X(32)
+
+LPC_ORDERS(LPC_DECODE)
+
+typedef void (*lpc_decode_fn)(int count, int qlevel,
+                              const int *coeffs, int32_t *data);
+
+#define LPC_NARROW(order) lpc_decode_##order,
+#define LPC_WIDE(order)   lpc_decode_wide_##order,
+
+static const lpc_decode_fn lpc_decode_narrow[32] = { LPC_ORDERS(LPC_NARROW) };
+static const lpc_decode_fn lpc_decode_wide[32] = { LPC_ORDERS(LPC_WIDE) };
+#endif
+
 static int decode_subframe_lpc(FLACContext *s, int32_t* decoded, int pred_order) ICODE_ATTR_FLAC;
 static int decode_subframe_lpc(FLACContext *s, int32_t* decoded, int pred_order)
 {
@@ -250,7 +357,11 @@ static int decode_subframe_lpc(FLACContext *s, int32_t* decoded, int pred_order)
 
     for (i = 0; i < pred_order; i++)
     {
+#if !defined(CPU_COLDFIRE) && !defined(CPU_ARM)
+        coeffs[pred_order-1-i] = get_sbits(&s->gb, coeff_prec);
+#else
         coeffs[i] = get_sbits(&s->gb, coeff_prec);
+#endif
     }
     
     if (decode_residuals(s, decoded, pred_order) < 0)
@@ -266,13 +377,9 @@ static int decode_subframe_lpc(FLACContext *s, int32_t* decoded, int pred_order)
         lpc_decode_arm(s->blocksize - pred_order, qlevel, pred_order,
                        decoded + pred_order, coeffs);
         #else
-        for (i = pred_order; i < s->blocksize; i++)
-        {
-            sum = 0;
-            for (j = 0; j < pred_order; j++)
-                sum += coeffs[j] * decoded[i-j-1];
-            decoded[i] += sum >> qlevel;
-        }
+        (void)sum;
+        lpc_decode_narrow[pred_order-1](s->blocksize - pred_order, qlevel,
+                                        coeffs, decoded);
         #endif
     } else {
         #if defined(CPU_COLDFIRE)
@@ -280,6 +387,11 @@ static int decode_subframe_lpc(FLACContext *s, int32_t* decoded, int pred_order)
         (void)j;
         lpc_decode_emac_wide(s->blocksize - pred_order, qlevel, pred_order,
                              decoded + pred_order, coeffs);
+        #elif !defined(CPU_ARM)
+        (void)wsum;
+        (void)j;
+        lpc_decode_wide[pred_order-1](s->blocksize - pred_order, qlevel,
+                                      coeffs, decoded);
         #else
         for (i = pred_order; i < s->blocksize; i++)
         {
@@ -300,7 +300,7 @@ int shorten_decode_frames(ShortenContext *s, int *nsamples,
     *nsamples = 0;
 
     init_get_bits(&s->gb, buf, buf_size*8);
-    get_bits(&s->gb, s->bitindex);
+    skip_bits_long(&s->gb, s->bitindex); /* may be 0, get_bits() can't */
 
     int n = 0;
     while (n < NUM_DEC_LOOPS) {
@@ -418,7 +418,7 @@ int shorten_init(ShortenContext* s, uint8_t *buf, int buf_size)
     s->nmean = -1;
 
     init_get_bits(&s->gb, buf, buf_size*8);
-    get_bits(&s->gb, s->bitindex);
+    skip_bits_long(&s->gb, s->bitindex); /* may be 0, get_bits() can't */
 
     /* shorten signature */
     if (get_bits_long(&s->gb, 32) != bswap_32(ff_get_fourcc("ajkg"))) {
@@ -305,7 +305,6 @@ static bool read_chunk_stsd(qtmovie_t *qtmovie, size_t chunk_len)
 
 static bool read_chunk_stts(qtmovie_t *qtmovie, size_t chunk_len)
 {
-    unsigned int i;
     uint32_t numentries;
     size_t size_remaining = chunk_len - 8;
 
@@ -330,12 +329,10 @@ static bool read_chunk_stts(qtmovie_t *qtmovie, size_t chunk_len)
         return false;
     }
 
-    for (i = 0; i < numentries; i++)
-    {
-        qtmovie->res->time_to_sample[i].sample_count = stream_read_uint32(qtmovie->stream);
-        qtmovie->res->time_to_sample[i].sample_duration = stream_read_uint32(qtmovie->stream);
-        size_remaining -= 8;
-    }
+    /* each entry is a sample_count, sample_duration pair */
+    stream_read_uint32_array(qtmovie->stream, numentries * 2,
+                             (uint32_t *)qtmovie->res->time_to_sample);
+    size_remaining -= numentries * 8;
 
     if (size_remaining)
     {
@@ -359,19 +356,17 @@ static bool read_chunk_stsz(qtmovie_t *qtmovie, size_t chunk_len)
     stream_read_uint8(qtmovie->stream);
     size_remaining -= 3;
 
-    /* default sample size */
-    if (stream_read_uint32(qtmovie->stream) != 0)
-    {
-        DEBUGF("i was expecting variable samples sizes\n");
-        stream_read_uint32(qtmovie->stream);
-        size_remaining -= 4;
-        return true;
-    }
+    /* default sample size, the table is empty if it is set */
+    qtmovie->res->sample_byte_size = stream_read_uint32(qtmovie->stream);
     size_remaining -= 4;
 
     qtmovie->res->num_sample_byte_sizes = stream_read_uint32(qtmovie->stream);
     size_remaining -= 4;
 
+    /* The sizes themselves are not kept in memory, m4a_seek() and
+     * m4a_seek_raw() page the few they need back in from the file. */
+    qtmovie->res->sample_byte_sizes_offset = stream_tell(qtmovie->stream);
+
     if (size_remaining)
     {
         stream_skip(qtmovie->stream, size_remaining);
@@ -404,11 +399,12 @@ static bool read_chunk_stsc(qtmovie_t *qtmovie, size_t chunk_len)
 
     for (i = 0; i < numentries; i++)
     {
-        qtmovie->res->sample_to_chunk[i].first_chunk = 
-            stream_read_uint32(qtmovie->stream);
-        qtmovie->res->sample_to_chunk[i].num_samples = 
-            stream_read_uint32(qtmovie->stream);
-        stream_read_uint32(qtmovie->stream);
+        /* first chunk, samples per chunk, sample description index */
+        uint32_t entry[3];
+
+        stream_read_uint32_array(qtmovie->stream, 3, entry);
+        qtmovie->res->sample_to_chunk[i].first_chunk = entry[0];
+        qtmovie->res->sample_to_chunk[i].num_samples = entry[1];
         size_remaining -= 12;
     }
 
@@ -431,6 +427,9 @@ static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
     uint32_t old_first;
     uint32_t new_first;
     uint32_t old_frame;
+    uint32_t offsets[64];   /* stco entries, read a block at a time */
+    uint32_t num_offsets;
+    uint32_t next_offset;
     size_t size_remaining = chunk_len - 8;
 
     /* version + flags */
@@ -449,21 +448,23 @@ static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
         return false;
     }
 
-    /* read first offset */
-    offset = stream_read_uint32(qtmovie->stream);
-    size_remaining -= 4;
+    /* read first block of offsets, stco has one per chunk and long files
+     * have tens of thousands of them */
+    num_offsets = MIN(numentries, ARRAYLEN(offsets));
+    stream_read_uint32_array(qtmovie->stream, num_offsets, offsets);
+    size_remaining -= num_offsets * 4;
+    offset = offsets[0];
+    next_offset = 1;
     
     /* Build up lookup table. The lookup table contains the sample index and
      * byte position in the file for each chunk. This table is used to seek
      * and resume (see m4a_seek() and m4a_seek_raw() in libm4a/m4a.c) and 
      * to skip empty chunks (see m4a_check_sample_offset() in codecs/aac.c and
      * libm4a/m4a.c).
-     * The seek/resume precision is lower than using sample_byte_size[] and 
-     * depends on numentries. Typically the resolution is ~1/10 of all frames
-     * which equals about 1/4-1/2 seconds. The loss of seek precision is 
-     * accepted to be able to avoid allocation of the large sample_byte_size[] 
-     * table. This reduces the memory consumption by a factor of 2 or even 
-     * more. */
+     * Only the chunks are held in memory, not sample_byte_size[], which
+     * would take twice as much or more. Seeking finds the chunk here and
+     * then pages in the sizes of the samples before the target within that
+     * chunk from the stsz atom in the file. */
     i = 1;
     old_i = 1;
     frame = 0;
@@ -496,8 +497,14 @@ static bool read_chunk_stco(qtmovie_t *qtmovie, size_t chunk_len)
         
         frame -= (k - old_first) * old_frame;
         
-        offset = stream_read_uint32(qtmovie->stream);
-        size_remaining -= 4;
+        if (next_offset == num_offsets)
+        {
+            num_offsets = MIN(numentries - k, ARRAYLEN(offsets));
+            stream_read_uint32_array(qtmovie->stream, num_offsets, offsets);
+            size_remaining -= num_offsets * 4;
+            next_offset = 0;
+        }
+        offset = offsets[next_offset++];
     }
     /* zero-terminate the lookup table */
     qtmovie->res->lookup_table[idx].sample = 0;
@@ -67,6 +67,18 @@ uint32_t stream_read_uint32(stream_t *stream)
     return v;
 }
 
+/* Read count big-endian 32-bit words in one go. Returns the number read. */
+size_t stream_read_uint32_array(stream_t *stream, size_t count, uint32_t *buf)
+{
+    count = stream->ci->read_filebuf(buf, count * 4) / 4;
+    if (stream->ci->curpos >= stream->ci->filesize) { stream->eof=1; }
+#ifdef ROCKBOX_LITTLE_ENDIAN
+    for (size_t i = 0; i < count; i++)
+        _Swap32(buf[i]);
+#endif
+    return count;
+}
+
 uint16_t stream_read_uint16(stream_t *stream)
 {
     uint16_t v;
@@ -114,8 +126,8 @@ void stream_create(stream_t *stream,struct codec_api* ci)
  * reduces the overall loop count significantly. */
 int m4a_check_sample_offset(demux_res_t *demux_res, uint32_t frame, uint32_t *start)
 {
-    uint32_t i = *start;
-    for (i=0; i<demux_res->num_lookup_table; ++i)
+    uint32_t i;
+    for (i=*start; i<demux_res->num_lookup_table; ++i)
     {
         if (demux_res->lookup_table[i].sample > frame ||
             demux_res->lookup_table[i].offset == 0)
@@ -144,11 +156,68 @@ static void gather_offset(demux_res_t *demux_res, uint32_t *frame, uint32_t *off
     *offset = demux_res->lookup_table[i].offset;
 }
 
+/* Return the byte size of the given sample (=frame), or 0 if it can't be
+ * read. sample_byte_size[] isn't kept in memory, so the stsz entries are
+ * paged in from the file SAMPLE_SIZE_CACHE at a time, starting with the one
+ * asked for. This moves the stream position. */
+static uint32_t get_sample_size(demux_res_t *demux_res, stream_t *stream,
+    uint32_t frame)
+{
+    uint32_t count;
+
+    if (demux_res->sample_byte_size)
+        return demux_res->sample_byte_size;
+
+    if (frame >= demux_res->num_sample_byte_sizes)
+        return 0;
+
+    if (frame - demux_res->sample_size_cache_first >=
+        demux_res->sample_size_cache_count)
+    {
+        count = MIN(demux_res->num_sample_byte_sizes - frame,
+                    SAMPLE_SIZE_CACHE);
+        demux_res->sample_size_cache_count = 0;
+
+        if (!stream->ci->seek_buffer(demux_res->sample_byte_sizes_offset +
+                                     frame * 4) ||
+            stream_read_uint32_array(stream, count,
+                                     demux_res->sample_size_cache) != count)
+            return 0;
+
+        demux_res->sample_size_cache_first = frame;
+        demux_res->sample_size_cache_count = count;
+    }
+
+    return demux_res->sample_size_cache[frame -
+                                        demux_res->sample_size_cache_first];
+}
+
+/* Return the number of sound samples before the given sample (=frame). */
+static uint32_t get_sound_sample(demux_res_t *demux_res, uint32_t frame)
+{
+    uint32_t i;
+    uint32_t sound_sample = 0;
+    time_to_sample_t *tab = demux_res->time_to_sample;
+
+    for (i = 0; i < demux_res->num_time_to_samples; ++i)
+    {
+        if (frame <= tab[i].sample_count)
+            return sound_sample + frame * tab[i].sample_duration;
+
+        frame        -= tab[i].sample_count;
+        sound_sample += tab[i].sample_count * tab[i].sample_duration;
+    }
+
+    return sound_sample;
+}
+
 /* Seek to desired sound sample location. Return 1 on success (and modify
  * sound_samples_done and current_sample), 0 if failed.
  *
- * Find the sample (=frame) that contains the given sound sample, find a best
- * fit for this sample in the lookup_table[], seek to the byte position. */
+ * Find the sample (=frame) that contains the given sound sample, find its
+ * chunk in the lookup_table[] and add the sizes of the samples before it in
+ * that chunk, seek to the byte position. If those sizes can't be read, seek
+ * to the start of the chunk instead. */
 unsigned int m4a_seek(demux_res_t* demux_res, stream_t* stream, 
     uint32_t sound_sample_loc, uint32_t* sound_samples_done, 
     int* current_sample)
@@ -157,7 +226,10 @@ unsigned int m4a_seek(demux_res_t* demux_res, stream_t* stream,
     uint32_t tmp_var, tmp_cnt, tmp_dur;
     uint32_t new_sample = 0;       /* Holds the amount of chunks/frames. */
     uint32_t new_sound_sample = 0; /* Sums up total amount of samples. */
+    uint32_t chunk_sample;
+    uint32_t size;
     uint32_t new_pos;              /* Holds the desired chunk/frame index. */
+    uint32_t old_pos = stream->ci->curpos;
 
     /* First check we have the appropriate metadata - we should always
      * have it.
@@ -178,7 +250,6 @@ unsigned int m4a_seek(demux_res_t* demux_res, stream_t* stream,
         {
             tmp_var = (sound_sample_loc - new_sound_sample);
             new_sample       += tmp_var / tmp_dur;
-            new_sound_sample += tmp_var;
             break;
         }
         new_sample       += tmp_cnt;
@@ -186,8 +257,23 @@ unsigned int m4a_seek(demux_res_t* demux_res, stream_t* stream,
         ++i;
     }
 
-    /* We know the new sample (=frame), now calculate the file position. */
-    gather_offset(demux_res, &new_sample, &new_pos);
+    /* We know the new sample (=frame), find the chunk holding it and its
+     * file position... */
+    chunk_sample = new_sample;
+    gather_offset(demux_res, &chunk_sample, &new_pos);
+
+    /* ...then step over the samples before it in the chunk. */
+    for (; chunk_sample < new_sample; ++chunk_sample)
+    {
+        size = get_sample_size(demux_res, stream, chunk_sample);
+        if (size == 0)
+        {
+            gather_offset(demux_res, &new_sample, &new_pos);
+            break;
+        }
+        new_pos += size;
+    }
+    new_sound_sample = get_sound_sample(demux_res, new_sample);
 
     /* We know the new file position, so let's try to seek to it */
     if (stream->ci->seek_buffer(new_pos))
@@ -197,6 +283,7 @@ unsigned int m4a_seek(demux_res_t* demux_res, stream_t* stream,
         return 1;
     }
     
+    stream->ci->seek_buffer(old_pos);
     return 0;
 }
 
@@ -208,12 +295,14 @@ unsigned int m4a_seek(demux_res_t* demux_res, stream_t* stream,
  * 1) the lookup_table array contains the file offset for the first sample
  *    of each chunk.
  *
- * 2) the time_to_sample array contains the duration (in sound samples) 
+ * 2) the sample sizes in the stsz atom, paged in by get_sample_size().
+ *
+ * 3) the time_to_sample array contains the duration (in sound samples) 
  *    of each sample of data.
  *
- * Locate the chunk containing location (using lookup_table), find the first
- * sample of that chunk (using lookup_table). Then use time_to_sample to
- * calculate the sound_samples_done value.
+ * Locate the chunk containing location (using lookup_table), step through
+ * its samples up to the one containing location (using the sample sizes).
+ * Then use time_to_sample to calculate the sound_samples_done value.
  */
 unsigned int m4a_seek_raw(demux_res_t* demux_res, stream_t* stream,
     uint32_t file_loc, uint32_t* sound_samples_done, 
@@ -221,39 +310,42 @@ unsigned int m4a_seek_raw(demux_res_t* demux_res, stream_t* stream,
 {
     uint32_t i;
     uint32_t chunk_sample     = 0;
-    uint32_t total_samples    = 0;
+    uint32_t next_chunk_sample;
     uint32_t new_sound_sample = 0;
-    uint32_t tmp_dur;
-    uint32_t tmp_cnt;
+    uint32_t size;
     uint32_t new_pos;
+    uint32_t old_pos = stream->ci->curpos;
 
     /* We know the desired byte offset, search for the chunk right before. 
      * Return the associated sample to this chunk as chunk_sample. */
     for (i=0; i < demux_res->num_lookup_table; ++i)
     {
-        if (demux_res->lookup_table[i].offset > file_loc)
+        if (demux_res->lookup_table[i].offset == 0 ||
+            demux_res->lookup_table[i].offset > file_loc)
             break;
     }
     i = (i>0) ? i-1 : 0; /* We want the last chunk _before_ file_loc. */
     chunk_sample = demux_res->lookup_table[i].sample;
     new_pos      = demux_res->lookup_table[i].offset;
-    
-    /* Get sound sample offset. */
-    i = 0;
-    time_to_sample_t *tab2 = demux_res->time_to_sample;
-    while (i < demux_res->num_time_to_samples)
+
+    /* Step over the samples that end before file_loc, but stay in the
+     * chunk. */
+    if (i + 1 < demux_res->num_lookup_table &&
+        demux_res->lookup_table[i + 1].offset != 0)
+        next_chunk_sample = demux_res->lookup_table[i + 1].sample;
+    else
+        next_chunk_sample = demux_res->num_sample_byte_sizes;
+
+    for (; chunk_sample + 1 < next_chunk_sample; ++chunk_sample)
     {
-        tmp_dur = tab2[i].sample_duration;
-        tmp_cnt = tab2[i].sample_count;
-        total_samples    += tmp_cnt;
-        new_sound_sample += tmp_cnt * tmp_dur;
-        if (chunk_sample <= total_samples)
-        {
-            new_sound_sample += (chunk_sample - total_samples) * tmp_dur;
+        size = get_sample_size(demux_res, stream, chunk_sample);
+        if (size == 0 || new_pos + size > file_loc)
             break;
-        }
-        ++i;
+        new_pos += size;
     }
+    
+    /* Get sound sample offset. */
+    new_sound_sample = get_sound_sample(demux_res, chunk_sample);
 
     /* Go to the new file position. */
     if (stream->ci->seek_buffer(new_pos)) 
@@ -263,5 +355,6 @@ unsigned int m4a_seek_raw(demux_res_t* demux_res, stream_t* stream,
         return 1;
     } 
 
+    stream->ci->seek_buffer(old_pos);
     return 0;
 }
@@ -38,6 +38,9 @@
 
 #define MAX_CODECDATA_SIZE  64
 
+/* Number of stsz entries paged in at a time when seeking, see m4a.c */
+#define SAMPLE_SIZE_CACHE   64
+
 typedef struct {
   struct codec_api* ci;
   int eof;
@@ -81,6 +84,12 @@ typedef struct
     uint32_t num_time_to_samples;
 
     uint32_t num_sample_byte_sizes;
+    uint32_t sample_byte_size;          /* size of every sample, or 0 */
+    uint32_t sample_byte_sizes_offset;  /* file position of the stsz entries */
+
+    uint32_t sample_size_cache_first;
+    uint32_t sample_size_cache_count;
+    uint32_t sample_size_cache[SAMPLE_SIZE_CACHE];
 
     uint32_t codecdata_len;
     uint8_t codecdata[MAX_CODECDATA_SIZE];
@@ -116,6 +125,7 @@ void stream_read(stream_t *stream, size_t len, void *buf);
 int32_t stream_tell(stream_t *stream);
 int32_t stream_read_int32(stream_t *stream);
 uint32_t stream_read_uint32(stream_t *stream);
+size_t stream_read_uint32_array(stream_t *stream, size_t count, uint32_t *buf);
 
 uint16_t stream_read_uint16(stream_t *stream);
 
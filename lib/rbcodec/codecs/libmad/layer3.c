@@ -44,6 +44,7 @@
 # include "frame.h"
 # include "huffman.h"
 # include "layer3.h"
+# include "simd.h"
 
 /* depending on the cpu "leftshift32" may be supported or not */
 # if defined(CPU_COLDFIRE)
@@ -2282,7 +2283,197 @@ void imdct36(mad_fixed_t const X[18], mad_fixed_t x[36])
   /* pfew */
 }
 
-#  else /* if defined(CPU_COLDFIRE) */
+#  else /* not CPU_COLDFIRE */
+#   if defined(MAD_SIMD)
+
+/*
+ * The twelve long sums of the scalar imdct36() below, over X[0], X[2], X[3],
+ * X[5], ..., X[17], are a matrix times those inputs, done a column at a time
+ * into three vectors of outputs. The two sets of four over X[1], X[7], X[10],
+ * X[16] and over t8 .. t11 go the same way, and only the few sums of two
+ * are left scalar. Each mad_f_mul() is the rounded input times the rounded
+ * coefficient, so rounding the coefficients at compile time and the inputs
+ * once gives the same wrapped sums.
+ */
+#   define K(x) VK(MAD_F(x))
+
+/* into x[6], x[0], x[8], x[2] / x[23], x[24], x[21], x[3] /
+ * x[18], x[5], x[20], x[26] */
+static mad_vec_t const imdct36_k[12][3] = {
+  /* X[0] */
+  { { K(0x03768962), K(0x0acf37ad), K(0x00b2aa3e), K(0x0898c779) },
+    { K(-0x0f426cb5), K(-0x0f9ee890), K(-0x0e313245), K(0x07635284) },
+    { K(-0x0bcbe352), K(0x04cfb0e2), K(-0x0d7e8807), K(-0x0ffc19fd) } },
+  /* X[2] */
+  { { K(0x0e313245), K(-0x0898c779), K(0x03768962), K(0x04cfb0e2) },
+    { K(-0x00b2aa3e), K(-0x07635284), K(0x0bcbe352), K(0x0acf37ad) },
+    { K(0x0d7e8807), K(0x0ffc19fd), K(0x0f426cb5), K(-0x0f9ee890) } },
+  /* X[3] */
+  { { K(-0x0ffc19fd), K(0x0e313245), K(-0x04cfb0e2), K(0x0bcbe352) },
+    { K(0x0898c779), K(-0x00b2aa3e), K(0x0f9ee890), K(0x03768962) },
+    { K(-0x07635284), K(-0x0d7e8807), K(0x0acf37ad), K(-0x0f426cb5) } },
+  /* X[5] */
+  { { K(-0x0acf37ad), K(-0x0f426cb5), K(-0x07635284), K(0x00b2aa3e) },
+    { K(0x0f9ee890), K(0x0bcbe352), K(-0x0898c779), K(0x0d7e8807) },
+    { K(0x04cfb0e2), K(0x03768962), K(-0x0ffc19fd), K(-0x0e313245) } },
+  /* X[6] */
+  { { K(0x04cfb0e2), K(-0x03768962), K(0x0898c779), K(0x0e313245) },
+    { K(0x0acf37ad), K(0x0f426cb5), K(-0x0ffc19fd), K(-0x00b2aa3e) },
+    { K(0x0f9ee890), K(-0x0bcbe352), K(-0x07635284), K(-0x0d7e8807) } },
+  /* X[8] */
+  { { K(-0x0898c779), K(0x00b2aa3e), K(0x0acf37ad), K(-0x03768962) },
+    { K(-0x07635284), K(0x0d7e8807), K(0x04cfb0e2), K(0x0f426cb5) },
+    { K(-0x0ffc19fd), K(-0x0e313245), K(0x0f9ee890), K(-0x0bcbe352) } },
+  /* X[9] */
+  { { K(0x0d7e8807), K(-0x0ffc19fd), K(-0x0bcbe352), K(0x0f9ee890) },
+    { K(-0x0e313245), K(0x0898c779), K(0x0f426cb5), K(-0x04cfb0e2) },
+    { K(-0x00b2aa3e), K(0x07635284), K(0x03768962), K(-0x0acf37ad) } },
+  /* X[11] */
+  { { K(0x0f426cb5), K(0x0f9ee890), K(-0x0d7e8807), K(-0x07635284) },
+    { K(-0x0bcbe352), K(-0x04cfb0e2), K(-0x00b2aa3e), K(0x0ffc19fd) },
+    { K(0x03768962), K(-0x0acf37ad), K(-0x0e313245), K(-0x0898c779) } },
+  /* X[12] */
+  { { K(-0x0bcbe352), K(-0x04cfb0e2), K(0x0e313245), K(0x0ffc19fd) },
+    { K(-0x03768962), K(-0x0acf37ad), K(-0x0d7e8807), K(-0x0898c779) },
+    { K(-0x0f426cb5), K(0x0f9ee890), K(0x00b2aa3e), K(-0x07635284) } },
+  /* X[14] */
+  { { K(0x00b2aa3e), K(0x07635284), K(0x0f426cb5), K(-0x0acf37ad) },
+    { K(0x0d7e8807), K(-0x0ffc19fd), K(-0x03768962), K(0x0f9ee890) },
+    { K(0x0e313245), K(0x0898c779), K(0x0bcbe352), K(-0x04cfb0e2) } },
+  /* X[15] */
+  { { K(-0x07635284), K(0x0d7e8807), K(-0x0f9ee890), K(0x0f426cb5) },
+    { K(0x0ffc19fd), K(-0x0e313245), K(0x0acf37ad), K(-0x0bcbe352) },
+    { K(0x0898c779), K(0x00b2aa3e), K(-0x04cfb0e2), K(-0x03768962) } },
+  /* X[17] */
+  { { K(-0x0f9ee890), K(-0x0bcbe352), K(-0x0ffc19fd), K(-0x0d7e8807) },
+    { K(0x04cfb0e2), K(-0x03768962), K(0x07635284), K(0x0e313245) },
+    { K(-0x0acf37ad), K(0x0f426cb5), K(-0x0898c779), K(-0x00b2aa3e) } }
+};
+
+/* into t1, t2, t3, t5 */
+static mad_vec_t const imdct36_kx[4] = {
+  /* X[1] */
+  { K(-0x09bd7ca0), K(-0x0cb19346), K(-0x0216a2a2), K(-0x0fdcf549) },
+  /* X[7] */
+  { K(0x0216a2a2), K(0x0fdcf549), K(-0x09bd7ca0), K(-0x0cb19346) },
+  /* X[10] */
+  { K(-0x0fdcf549), K(0x0216a2a2), K(0x0cb19346), K(-0x09bd7ca0) },
+  /* X[16] */
+  { K(0x0cb19346), K(-0x09bd7ca0), K(0x0fdcf549), K(-0x0216a2a2) }
+};
+
+/* into x[7], x[19], x[1], x[25] */
+static mad_vec_t const imdct36_kt[4] = {
+  /* t8 */
+  { K(0x0216a2a2), K(-0x0cb19346), K(0x09bd7ca0), K(-0x0fdcf549) },
+  /* t9 */
+  { K(0x09bd7ca0), K(0x0fdcf549), K(-0x0216a2a2), K(-0x0cb19346) },
+  /* t10 */
+  { K(-0x0cb19346), K(0x0216a2a2), K(0x0fdcf549), K(-0x09bd7ca0) },
+  /* t11 */
+  { K(-0x0fdcf549), K(-0x09bd7ca0), K(-0x0cb19346), K(-0x0216a2a2) }
+};
+
+#   undef K
+
+static MAD_SIMD_TARGET
+void imdct36_simd(mad_fixed_t const X[18], mad_fixed_t x[36])
+{
+  mad_fixed_t t0, t4, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15;
+  register mad_fixed64hi_t hi;
+  register mad_fixed64lo_t lo;
+  mad_vec_t r[3], t, p0, p1, p2, q, xi;
+  int i;
+
+  MAD_F_ML0(hi, lo, (t14 = X[1] - X[10]), -MAD_F(0x0ec835e8));
+  MAD_F_MLA(hi, lo, (t15 = X[7] + X[16]),  MAD_F(0x061f78aa));
+  t4 = MAD_F_MLZ(hi, lo);
+
+  MAD_F_ML0(hi, lo, X[4],  MAD_F(0x0ec835e8));
+  MAD_F_MLA(hi, lo, X[13], MAD_F(0x061f78aa));
+  t6 = MAD_F_MLZ(hi, lo);
+
+  MAD_F_MLA(hi, lo, t14, -MAD_F(0x061f78aa));
+  MAD_F_MLA(hi, lo, t15, -MAD_F(0x0ec835e8));
+  t0 = MAD_F_MLZ(hi, lo);
+
+  MAD_F_ML0(hi, lo, X[4],   MAD_F(0x061f78aa));
+  MAD_F_MLA(hi, lo, X[13], -MAD_F(0x0ec835e8));
+  t7 = MAD_F_MLZ(hi, lo);
+  t4 -= t7;
+
+  t8  = X[0] - X[11] - X[12];
+  t9  = X[2] - X[ 9] - X[14];
+  t10 = X[3] - X[ 8] - X[15];
+  t11 = X[5] - X[ 6] - X[17];
+  t12 = t8 - t10;
+  t13 = t9 + t11;
+
+  /* t1, t2, t3, t5 */
+  r[0] = vround((mad_vec_t){ X[1], X[7], X[10], X[16] }, 12);
+  t = vdup(r[0][0]) * imdct36_kx[0] + vdup(r[0][1]) * imdct36_kx[1] +
+      vdup(r[0][2]) * imdct36_kx[2] + vdup(r[0][3]) * imdct36_kx[3] +
+      (mad_vec_t){ t6, t7, t7, -t6 };
+
+  /* x[7], x[19], x[1], x[25] */
+  r[0] = vround((mad_vec_t){ t8, t9, t10, t11 }, 12);
+  q = vdup(r[0][0]) * imdct36_kt[0] + vdup(r[0][1]) * imdct36_kt[1] +
+      vdup(r[0][2]) * imdct36_kt[2] + vdup(r[0][3]) * imdct36_kt[3] +
+      (mad_vec_t){ t0, -t0, t4, t4 };
+
+  r[0] = vround(VSHUF(vload(&X[0]),  vload(&X[4]),  0, 2, 3, 5), 12);
+  r[1] = vround(VSHUF(vload(&X[4]),  vload(&X[8]),  2, 4, 5, 7), 12);
+  r[2] = vround(VSHUF(vload(&X[12]), vload(&X[14]), 0, 2, 3, 7), 12);
+
+  p0 = t;
+  p1 = t;
+  p2 = VSHUF(-t, t, 0, 5, 2, 7);
+  for (i = 0; i < 12; ++i) {
+    xi = vdup(r[i / 4][i % 4]);
+    p0 += xi * imdct36_k[i][0];
+    p1 += xi * imdct36_k[i][1];
+    p2 += xi * imdct36_k[i][2];
+  }
+
+  x[11] = -(x[6] = p0[0]);
+  x[17] = -(x[0] = p0[1]);
+  x[ 9] = -(x[8] = p0[2]);
+  x[15] = -(x[2] = p0[3]);
+
+  x[23] = x[30] = p1[0];
+  x[24] = x[29] = p1[1];
+  x[21] = x[32] = p1[2];
+  x[14] = -(x[3] = p1[3]);
+
+  x[18] = x[35] = p2[0];
+  x[12] = -(x[5] = p2[1]);
+  x[20] = x[33] = p2[2];
+  x[26] = x[27] = p2[3];
+
+  x[10] = -(x[7] = q[0]);
+  x[19] = x[34] = q[1];
+  x[16] = -(x[1] = q[2]);
+  x[25] = x[28] = q[3];
+
+  MAD_F_ML0(hi, lo, t12, -MAD_F(0x0ec835e8));
+  MAD_F_MLA(hi, lo, t13,  MAD_F(0x061f78aa));
+  x[22] = x[31] = MAD_F_MLZ(hi, lo) + t0;
+
+  MAD_F_ML0(hi, lo, t12, MAD_F(0x061f78aa));
+  MAD_F_MLA(hi, lo, t13, MAD_F(0x0ec835e8));
+  x[13] = -(x[4] = MAD_F_MLZ(hi, lo) + t4);
+}
+
+/* the normal window, the other ones are left to the scalar code */
+static MAD_SIMD_TARGET
+void window_l_simd(mad_fixed_t z[36])
+{
+  unsigned int i;
+
+  for (i = 0; i < 36; i += 4)
+    vstore(&z[i], vmul(vload(&z[i]), vround(vload(&window_l[i]), 16)));
+}
+#   endif /* MAD_SIMD */
 
 static inline
 void imdct36(mad_fixed_t const X[18], mad_fixed_t x[36])
@@ -2552,6 +2743,16 @@ void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36],
 
   /* IMDCT */
 
+# if defined(MAD_SIMD)
+  if (mad_simd_ok()) {
+    imdct36_simd(X, z);
+    if (block_type == 0) {
+      window_l_simd(z);
+      return;
+    }
+  }
+  else
+# endif
   imdct36(X, z);
 
   /* windowing */
@@ -0,0 +1,98 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* Four lane vectors of mad_fixed_t for the FPM_DEFAULT versions of dct32(),
+ * synth_full() and III_imdct_l(), written with the compiler's generic vector
+ * extensions. FPM_DEFAULT and OPT_SSO only ever do 32-bit multiplies and adds
+ * that wrap, so the lanes give exactly what the scalar code does. The players
+ * have their own assembly and FPMs, so this only comes into the x86
+ * application, simulator and warble builds. Plain SSE2 has no 32-bit lane
+ * multiply and emulating it leaves synth_full() slower than the scalar code,
+ * so the vector functions are built for SSE4.1 with MAD_SIMD_TARGET and only
+ * called when mad_simd_ok() finds it at run time; the scalar ones stay for
+ * other CPUs. The code itself is generic, but AArch64 NEON hasn't been
+ * tested against the scalar output and isn't enabled. */
+
+#ifndef LIBMAD_SIMD_H
+#define LIBMAD_SIMD_H
+
+#if defined(FPM_DEFAULT) && (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ >= 5)
+#define MAD_SIMD
+
+#define MAD_SIMD_TARGET __attribute__((target("sse4.1")))
+#define mad_simd_ok()   __builtin_cpu_supports("sse4.1")
+
+typedef mad_fixed_t mad_vec_t __attribute__((vector_size(16)));
+/* for loads and stores that are only mad_fixed_t aligned */
+typedef mad_fixed_t mad_uvec_t __attribute__((vector_size(16), aligned(4),
+                                              may_alias));
+
+#if defined(__clang__)
+#define VSHUF(a, b, i0, i1, i2, i3) \
+    __builtin_shufflevector((a), (b), i0, i1, i2, i3)
+#else
+#define VSHUF(a, b, i0, i1, i2, i3) \
+    __builtin_shuffle((a), (b), (mad_vec_t){ i0, i1, i2, i3 })
+#endif
+
+#define VREV(a) VSHUF(a, a, 3, 2, 1, 0)
+
+/* mad_f_mul()'s rounding of a constant second operand, done at compile
+ * time */
+#define VK(y) ((((y) + (1L << 15)) >> 16))
+
+static inline MAD_SIMD_TARGET mad_vec_t vload(mad_fixed_t const *p)
+{
+    return *(mad_uvec_t const *)p;
+}
+
+static inline MAD_SIMD_TARGET void vstore(mad_fixed_t *p, mad_vec_t v)
+{
+    *(mad_uvec_t *)p = v;
+}
+
+static inline MAD_SIMD_TARGET mad_vec_t vdup(mad_fixed_t x)
+{
+    return (mad_vec_t){ x, x, x, x };
+}
+
+/* x >> bits rounded to nearest, as mad_f_mul() does to its operands, but
+ * without the add that rounds overflowing */
+static inline MAD_SIMD_TARGET mad_vec_t vround(mad_vec_t x, int bits)
+{
+    return (x >> bits) + ((x >> (bits - 1)) & 1);
+}
+
+/* mad_f_mul(x, y) for a y already rounded with VK() or vround(y, 16) */
+static inline MAD_SIMD_TARGET mad_vec_t vmul(mad_vec_t x, mad_vec_t k)
+{
+    return vround(x, 12) * k;
+}
+
+/* sums of the lanes of a and of b, in lanes 0 and 2 */
+static inline MAD_SIMD_TARGET mad_vec_t vsum2(mad_vec_t a, mad_vec_t b)
+{
+    mad_vec_t t = VSHUF(a, b, 0, 1, 4, 5) + VSHUF(a, b, 2, 3, 6, 7);
+    return t + VSHUF(t, t, 1, 0, 3, 2);
+}
+
+#endif /* FPM_DEFAULT && x86 */
+
+#endif /* LIBMAD_SIMD_H */
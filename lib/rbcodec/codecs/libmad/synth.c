@@ -28,6 +28,7 @@
 # include "fixed.h"
 # include "frame.h"
 # include "synth.h"
+# include "simd.h"
 
 /*
  * NAME:        synth->init()
@@ -140,39 +141,7 @@ void dct32(mad_fixed_t const in[32], unsigned int slot,
 #  define MUL(x, y)  mad_f_mul((x), (y>>3))
 # endif
 
-/*
- * NAME:        dct32()
- * DESCRIPTION: perform fast in[32]->out[32] DCT
- */
-static
-void dct32(mad_fixed_t const in[32], unsigned int slot,
-           mad_fixed_t lo[16][8], mad_fixed_t hi[16][8])
-{
-  mad_fixed_t t0,   t1,   t2,   t3,   t4,   t5,   t6,   t7;
-  mad_fixed_t t8,   t9,   t10,  t11,  t12,  t13,  t14,  t15;
-  mad_fixed_t t16,  t17,  t18,  t19,  t20,  t21,  t22,  t23;
-  mad_fixed_t t24,  t25,  t26,  t27,  t28,  t29,  t30,  t31;
-  mad_fixed_t t32,  t33,  t34,  t35,  t36,  t37,  t38,  t39;
-  mad_fixed_t t40,  t41,  t42,  t43,  t44,  t45,  t46,  t47;
-  mad_fixed_t t48,  t49,  t50,  t51,  t52,  t53,  t54,  t55;
-  mad_fixed_t t56,  t57,  t58,  t59,  t60,  t61,  t62,  t63;
-  mad_fixed_t t64,  t65,  t66,  t67,  t68,  t69,  t70,  t71;
-  mad_fixed_t t72,  t73,  t74,  t75,  t76,  t77,  t78,  t79;
-  mad_fixed_t t80,  t81,  t82,  t83,  t84,  t85,  t86,  t87;
-  mad_fixed_t t88,  t89,  t90,  t91,  t92,  t93,  t94,  t95;
-  mad_fixed_t t96,  t97,  t98,  t99,  t100, t101, t102, t103;
-  mad_fixed_t t104, t105, t106, t107, t108, t109, t110, t111;
-  mad_fixed_t t112, t113, t114, t115, t116, t117, t118, t119;
-  mad_fixed_t t120, t121, t122, t123, t124, t125, t126, t127;
-  mad_fixed_t t128, t129, t130, t131, t132, t133, t134, t135;
-  mad_fixed_t t136, t137, t138, t139, t140, t141, t142, t143;
-  mad_fixed_t t144, t145, t146, t147, t148, t149, t150, t151;
-  mad_fixed_t t152, t153, t154, t155, t156, t157, t158, t159;
-  mad_fixed_t t160, t161, t162, t163, t164, t165, t166, t167;
-  mad_fixed_t t168, t169, t170, t171, t172, t173, t174, t175;
-  mad_fixed_t t176;
-
-  /* costab[i] = cos(PI / (2 * 32) * i) */
+/* costab[i] = cos(PI / (2 * 32) * i) */
 #define costab1   MAD_F(0x7fd8878e) /* 0.998795456 */
 #define costab2   MAD_F(0x7f62368f) /* 0.995184727 */
 #define costab3   MAD_F(0x7e9d55fc) /* 0.989176510 */
@@ -205,6 +174,268 @@ void dct32(mad_fixed_t const in[32], unsigned int slot,
 #define costab30  MAD_F(0x0c8bd35e) /* 0.098017140 */
 #define costab31  MAD_F(0x0647d97c) /* 0.049067674 */
 
+# if defined(MAD_SIMD)
+
+/*
+ * NAME:        dct32()
+ * DESCRIPTION: perform fast in[32]->out[32] DCT
+ *
+ * The same DCT as the scalar version below, whose first five steps are
+ * butterflies: each block of n values, 32, then 16, 8, 4 and 2 of them, is
+ * replaced by the sums of the pairs i, n - 1 - i in its first half and
+ * their differences times costab[(2 * i + 1) * 32 / n] in its second.
+ * That is 16 sums and 16 MUL()s a step, four vector adds and four vector
+ * MUL()s. Bit 4 of an index into the resulting o[] is set for values from
+ * the difference half of the first step, bit 3 for the second step and so
+ * on, so o[0] is the scalar t113 + t114, o[1] MUL(t113 - t114, costab16).
+ * The rest is the scalar recombination reading those values from o[].
+ */
+static MAD_SIMD_TARGET
+void dct32_simd(mad_fixed_t const in[32], unsigned int slot,
+                mad_fixed_t lo[16][8], mad_fixed_t hi[16][8])
+{
+  /* MUL()'s costab operand, rounded by VK() */
+# define CK(n) VK(costab##n >> 3)
+  static mad_vec_t const k1[4] = {
+    { CK(1),  CK(3),  CK(5),  CK(7)  }, { CK(9),  CK(11), CK(13), CK(15) },
+    { CK(17), CK(19), CK(21), CK(23) }, { CK(25), CK(27), CK(29), CK(31) }
+  };
+  static mad_vec_t const k2[2] = {
+    { CK(2),  CK(6),  CK(10), CK(14) }, { CK(18), CK(22), CK(26), CK(30) }
+  };
+  static mad_vec_t const k3 = { CK(4),  CK(12), CK(20), CK(28) };
+  static mad_vec_t const k4 = { CK(8),  CK(24), CK(8),  CK(24) };
+  static mad_vec_t const k5 = { CK(16), CK(16), CK(16), CK(16) };
+# undef CK
+
+  mad_vec_t u[8], v[8], a, b, s, d;
+  mad_fixed_t o[32];
+  mad_fixed_t t49,  t68,  t77,  t82,  t87,  t88,  t99,  t105;
+  mad_fixed_t t111, t112, t117, t120, t123, t124, t127, t130;
+  mad_fixed_t t131, t134, t135, t138, t139, t140, t147, t151;
+  mad_fixed_t t155, t156, t160, t164, t165, t169, t170, t174;
+  mad_fixed_t t175, t176;
+  int i;
+
+  /* where the scalar code has a MUL() inside SHIFT() the sum is done in
+   * MUL()'s type, long */
+# define LONG(x) ((long) (x))
+
+  /* blocks of 32 */
+  for (i = 0; i < 4; ++i) {
+    a = vload(&in[4 * i]);
+    b = VREV(vload(&in[28 - 4 * i]));
+    u[i]     = a + b;
+    u[i + 4] = vmul(a - b, k1[i]);
+  }
+
+  /* blocks of 16 */
+  for (i = 0; i < 8; i += 4) {
+    a = u[i];
+    b = VREV(u[i + 3]);
+    v[i]     = a + b;
+    v[i + 2] = vmul(a - b, k2[0]);
+    a = u[i + 1];
+    b = VREV(u[i + 2]);
+    v[i + 1] = a + b;
+    v[i + 3] = vmul(a - b, k2[1]);
+  }
+
+  /* blocks of 8 */
+  for (i = 0; i < 8; i += 2) {
+    a = v[i];
+    b = VREV(v[i + 1]);
+    u[i]     = a + b;
+    u[i + 1] = vmul(a - b, k3);
+  }
+
+  /* blocks of 4, two vectors at a time */
+  for (i = 0; i < 8; i += 2) {
+    a = VSHUF(u[i], u[i + 1], 0, 1, 4, 5);
+    b = VSHUF(u[i], u[i + 1], 3, 2, 7, 6);
+    s = a + b;
+    d = vmul(a - b, k4);
+    v[i]     = VSHUF(s, d, 0, 1, 4, 5);
+    v[i + 1] = VSHUF(s, d, 2, 3, 6, 7);
+  }
+
+  /* blocks of 2 */
+  for (i = 0; i < 8; i += 2) {
+    a = VSHUF(v[i], v[i + 1], 0, 2, 4, 6);
+    b = VSHUF(v[i], v[i + 1], 1, 3, 5, 7);
+    s = a + b;
+    d = vmul(a - b, k5);
+    vstore(&o[4 * i],     VSHUF(s, d, 0, 4, 1, 5));
+    vstore(&o[4 * i + 4], VSHUF(s, d, 2, 6, 3, 7));
+  }
+
+  /*  0 */ hi[15][slot] = SHIFT(o[0]);
+  /* 16 */ lo[ 0][slot] = SHIFT(o[1]);
+
+  /*  1 */ hi[14][slot] = SHIFT(o[16]);
+
+  /*  2 */ hi[13][slot] = SHIFT(o[8]);
+
+  t49  = (o[24] * 2) - o[16];
+
+  /*  3 */ hi[12][slot] = SHIFT(t49);
+
+  /*  4 */ hi[11][slot] = SHIFT(o[4]);
+
+  t68  = (o[20] * 2) - t49;
+
+  /*  5 */ hi[10][slot] = SHIFT(t68);
+
+  t82  = (o[12] * 2) - o[8];
+
+  /*  6 */ hi[ 9][slot] = SHIFT(t82);
+
+  t87  = (o[28] * 2) - o[24];
+
+  t77  = (t87 * 2) - t68;
+
+  /*  7 */ hi[ 8][slot] = SHIFT(t77);
+
+  /*  8 */ hi[ 7][slot] = SHIFT(o[2]);
+  /* 24 */ lo[ 8][slot] = SHIFT((LONG(o[3]) * 2) - o[2]);
+
+  t88  = (o[18] * 2) - t77;
+
+  /*  9 */ hi[ 6][slot] = SHIFT(t88);
+
+  t105 = (o[10] * 2) - t82;
+
+  /* 10 */ hi[ 5][slot] = SHIFT(t105);
+
+  t111 = (o[26] * 2) - t87;
+
+  t99  = (t111 * 2) - t88;
+
+  /* 11 */ hi[ 4][slot] = SHIFT(t99);
+
+  t127 = (o[6] * 2) - o[4];
+
+  /* 12 */ hi[ 3][slot] = SHIFT(t127);
+
+  t160 = (o[5] * 2) - t127;
+
+  /* 20 */ lo[ 4][slot] = SHIFT(t160);
+  /* 28 */ lo[12][slot] = SHIFT((((LONG(o[7]) * 2) - o[6]) * 2) - t160);
+
+  t130 = (o[22] * 2) - o[20];
+
+  t112 = (t130 * 2) - t99;
+
+  /* 13 */ hi[ 2][slot] = SHIFT(t112);
+
+  t164 = (o[21] * 2) - t130;
+
+  t134 = (o[14] * 2) - o[12];
+
+  t120 = (t134 * 2) - t105;
+
+  /* 14 */ hi[ 1][slot] = SHIFT(t120);
+
+  t135 = (o[9] * 2) - t120;
+
+  /* 18 */ lo[ 2][slot] = SHIFT(t135);
+
+  t169 = (o[13] * 2) - t134;
+
+  t151 = (t169 * 2) - t135;
+
+  /* 22 */ lo[ 6][slot] = SHIFT(t151);
+
+  t170 = (((o[11] * 2) - o[10]) * 2) - t151;
+
+  /* 26 */ lo[10][slot] = SHIFT(t170);
+  /* 30 */ lo[14][slot] =
+             SHIFT((((((LONG(o[15]) * 2) - o[14]) * 2) - t169) * 2) - t170);
+
+  t138 = (o[30] * 2) - o[28];
+
+  t123 = (t138 * 2) - t111;
+
+  t139 = (o[25] * 2) - t123;
+
+  t117 = (t123 * 2) - t112;
+
+  /* 15 */ hi[ 0][slot] = SHIFT(t117);
+
+  t124 = (o[17] * 2) - t117;
+
+  /* 17 */ lo[ 1][slot] = SHIFT(t124);
+
+  t131 = (t139 * 2) - t124;
+
+  /* 19 */ lo[ 3][slot] = SHIFT(t131);
+
+  t140 = (t164 * 2) - t131;
+
+  /* 21 */ lo[ 5][slot] = SHIFT(t140);
+
+  t174 = (o[29] * 2) - t138;
+
+  t155 = (t174 * 2) - t139;
+
+  t147 = (t155 * 2) - t140;
+
+  /* 23 */ lo[ 7][slot] = SHIFT(t147);
+
+  t156 = (((o[19] * 2) - o[18]) * 2) - t147;
+
+  /* 25 */ lo[ 9][slot] = SHIFT(t156);
+
+  t175 = (((o[27] * 2) - o[26]) * 2) - t155;
+
+  t165 = (t175 * 2) - t156;
+
+  /* 27 */ lo[11][slot] = SHIFT(t165);
+
+  t176 = (((((o[23] * 2) - o[22]) * 2) - t164) * 2) - t165;
+
+  /* 29 */ lo[13][slot] = SHIFT(t176);
+  /* 31 */ lo[15][slot] =
+             SHIFT((((((((LONG(o[31]) * 2) - o[30]) * 2) - t174) * 2) - t175) *
+                    2) - t176);
+
+# undef LONG
+}
+
+# endif /* MAD_SIMD */
+
+/*
+ * NAME:        dct32()
+ * DESCRIPTION: perform fast in[32]->out[32] DCT
+ */
+static
+void dct32(mad_fixed_t const in[32], unsigned int slot,
+           mad_fixed_t lo[16][8], mad_fixed_t hi[16][8])
+{
+  mad_fixed_t t0,   t1,   t2,   t3,   t4,   t5,   t6,   t7;
+  mad_fixed_t t8,   t9,   t10,  t11,  t12,  t13,  t14,  t15;
+  mad_fixed_t t16,  t17,  t18,  t19,  t20,  t21,  t22,  t23;
+  mad_fixed_t t24,  t25,  t26,  t27,  t28,  t29,  t30,  t31;
+  mad_fixed_t t32,  t33,  t34,  t35,  t36,  t37,  t38,  t39;
+  mad_fixed_t t40,  t41,  t42,  t43,  t44,  t45,  t46,  t47;
+  mad_fixed_t t48,  t49,  t50,  t51,  t52,  t53,  t54,  t55;
+  mad_fixed_t t56,  t57,  t58,  t59,  t60,  t61,  t62,  t63;
+  mad_fixed_t t64,  t65,  t66,  t67,  t68,  t69,  t70,  t71;
+  mad_fixed_t t72,  t73,  t74,  t75,  t76,  t77,  t78,  t79;
+  mad_fixed_t t80,  t81,  t82,  t83,  t84,  t85,  t86,  t87;
+  mad_fixed_t t88,  t89,  t90,  t91,  t92,  t93,  t94,  t95;
+  mad_fixed_t t96,  t97,  t98,  t99,  t100, t101, t102, t103;
+  mad_fixed_t t104, t105, t106, t107, t108, t109, t110, t111;
+  mad_fixed_t t112, t113, t114, t115, t116, t117, t118, t119;
+  mad_fixed_t t120, t121, t122, t123, t124, t125, t126, t127;
+  mad_fixed_t t128, t129, t130, t131, t132, t133, t134, t135;
+  mad_fixed_t t136, t137, t138, t139, t140, t141, t142, t143;
+  mad_fixed_t t144, t145, t146, t147, t148, t149, t150, t151;
+  mad_fixed_t t152, t153, t154, t155, t156, t157, t158, t159;
+  mad_fixed_t t160, t161, t162, t163, t164, t165, t166, t167;
+  mad_fixed_t t168, t169, t170, t171, t172, t173, t174, t175;
+  mad_fixed_t t176;
+
   t0   = in[0]  + in[31];  t16  = MUL(in[0]  - in[31], costab1);
   t1   = in[15] + in[16];  t17  = MUL(in[15] - in[16], costab31);
 
@@ -910,7 +1141,160 @@ void synth_full(struct mad_synth *synth, struct mad_frame const *frame,
   }
 }
 
-# else /* not FPM_COLDFIRE_EMAC and not FPM_ARM */
+# else /* not FPM_COLDFIRE_EMAC or FPM_ARM */
+#  if defined(MAD_SIMD)
+
+/*
+ * The PROD_O/PROD_A sum f[0] * ptr[0] + f[1] * ptr[14] + ... + f[7] * ptr[2]
+ * is f[0], f[7], f[6], ..., f[1] times ptr[0], ptr[2], ..., ptr[14], so each
+ * filter row is turned around once and each D row split into its even and
+ * odd taps once. PROD_SB is the natural row times ptr[15], ptr[17], ...,
+ * ptr[29], or the row rotated by one times ptr[16], ptr[18], ..., ptr[30].
+ */
+static inline MAD_SIMD_TARGET
+void window_row(mad_fixed_t const f[8], mad_vec_t r[2])
+{
+  mad_vec_t f0 = vload(&f[0]), f1 = vload(&f[4]);
+
+  r[0] = VSHUF(f0, f1, 0, 7, 6, 5);
+  r[1] = VSHUF(f1, f0, 0, 7, 6, 5);
+}
+
+static inline MAD_SIMD_TARGET
+void window_row_rot(mad_fixed_t const f[8], mad_vec_t r[2])
+{
+  mad_vec_t f0 = vload(&f[0]), f1 = vload(&f[4]);
+
+  r[0] = VSHUF(f0, f1, 1, 2, 3, 4);
+  r[1] = VSHUF(f1, f0, 1, 2, 3, 4);
+}
+
+static inline MAD_SIMD_TARGET
+void window_taps(mad_fixed_t const *ptr, mad_vec_t even[2], mad_vec_t odd[2])
+{
+  mad_vec_t d0 = vload(&ptr[0]), d1 = vload(&ptr[4]);
+  mad_vec_t d2 = vload(&ptr[8]), d3 = vload(&ptr[12]);
+
+  even[0] = VSHUF(d0, d1, 0, 2, 4, 6);
+  even[1] = VSHUF(d2, d3, 0, 2, 4, 6);
+  odd[0]  = VSHUF(d0, d1, 1, 3, 5, 7);
+  odd[1]  = VSHUF(d2, d3, 1, 3, 5, 7);
+}
+
+static inline MAD_SIMD_TARGET
+mad_vec_t window_prod(mad_vec_t const f[2], mad_vec_t const d[2])
+{
+  return f[0] * d[0] + f[1] * d[1];
+}
+
+/* one slot of synth_full(); in odd slots fe meets the even taps of the D0
+ * rows and fx and fo the odd ones, in even slots it is the other way round,
+ * and the same goes for the halves of PROD_SB */
+static inline MAD_SIMD_TARGET
+void synth_slot(mad_fixed_t *pcm, mad_fixed_t (*fe)[8], mad_fixed_t (*fx)[8],
+                mad_fixed_t (*fo)[8], mad_fixed_t const (*D0ptr)[32],
+                mad_fixed_t const (*D1ptr)[32], int odd)
+{
+  int sb;
+  mad_vec_t de[2], dodd[2], d15[2], d16[2], unused[2];
+  mad_vec_t re[2], ro[2], ne[2], no[2];
+  mad_vec_t a, b, sum;
+
+  window_taps(*D0ptr, de, dodd);
+  window_row(*fx, ro);
+  window_row(*fe, re);
+  if (odd)
+    a = window_prod(re, de) - window_prod(ro, dodd);
+  else
+    a = window_prod(re, dodd) - window_prod(ro, de);
+  sum = vsum2(a, a);
+  pcm[0] = SHIFT(sum[0]);
+  pcm   += 16;
+
+  for (sb = 15; sb; sb--, fo++) {
+    ++fe;
+    ++D0ptr;
+    ++D1ptr;
+
+    window_taps(*D0ptr, de, dodd);
+    window_row(*fo, ro);
+    window_row(*fe, re);
+
+    /* D[32 - sb][i] == -D[sb][31 - i] */
+    window_taps(&(*D1ptr)[14], unused, d15);
+    window_taps(&(*D1ptr)[16], d16, unused);
+
+    if (odd) {
+      a = window_prod(re, de) - window_prod(ro, dodd);
+      ne[0] = vload(&(*fe)[0]);
+      ne[1] = vload(&(*fe)[4]);
+      window_row_rot(*fo, no);
+      b = window_prod(ne, d15) + window_prod(no, d16);
+    }
+    else {
+      a = window_prod(re, dodd) - window_prod(ro, de);
+      window_row_rot(*fe, ne);
+      no[0] = vload(&(*fo)[0]);
+      no[1] = vload(&(*fo)[4]);
+      b = window_prod(ne, d16) + window_prod(no, d15);
+    }
+
+    sum = vsum2(a, b);
+    pcm[-sb] = SHIFT(sum[0]);
+    pcm[ sb] = SHIFT(sum[2]);
+  }
+
+  window_taps(*(D0ptr + 1), de, dodd);
+  window_row(*fo, ro);
+  a = window_prod(ro, odd ? dodd : de);
+  sum = vsum2(a, a);
+  pcm[0] = SHIFT(-sum[0]);
+}
+
+static MAD_SIMD_TARGET
+void synth_full_simd(struct mad_synth *synth, struct mad_frame const *frame,
+                     unsigned int nch, unsigned int ns)
+{
+  int          p;
+  unsigned int phase, ch, s;
+  mad_fixed_t *pcm, (*filter)[2][2][16][8];
+  mad_fixed_t (*sbsample)[36][32];
+  mad_fixed_t (*fe)[8], (*fx)[8], (*fo)[8];
+  mad_fixed_t const (*D0ptr)[32];
+  mad_fixed_t const (*D1ptr)[32];
+
+  for (ch = 0; ch < nch; ++ch) {
+    sbsample = &(*frame->sbsample_prev)[ch];
+    filter   = &synth->filter[ch];
+    phase    = synth->phase;
+    pcm      = synth->pcm.samples[ch];
+
+    for (s = 0; s < ns; ++s) {
+      dct32_simd((*sbsample)[s], phase >> 1,
+                 (*filter)[0][phase & 1], (*filter)[1][phase & 1]);
+
+      p = (phase - 1) & 0xf;
+
+      /* calculate 32 samples */
+      fe = &(*filter)[0][ phase & 1][0];
+      fx = &(*filter)[0][~phase & 1][0];
+      fo = &(*filter)[1][~phase & 1][0];
+
+      D0ptr = (void*)&D[0][ p];
+      D1ptr = (void*)&D[0][-p];
+
+      if (s & 1)
+        synth_slot(pcm, fe, fx, fo, D0ptr, D1ptr, 1);
+      else
+        synth_slot(pcm, fe, fx, fo, D0ptr, D1ptr, 0);
+
+      pcm  += 32;
+      phase = (phase + 1) % 16;
+    }
+  }
+}
+
+#  endif /* MAD_SIMD */
 
 #define PROD_O(hi, lo, f, ptr, offset) \
         ML0(hi, lo, (*f)[0], ptr[ 0+offset]); \
@@ -1225,6 +1609,11 @@ void mad_synth_frame(struct mad_synth *synth, struct mad_frame const *frame)
   
   synth_frame(synth, frame, nch, ns);
 #else
+# if defined(MAD_SIMD)
+  if (mad_simd_ok())
+    synth_full_simd(synth, frame, nch, ns);
+  else
+# endif
   synth_full(synth, frame, nch, ns);
 #endif
 
@@ -51,6 +51,31 @@ static void exp_rotation1(celt_norm *X, int len, int stride, opus_val16 c, opus_
    celt_norm *Xptr;
    Xptr = X;
    ms = NEG16(s);
+   if (stride == 1)
+   {
+      /* Each rotation feeds the next one, so keep the carried value in a
+         register rather than going through memory for every sample. */
+      celt_norm x1, x2;
+      x1 = X[0];
+      for (i=0;i<len-1;i++)
+      {
+         x2 = X[i+1];
+         X[i] = EXTRACT16(PSHR32(MAC16_16(MULT16_16(c, x1), ms, x2), 15));
+         x1   = EXTRACT16(PSHR32(MAC16_16(MULT16_16(c, x2),  s, x1), 15));
+      }
+      X[len-1] = x1;
+      if (len < 3)
+         return;
+      x1 = X[len-2];
+      for (i=len-3;i>=0;i--)
+      {
+         x2 = X[i];
+         X[i+1] = EXTRACT16(PSHR32(MAC16_16(MULT16_16(c, x1),  s, x2), 15));
+         x1     = EXTRACT16(PSHR32(MAC16_16(MULT16_16(c, x2), ms, x1), 15));
+      }
+      X[0] = x1;
+      return;
+   }
    for (i=0;i<len-stride;i++)
    {
       celt_norm x1, x2;
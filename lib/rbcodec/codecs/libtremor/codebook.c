@@ -252,8 +252,8 @@ STIN long decode_packed_entry_number(codebook *book,
       lo=(entry>>15)&0x7fff;
       hi=book->used_entries-(entry&0x7fff);
     }else{
-      oggpack_adv(b, book->dec_codelengths[entry-1]);
-      return(entry-1);
+      oggpack_adv(b, entry>>24);
+      return((entry&0xffffff)-1);
     }
   }else{
     lo=0;
@@ -322,14 +322,17 @@ static long decode_packed_block(codebook *book, oggpack_buffer *b,
         }
 
         ogg_int32_t entry = book_dec_firsttable[cache&cachemask];
+        int l;
         if(UNLIKELY(entry < 0)){
           const long lo = (entry>>15)&0x7fff, hi = book_used_entries-(entry&0x7fff);
           entry = bisect_codelist(lo, hi, cache, book_codelist);
-        }else
-          entry--;
+          l = book_dec_codelengths[entry];
+        }else{
+          l = entry>>24;
+          entry = (entry&0xffffff)-1;
+        }
 
         *bufptr++ = entry;
-        int l = book_dec_codelengths[entry];
         cachesize -= l;
         cache >>= l;
       }
@@ -385,21 +388,15 @@ long vorbis_book_decodevs_add(codebook *book,ogg_int32_t *a,
     int i,j,o;
     int shift=point-book->binarypoint;
     
+    if(decode_packed_block(book,b,entry,step)<step)return(-1);
+    for (i = 0; i < step; i++)
+      t[i] = book->valuelist+entry[i]*book->dim;
+
     if(shift>=0){
-      for (i = 0; i < step; i++) {
-        entry[i]=decode_packed_entry_number(book,b);
-        if(entry[i]==-1)return(-1);
-        t[i] = book->valuelist+entry[i]*book->dim;
-      }
       for(i=0,o=0;i<book->dim;i++,o+=step)
         for (j=0;j<step;j++)
           a[o+j]+=t[j][i]>>shift;
     }else{
-      for (i = 0; i < step; i++) {
-        entry[i]=decode_packed_entry_number(book,b);
-        if(entry[i]==-1)return(-1);
-        t[i] = book->valuelist+entry[i]*book->dim;
-      }
       for(i=0,o=0;i<book->dim;i++,o+=step)
         for (j=0;j<step;j++)
           a[o+j]+=t[j][i]<<-shift;
@@ -412,26 +409,38 @@ long vorbis_book_decodevs_add(codebook *book,ogg_int32_t *a,
 long vorbis_book_decodev_add(codebook *book,ogg_int32_t *a,
                              oggpack_buffer *b,int n,int point){
   if(book->used_entries>0){
-    int i,j,entry;
-    ogg_int32_t *t;
+    long k,chunk,read;
+    long entries[32];
+    int i,j;
     int shift=point-book->binarypoint;
+    const long dim = book->dim;
+    const ogg_int32_t * const vlist = book->valuelist;
     
+    /* entries are decoded 32 at a time, like in vorbis_book_decodevv_add */
     if(shift>=0){
       for(i=0;i<n;){
-        entry = decode_packed_entry_number(book,b);
-        if(entry==-1)return(-1);
-        t     = book->valuelist+entry*book->dim;
-        for (j=0;j<book->dim;)
-          a[i++]+=t[j++]>>shift;
+        chunk=(n-i+dim-1)/dim;
+        if(chunk>32)chunk=32;
+        read = decode_packed_block(book,b,entries,chunk);
+        for(k=0;k<read;k++){
+          const ogg_int32_t *t = vlist+entries[k]*dim;
+          for (j=0;j<dim;)
+            a[i++]+=t[j++]>>shift;
+        }
+        if(read<chunk)return(-1);
       }
     }else{
       shift = -shift;
       for(i=0;i<n;){
-        entry = decode_packed_entry_number(book,b);
-        if(entry==-1)return(-1);
-        t     = book->valuelist+entry*book->dim;
-        for (j=0;j<book->dim;)
-          a[i++]+=t[j++]<<shift;
+        chunk=(n-i+dim-1)/dim;
+        if(chunk>32)chunk=32;
+        read = decode_packed_block(book,b,entries,chunk);
+        for(k=0;k<read;k++){
+          const ogg_int32_t *t = vlist+entries[k]*dim;
+          for (j=0;j<dim;)
+            a[i++]+=t[j++]<<shift;
+        }
+        if(read<chunk)return(-1);
       }
     }
   }
@@ -541,6 +550,8 @@ long vorbis_book_decodevv_add(codebook *book,ogg_int32_t **a,
 
     if (!(book->dim&1) && ch==2)
       return vorbis_book_decodevv_add_2ch_even(book,a,offset,b,n,point);
+    if (ch==1)
+      return vorbis_book_decodev_add(book,&a[0][offset],b,n,point);
 
     if(shift>=0){
     
@@ -277,23 +277,19 @@ static inline void channel_couple(ogg_int32_t *pcmM, ogg_int32_t *pcmA, unsigned
     }
 }
 #else
+/* Branch free, so that the compiler can vectorise it where the target has
+   SIMD compares and selects */
 static inline void channel_couple(ogg_int32_t *pcmM, ogg_int32_t *pcmA, int n)
 {
     int j;
     for(j=0;j<n/2;j++){
-      ogg_int32_t mag = pcmM[j], ang = pcmA[j], _ang;
-        if(mag>0)
-          _ang = ang;
-        else
-          _ang = -ang;
-
-        if(ang>0)
-          pcmA[j]=mag-_ang;
-        else{
-          pcmA[j]=mag;
-          pcmM[j]=mag+_ang;
-        }
+      ogg_int32_t mag = pcmM[j], ang = pcmA[j];
+      ogg_int32_t neg = -(mag<=0);  /* ang is negated for mag <= 0 */
+      ogg_int32_t pos = -(ang>0);   /* which channel ang is applied to */
+      ogg_int32_t _ang = (ang^neg)-neg;
 
+      pcmA[j]=mag-(_ang&pos);
+      pcmM[j]=mag+(_ang&~pos);
     }
 }
 #endif
@@ -413,13 +413,16 @@ int vorbis_book_init_decode(codebook *c,const static_codebook *s){
     c->dec_firsttable=(ogg_uint32_t *)_ogg_calloc(tabn,sizeof(*c->dec_firsttable));
     c->dec_maxlength=0;
     
+    /* direct hits are stored as entry+1 with the codeword length in the
+       top byte, which saves the decoder a dec_codelengths lookup */
     for(i=0;i<n;i++){
       if(c->dec_maxlength<c->dec_codelengths[i])
         c->dec_maxlength=c->dec_codelengths[i];
       if(c->dec_codelengths[i]<=c->dec_firsttablen){
         ogg_uint32_t orig=bitreverse(c->codelist[i]);
         for(j=0;j<(1<<(c->dec_firsttablen-c->dec_codelengths[i]));j++)
-          c->dec_firsttable[orig|(j<<c->dec_codelengths[i])]=i+1;
+          c->dec_firsttable[orig|(j<<c->dec_codelengths[i])]=
+            ((ogg_uint32_t)c->dec_codelengths[i]<<24)|(i+1);
       }
     }
     
@@ -122,12 +122,12 @@ void little_endian_to_native (void *data, char *format)
     while (*format) {
         switch (*format) {
             case 'L':
-                *(long *)cp = letoh32(*(long *)cp);
+                *(int32_t *)cp = letoh32(*(int32_t *)cp);
                 cp += 4;
                 break;
 
             case 'S':
-                *(short *)cp = letoh16(*(short *)cp);
+                *(int16_t *)cp = letoh16(*(int16_t *)cp);
                 cp += 2;
                 break;
 
@@ -149,12 +149,12 @@ void native_to_little_endian (void *data, char *format)
     while (*format) {
         switch (*format) {
             case 'L':
-                *(long *)cp = htole32(*(long *)cp);
+                *(int32_t *)cp = htole32(*(int32_t *)cp);
                 cp += 4;
                 break;
 
             case 'S':
-                *(short *)cp = htole16(*(short *)cp);
+                *(int16_t *)cp = htole16(*(int16_t *)cp);
                 cp += 2;
                 break;
 
@@ -0,0 +1,198 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+
+/* The C version of decorr_stereo_pass_cont() for targets without one in
+ * assembly, kept here so the warble benchmark can build it with and without
+ * the vector path. Define DECORR_NO_SIMD before including it for the plain
+ * C loops.
+ *
+ * A weight update only looks at the residual read from the stream and at
+ * the term's source sample, never at the result, so the weights of the
+ * second of two sample pairs are the first's plus its update and, once both
+ * pairs' sources are decoded, the two can be done at once. apply_weight_f()
+ * only does 32-bit multiplies and adds that wrap, so the lanes use it and
+ * give what apply_weight() does for any sample a valid stream decodes to.
+ * That is done for terms 6 to 8. The lower terms take their sources from a
+ * vector done one or two loops back, and waiting on its two multiplies is
+ * slower than the plain loop. Terms 1, 17, 18 and the negative ones take the sample just
+ * decoded as the next source and stay one sample at a time, as does the mono
+ * pass. Like libmad/simd.h this needs a 32-bit lane multiply, so on x86 the
+ * vector pass is built for SSE4.1 and only taken when the CPU has it. NEON
+ * isn't enabled as it hasn't been tested. */
+
+#ifndef WAVPACK_DECORR_H
+#define WAVPACK_DECORR_H
+
+#if !defined(DECORR_NO_SIMD) && (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ >= 5)
+#define DECORR_SIMD
+
+#define DECORR_SIMD_TARGET __attribute__((target("sse4.1")))
+#define decorr_simd_ok()   __builtin_cpu_supports("sse4.1")
+
+typedef int32_t decorr_vec_t __attribute__((vector_size(16)));
+/* for loads and stores that are only int32_t aligned */
+typedef int32_t decorr_uvec_t __attribute__((vector_size(16), aligned(4),
+                                             may_alias));
+
+#if defined(__clang__)
+#define DECORR_SWAP(a) __builtin_shufflevector((a), (a), 2, 3, 0, 1)
+#define DECORR_LOW_UP(a) \
+    __builtin_shufflevector((a), (decorr_vec_t){ 0 }, 4, 5, 0, 1)
+#else
+#define DECORR_SWAP(a) __builtin_shuffle((a), (decorr_vec_t){ 2, 3, 0, 1 })
+#define DECORR_LOW_UP(a) \
+    __builtin_shuffle((a), (decorr_vec_t){ 0 }, (decorr_vec_t){ 4, 5, 0, 1 })
+#endif
+
+/* terms 6 to 8 on two sample pairs at a time, returns the pointer past the
+ * last pair done */
+static DECORR_SIMD_TARGET int32_t *decorr_stereo_pass_vec (int32_t *bptr, int32_t *eptr, int term,
+    int32_t delta, int32_t *weight_A, int32_t *weight_B)
+{
+    int32_t *tptr = bptr - term * 2;
+    decorr_vec_t weights = { *weight_A, *weight_B, *weight_A, *weight_B };
+    decorr_vec_t deltas = { delta, delta, delta, delta };
+
+    for (; eptr - bptr >= 4; bptr += 4, tptr += 4) {
+        decorr_vec_t source = *(decorr_uvec_t *) tptr;
+        decorr_vec_t sam = *(decorr_uvec_t *) bptr;
+        decorr_vec_t sign = (source ^ sam) >> 31;
+        /* update_weight() for each sample, 0 when either one is 0 */
+        decorr_vec_t update = ((deltas ^ sign) - sign) &
+            (source != 0) & (sam != 0);
+        decorr_vec_t weight = weights + DECORR_LOW_UP (update);
+
+        *(decorr_uvec_t *) bptr = sam + (((((source & 0xffff) * weight) >> 9) +
+            (((source & ~0xffff) >> 9) * weight) + 1) >> 1);
+        weights += update + DECORR_SWAP (update);
+    }
+
+    *weight_A = weights [0];
+    *weight_B = weights [1];
+    return bptr;
+}
+
+#endif /* !DECORR_NO_SIMD && x86 */
+
+static void decorr_stereo_pass_cont (struct decorr_pass *dpp, int32_t *buffer, int32_t sample_count)
+{
+    int32_t delta = dpp->delta, weight_A = dpp->weight_A, weight_B = dpp->weight_B;
+    int32_t *bptr, *tptr, *eptr = buffer + (sample_count * 2), sam_A, sam_B;
+    int k, i;
+
+    switch (dpp->term) {
+
+        case 17:
+            for (bptr = buffer; bptr < eptr; bptr += 2) {
+                sam_A = 2 * bptr [-2] - bptr [-4];
+                bptr [0] = apply_weight (weight_A, sam_A) + (sam_B = bptr [0]);
+                update_weight (weight_A, delta, sam_A, sam_B);
+
+                sam_A = 2 * bptr [-1] - bptr [-3];
+                bptr [1] = apply_weight (weight_B, sam_A) + (sam_B = bptr [1]);
+                update_weight (weight_B, delta, sam_A, sam_B);
+            }
+
+            dpp->samples_B [0] = bptr [-1];
+            dpp->samples_A [0] = bptr [-2];
+            dpp->samples_B [1] = bptr [-3];
+            dpp->samples_A [1] = bptr [-4];
+            break;
+
+        case 18:
+            for (bptr = buffer; bptr < eptr; bptr += 2) {
+                sam_A = (3 * bptr [-2] - bptr [-4]) >> 1;
+                bptr [0] = apply_weight (weight_A, sam_A) + (sam_B = bptr [0]);
+                update_weight (weight_A, delta, sam_A, sam_B);
+
+                sam_A = (3 * bptr [-1] - bptr [-3]) >> 1;
+                bptr [1] = apply_weight (weight_B, sam_A) + (sam_B = bptr [1]);
+                update_weight (weight_B, delta, sam_A, sam_B);
+            }
+
+            dpp->samples_B [0] = bptr [-1];
+            dpp->samples_A [0] = bptr [-2];
+            dpp->samples_B [1] = bptr [-3];
+            dpp->samples_A [1] = bptr [-4];
+            break;
+
+        default:
+            bptr = buffer;
+
+#ifdef DECORR_SIMD
+            if (dpp->term >= 6 && decorr_simd_ok ())
+                bptr = decorr_stereo_pass_vec (bptr, eptr, dpp->term, delta, &weight_A, &weight_B);
+#endif
+
+            for (tptr = bptr - (dpp->term * 2); bptr < eptr; bptr += 2, tptr += 2) {
+                bptr [0] = apply_weight (weight_A, tptr [0]) + (sam_A = bptr [0]);
+                update_weight (weight_A, delta, tptr [0], sam_A);
+
+                bptr [1] = apply_weight (weight_B, tptr [1]) + (sam_A = bptr [1]);
+                update_weight (weight_B, delta, tptr [1], sam_A);
+            }
+
+            for (k = dpp->term - 1, i = 8; i--; k--) {
+                dpp->samples_B [k & (MAX_TERM - 1)] = *--bptr;
+                dpp->samples_A [k & (MAX_TERM - 1)] = *--bptr;
+            }
+
+            break;
+
+        case -1:
+            for (bptr = buffer; bptr < eptr; bptr += 2) {
+                bptr [0] = apply_weight (weight_A, bptr [-1]) + (sam_A = bptr [0]);
+                update_weight_clip (weight_A, delta, bptr [-1], sam_A);
+                bptr [1] = apply_weight (weight_B, bptr [0]) + (sam_A = bptr [1]);
+                update_weight_clip (weight_B, delta, bptr [0], sam_A);
+            }
+
+            dpp->samples_A [0] = bptr [-1];
+            break;
+
+        case -2:
+            for (bptr = buffer; bptr < eptr; bptr += 2) {
+                bptr [1] = apply_weight (weight_B, bptr [-2]) + (sam_A = bptr [1]);
+                update_weight_clip (weight_B, delta, bptr [-2], sam_A);
+                bptr [0] = apply_weight (weight_A, bptr [1]) + (sam_A = bptr [0]);
+                update_weight_clip (weight_A, delta, bptr [1], sam_A);
+            }
+
+            dpp->samples_B [0] = bptr [-2];
+            break;
+
+        case -3:
+            for (bptr = buffer; bptr < eptr; bptr += 2) {
+                bptr [0] = apply_weight (weight_A, bptr [-1]) + (sam_A = bptr [0]);
+                update_weight_clip (weight_A, delta, bptr [-1], sam_A);
+                bptr [1] = apply_weight (weight_B, bptr [-2]) + (sam_A = bptr [1]);
+                update_weight_clip (weight_B, delta, bptr [-2], sam_A);
+            }
+
+            dpp->samples_A [0] = bptr [-1];
+            dpp->samples_B [0] = bptr [-2];
+            break;
+    }
+
+    dpp->weight_A = weight_A;
+    dpp->weight_B = weight_B;
+}
+
+#endif /* WAVPACK_DECORR_H */
@@ -543,102 +543,7 @@ static void decorr_stereo_pass (struct decorr_pass *dpp, int32_t *buffer, int32_
 
 #if (!defined(CPU_COLDFIRE) && !defined(CPU_ARM))
 
-static void decorr_stereo_pass_cont (struct decorr_pass *dpp, int32_t *buffer, int32_t sample_count)
-{
-    int32_t delta = dpp->delta, weight_A = dpp->weight_A, weight_B = dpp->weight_B;
-    int32_t *bptr, *tptr, *eptr = buffer + (sample_count * 2), sam_A, sam_B;
-    int k, i;
-
-    switch (dpp->term) {
-
-        case 17:
-            for (bptr = buffer; bptr < eptr; bptr += 2) {
-                sam_A = 2 * bptr [-2] - bptr [-4];
-                bptr [0] = apply_weight (weight_A, sam_A) + (sam_B = bptr [0]);
-                update_weight (weight_A, delta, sam_A, sam_B);
-
-                sam_A = 2 * bptr [-1] - bptr [-3];
-                bptr [1] = apply_weight (weight_B, sam_A) + (sam_B = bptr [1]);
-                update_weight (weight_B, delta, sam_A, sam_B);
-            }
-
-            dpp->samples_B [0] = bptr [-1];
-            dpp->samples_A [0] = bptr [-2];
-            dpp->samples_B [1] = bptr [-3];
-            dpp->samples_A [1] = bptr [-4];
-            break;
-
-        case 18:
-            for (bptr = buffer; bptr < eptr; bptr += 2) {
-                sam_A = (3 * bptr [-2] - bptr [-4]) >> 1;
-                bptr [0] = apply_weight (weight_A, sam_A) + (sam_B = bptr [0]);
-                update_weight (weight_A, delta, sam_A, sam_B);
-
-                sam_A = (3 * bptr [-1] - bptr [-3]) >> 1;
-                bptr [1] = apply_weight (weight_B, sam_A) + (sam_B = bptr [1]);
-                update_weight (weight_B, delta, sam_A, sam_B);
-            }
-
-            dpp->samples_B [0] = bptr [-1];
-            dpp->samples_A [0] = bptr [-2];
-            dpp->samples_B [1] = bptr [-3];
-            dpp->samples_A [1] = bptr [-4];
-            break;
-
-        default:
-            for (bptr = buffer, tptr = buffer - (dpp->term * 2); bptr < eptr; bptr += 2, tptr += 2) {
-                bptr [0] = apply_weight (weight_A, tptr [0]) + (sam_A = bptr [0]);
-                update_weight (weight_A, delta, tptr [0], sam_A);
-
-                bptr [1] = apply_weight (weight_B, tptr [1]) + (sam_A = bptr [1]);
-                update_weight (weight_B, delta, tptr [1], sam_A);
-            }
-
-            for (k = dpp->term - 1, i = 8; i--; k--) {
-                dpp->samples_B [k & (MAX_TERM - 1)] = *--bptr;
-                dpp->samples_A [k & (MAX_TERM - 1)] = *--bptr;
-            }
-
-            break;
-
-        case -1:
-            for (bptr = buffer; bptr < eptr; bptr += 2) {
-                bptr [0] = apply_weight (weight_A, bptr [-1]) + (sam_A = bptr [0]);
-                update_weight_clip (weight_A, delta, bptr [-1], sam_A);
-                bptr [1] = apply_weight (weight_B, bptr [0]) + (sam_A = bptr [1]);
-                update_weight_clip (weight_B, delta, bptr [0], sam_A);
-            }
-
-            dpp->samples_A [0] = bptr [-1];
-            break;
-
-        case -2:
-            for (bptr = buffer; bptr < eptr; bptr += 2) {
-                bptr [1] = apply_weight (weight_B, bptr [-2]) + (sam_A = bptr [1]);
-                update_weight_clip (weight_B, delta, bptr [-2], sam_A);
-                bptr [0] = apply_weight (weight_A, bptr [1]) + (sam_A = bptr [0]);
-                update_weight_clip (weight_A, delta, bptr [1], sam_A);
-            }
-
-            dpp->samples_B [0] = bptr [-2];
-            break;
-
-        case -3:
-            for (bptr = buffer; bptr < eptr; bptr += 2) {
-                bptr [0] = apply_weight (weight_A, bptr [-1]) + (sam_A = bptr [0]);
-                update_weight_clip (weight_A, delta, bptr [-1], sam_A);
-                bptr [1] = apply_weight (weight_B, bptr [-2]) + (sam_A = bptr [1]);
-                update_weight_clip (weight_B, delta, bptr [-2], sam_A);
-            }
-
-            dpp->samples_A [0] = bptr [-1];
-            dpp->samples_B [0] = bptr [-2];
-            break;
-    }
-
-    dpp->weight_A = weight_A;
-    dpp->weight_B = weight_B;
-}
+#include "decorr.h"
 
 #endif
 
@@ -335,7 +335,10 @@ void native_to_little_endian (void *data, char *format);
 #define apply_weight_f(weight, sample) (((((sample & 0xffff) * weight) >> 9) + \
     (((sample & ~0xffff) >> 9) * weight) + 1) >> 1)
 
-#if 1   // PERFCOND
+// 64-bit hosts get the whole product from one multiply, with no branch on the
+// size of the sample
+
+#if !(defined(__x86_64__) || defined(__LP64__) || defined(_WIN64))   // PERFCOND
 #define apply_weight(weight, sample) (sample != (short) sample ? \
     apply_weight_f (weight, sample) : apply_weight_i (weight, sample))
 #else
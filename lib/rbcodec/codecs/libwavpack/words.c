@@ -311,6 +311,7 @@ static void update_error_limit (struct words_data *w, uint32_t flags)
 }
 
 static uint32_t read_code (Bitstream *bs, uint32_t maxcode);
+static int32_t read_signed_code (Bitstream *bs, uint32_t maxcode, uint32_t low);
 
 // Read the next word from the bitstream "wvbits" and return the value. This
 // function can be used for hybrid or lossless streams, but since an
@@ -467,6 +468,11 @@ int32_t get_words (int32_t *buffer, int nsamples, uint32_t flags,
             }
         }
 
+        if (!c->error_limit && !(flags & HYBRID_BITRATE)) {
+            *buffer++ = read_signed_code (bs, high - low, low);
+            continue;
+        }
+
         mid = (high + low + 1) >> 1;
 
         if (!c->error_limit)
@@ -514,6 +520,64 @@ static uint32_t read_code (Bitstream *bs, uint32_t maxcode)
     return code;
 }
 
+// Read a code as read_code() does and then its sign bit, for lossless data.
+// The bit buffer is filled once with the fewest bits the two can take and
+// both are read straight from it, rather than checking it for every part.
+// Only the extra bit of a long code can need another byte, so no byte is read
+// before it is needed, just as with getbit().
+
+static int32_t read_signed_code (Bitstream *bs, uint32_t maxcode, uint32_t low)
+{
+    int bitcount = count_bits (maxcode);
+    uint32_t code, sign;
+
+    if (bitcount > 24) {
+        code = read_code (bs, maxcode) + low;
+        return getbit (bs) ? ~code : code;
+    }
+
+    while (bs->bc < (bitcount ? bitcount : 1)) {
+        if (++(bs->ptr) == bs->end)
+            bs->wrap (bs);
+
+        bs->sr |= (uint32_t) *(bs->ptr) << bs->bc;
+        bs->bc += 8;
+    }
+
+    if (bitcount) {
+        uint32_t extras = (1L << bitcount) - maxcode - 1;
+
+        code = bs->sr & ((1L << (bitcount - 1)) - 1);
+
+        if (code >= extras) {
+            if (bs->bc == bitcount) {
+                if (++(bs->ptr) == bs->end)
+                    bs->wrap (bs);
+
+                bs->sr |= (uint32_t) *(bs->ptr) << bs->bc;
+                bs->bc += 8;
+            }
+
+            code = (code << 1) - extras + ((bs->sr >> (bitcount - 1)) & 1);
+            bs->sr >>= bitcount;
+            bs->bc -= bitcount;
+        }
+        else {
+            bs->sr >>= bitcount - 1;
+            bs->bc -= bitcount - 1;
+        }
+    }
+    else
+        code = 0;
+
+    code += low;
+    sign = bs->sr & 1;
+    bs->sr >>= 1;
+    bs->bc--;
+
+    return sign ? ~code : code;
+}
+
 void send_words (int32_t *buffer, int nsamples, uint32_t flags,
                  struct words_data *w, Bitstream *bs)
 {
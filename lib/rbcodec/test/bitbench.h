@@ -0,0 +1,40 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef BITBENCH_H
+#define BITBENCH_H
+
+#include <stdint.h>
+
+enum bitbench_op
+{
+    BITBENCH_GET_BITS = 0,  /* get_bits() of varying width */
+    BITBENCH_SHOW_SKIP,     /* show_bits() then skip_bits() */
+    BITBENCH_GET_VLC,       /* get_vlc2() on a one level table */
+    BITBENCH_NUM_OPS
+};
+
+/* Run 'count' reads of kind 'op' over 'buf' and return a checksum of the
+   values read, which must match between the readers. 'buf' needs 8 bytes
+   of padding after 'size' and reads must stay within 'size' bytes */
+uint32_t bitbench_alt(enum bitbench_op op, const uint8_t *buf, int size,
+                      int count);
+uint32_t bitbench_cached(enum bitbench_op op, const uint8_t *buf, int size,
+                         int count);
+
+#endif /* BITBENCH_H */
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Microbenchmark body for the ffmpeg bit readers. bitbench_alt.c and
+ * bitbench_cached.c include this once each with BITBENCH_FN naming the
+ * entry point, the latter after selecting CACHED_BITSTREAM_READER.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef BITBENCH_FN
+#error BITBENCH_FN must be defined
+#endif
+
+#include "../codecs/lib/ffmpeg_get_bits.h"
+#include "bitbench.h"
+
+#define VLC_BITS 9
+
+/* a one level table for a unary-like code: n leading zeroes, then a one,
+   decode to n. Nine zeroes decode to 9 */
+static VLC_TYPE vlc_table[1 << VLC_BITS][2];
+
+static void init_vlc_table(void)
+{
+    for (int i = 0; i < (1 << VLC_BITS); i++) {
+        int n = 0;
+        while (n < VLC_BITS && !(i & (1 << (VLC_BITS - 1 - n))))
+            n++;
+        vlc_table[i][0] = n;
+        vlc_table[i][1] = n < VLC_BITS ? n + 1 : VLC_BITS;
+    }
+}
+
+uint32_t BITBENCH_FN(enum bitbench_op op, const uint8_t *buf, int size,
+                     int count)
+{
+    GetBitContext gb;
+    uint32_t sum = 0;
+
+    init_get_bits(&gb, buf, size * 8);
+
+    switch (op) {
+    case BITBENCH_GET_BITS:
+        /* widths 1..25 taken from the data itself */
+        for (int i = 0; i < count; i++) {
+            int n = 1 + buf[i & 1023] % 25;
+            sum = sum * 31 + get_bits(&gb, n);
+        }
+        break;
+    case BITBENCH_SHOW_SKIP:
+        /* peek 16, consume 1..16 depending on what was seen */
+        for (int i = 0; i < count; i++) {
+            unsigned int v = show_bits(&gb, 16);
+            skip_bits(&gb, 1 + (v & 15));
+            sum = sum * 31 + v;
+        }
+        break;
+    case BITBENCH_GET_VLC:
+        if (!vlc_table[0][1])
+            init_vlc_table();
+        for (int i = 0; i < count; i++)
+            sum = sum * 31 + get_vlc2(&gb, vlc_table, VLC_BITS, 1);
+        break;
+    default:
+        break;
+    }
+
+    return sum + get_bits_count(&gb);
+}
@@ -0,0 +1,123 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * The parts of the codec environment that flac.c and libffmpegFLAC use,
+ * for building them on the host without the rest of Rockbox. platform.h
+ * and codecs.h only include this.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef TEST_CODECLIB_H
+#define TEST_CODECLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/types.h>
+
+#define PLATFORM_NATIVE  (1<<0)
+#define PLATFORM_HOSTED  (1<<1)
+#define CONFIG_PLATFORM  PLATFORM_HOSTED
+
+#define ICODE_ATTR
+#define ICONST_ATTR
+#define IBSS_ATTR
+
+#define swap16(x) __builtin_bswap16(x)
+#define swap32(x) __builtin_bswap32(x)
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define av_log2(v) (31 - __builtin_clz((v) | 1))
+
+#define LOGF(...)
+#define CODEC_HEADER
+
+enum codec_status {
+    CODEC_OK = 0,
+    CODEC_ERROR = -1,
+};
+
+enum codec_entry_call_reason {
+    CODEC_LOAD = 0,
+    CODEC_UNLOAD,
+};
+
+enum codec_command_action {
+    CODEC_ACTION_HALT = -1,
+    CODEC_ACTION_NULL = 0,
+    CODEC_ACTION_SEEK_TIME = 1,
+};
+
+enum {
+    DSP_SET_FREQUENCY = 1,
+    DSP_SET_SAMPLE_DEPTH,
+    DSP_SET_STEREO_MODE,
+};
+
+enum {
+    STEREO_INTERLEAVED = 0,
+    STEREO_NONINTERLEAVED,
+    STEREO_MONO,
+};
+
+struct mp3entry {
+    unsigned long elapsed;
+    unsigned long offset;
+    unsigned long first_frame_offset;
+    unsigned long frequency;
+};
+
+struct codec_api {
+    off_t filesize;
+    off_t curpos;
+    struct mp3entry *id3;
+
+    size_t (*read_filebuf)(void *ptr, size_t size);
+    void *(*request_buffer)(size_t *realsize, size_t reqsize);
+    void (*advance_buffer)(size_t amount);
+    bool (*seek_buffer)(size_t newpos);
+    void (*seek_complete)(void);
+    void (*set_elapsed)(unsigned long value);
+    void (*configure)(int setting, intptr_t value);
+    long (*get_command)(intptr_t *param);
+    void (*pcmbuf_insert)(const void *ch1, const void *ch2, int count);
+    void (*yield)(void);
+
+    void *(*memset)(void *dst, int c, size_t length);
+    void *(*memcpy)(void *out, const void *in, size_t n);
+    int (*memcmp)(const void *s1, const void *s2, size_t n);
+};
+
+extern struct codec_api *ci;
+
+static inline int codec_init(void)
+    { return 0; }
+static inline void codec_set_replaygain(const struct mp3entry *id3)
+    { (void)id3; }
+
+/* no worker, the codec decodes everything on its own thread */
+#define codec_worker_yield ci->yield
+static inline bool codec_worker_create(void)
+    { return true; }
+static inline void codec_worker_submit(void (*fn)(void *arg), void *arg)
+    { fn(arg); }
+static inline void codec_worker_wait(void)
+    { }
+static inline void codec_worker_quit(void)
+    { }
+
+#endif /* TEST_CODECLIB_H */
@@ -0,0 +1,2 @@
+/* see codeclib.h */
+#include "codeclib.h"
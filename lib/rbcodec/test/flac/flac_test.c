@@ -0,0 +1,841 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * Test of the FLAC codec on the host: encodes generated streams that use
+ * every subframe type, LPC orders 1 to 32 at all coefficient precisions,
+ * both Rice methods, escaped partitions, wasted bits and every stereo
+ * decorrelation, runs them through flac.c on a stub codec API and checks
+ * each block it inserts against the source samples, straight through and
+ * across seeks, and the whole output against the MD5 in STREAMINFO. One of
+ * the streams leaves the total sample count in its STREAMINFO at 0, as a
+ * streaming encoder does. FLAC files named on the command line are decoded
+ * and checked against their MD5 too.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include "../../codecs/flac.c"
+#include "md5.h"
+
+#define RATE            44100
+#define BLOCK           4096
+#define STREAM_PADDING  64      /* the bit reader may look past the end */
+
+struct stream {
+    const char *name;
+    int channels;
+    int bps;
+    int ms;                     /* length */
+    bool no_total;              /* leave the total sample count 0 */
+    uint32_t total;
+    int32_t *pcm[2];            /* source, NULL for files */
+    uint8_t md5[16];
+    uint8_t *data;
+    size_t size;
+};
+
+static struct stream streams[] = {
+    { "16 bit stereo",                    2, 16, 15000, false },
+    { "24 bit stereo",                    2, 24, 10000, false },
+    { "12 bit mono",                      1, 12,  5000, false },
+    { "16 bit stereo, no total samples",  2, 16, 15000, true  },
+};
+
+/* where to seek, in thousandths of the stream's length */
+static const int seek_points[] = { 500, 100, 900, 0, 750, 200, 501, 990 };
+
+static int failures;
+
+static void fail(const struct stream *s, const char *fmt, ...)
+{
+    va_list ap;
+    printf("FAIL %s: ", s->name);
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+    failures++;
+}
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1664525 + 1013904223;
+    return rnd_state >> 8;
+}
+
+/* Adds samples to an MD5 the way STREAMINFO's is taken: interleaved,
+   little endian, in as many whole bytes as the sample size needs */
+static void md5_samples(md5_context *md5, const int32_t *const *pcm,
+                        int channels, int bps, int scale, int count)
+{
+    uint8_t buf[BLOCK * 2 * 4], *p = buf;
+    int bytes = (bps + 7) / 8;
+
+    for (int i = 0; i < count; i++) {
+        for (int ch = 0; ch < channels; ch++) {
+            int32_t v = pcm[ch][i] >> scale;
+            for (int b = 0; b < bytes; b++)
+                *p++ = v >> (8 * b);
+        }
+    }
+    md5_update(md5, buf, p - buf);
+}
+
+/*** Encoder ***/
+
+struct bitwriter {
+    uint8_t *buf;
+    size_t bits;
+};
+
+static void put_bits_w(struct bitwriter *bw, uint32_t v, int n)
+{
+    while (n-- > 0) {
+        size_t byte = bw->bits >> 3;
+        if ((bw->bits & 7) == 0)
+            bw->buf[byte] = 0;
+        if ((v >> n) & 1)
+            bw->buf[byte] |= 0x80 >> (bw->bits & 7);
+        bw->bits++;
+    }
+}
+
+static void put_unary(struct bitwriter *bw, uint32_t q)
+{
+    while (q >= 32) {
+        put_bits_w(bw, 0, 32);
+        q -= 32;
+    }
+    put_bits_w(bw, 1, q + 1);
+}
+
+static void align_w(struct bitwriter *bw)
+{
+    if (bw->bits & 7)
+        put_bits_w(bw, 0, 8 - (bw->bits & 7));
+}
+
+static uint8_t crc8_w(const uint8_t *buf, size_t len)
+{
+    uint8_t crc = 0;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static uint16_t crc16_w(const uint8_t *buf, size_t len)
+{
+    uint16_t crc = 0;
+    while (len--) {
+        crc ^= *buf++ << 8;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+    }
+    return crc;
+}
+
+static int signed_bits(int64_t v)
+{
+    int bits = 1;
+    while (v < -(INT64_C(1) << (bits - 1)) || v >= (INT64_C(1) << (bits - 1)))
+        bits++;
+    return bits;
+}
+
+/* counters that walk the encoder through its choices */
+static unsigned int kind_count, lpc_count, partition_count;
+
+static void encode_residual(struct bitwriter *bw, const int32_t *res, int n,
+                            int order)
+{
+    int max_porder = 0, porder, method;
+    unsigned int p;
+
+    while (max_porder < 8 && !(n & (1 << max_porder)) &&
+           (n >> (max_porder + 1)) >= order)
+        max_porder++;
+    porder = kind_count % (max_porder + 1);
+
+    /* method 1 when any partition wants a parameter above 14 and
+       every few subframes anyway */
+    method = (kind_count % 5) == 0;
+    int psize = n >> porder;
+    int kbest[1 << 8];
+    const int32_t *r = res;
+    for (p = 0; p < (1u << porder); p++) {
+        int count = psize - (p == 0 ? order : 0);
+        uint64_t best = UINT64_MAX;
+        kbest[p] = 0;
+        for (int k = 0; k <= 30; k++) {
+            uint64_t bits = (uint64_t)count * (k + 1);
+            for (int i = 0; i < count; i++) {
+                uint32_t u = ((uint32_t)r[i] << 1) ^ (uint32_t)(r[i] >> 31);
+                bits += u >> k;
+            }
+            if (bits < best) {
+                best = bits;
+                kbest[p] = k;
+            }
+        }
+        if (kbest[p] > 14)
+            method = 1;
+        r += count;
+    }
+
+    put_bits_w(bw, method, 2);
+    put_bits_w(bw, porder, 4);
+
+    r = res;
+    for (p = 0; p < (1u << porder); p++) {
+        int count = psize - (p == 0 ? order : 0);
+        int kmax = method ? 30 : 14;
+        int k = kbest[p];
+        uint32_t umax = 0;
+
+        for (int i = 0; i < count; i++) {
+            uint32_t u = ((uint32_t)r[i] << 1) ^ (uint32_t)(r[i] >> 31);
+            if (u > umax)
+                umax = u;
+        }
+
+        partition_count++;
+        if (partition_count % 13 == 0) {
+            /* escaped, one bit wider than needed every other time */
+            int bits = 0;
+            for (int i = 0; i < count; i++) {
+                int b = signed_bits(r[i]);
+                if (b > bits)
+                    bits = b;
+            }
+            if (bits && bits < 31 && (partition_count & 16))
+                bits++;
+            if (bits <= 31) {
+                put_bits_w(bw, method ? 31 : 15, method ? 5 : 4);
+                put_bits_w(bw, bits, 5);
+                for (int i = 0; i < count; i++)
+                    put_bits_w(bw, r[i], bits);
+                r += count;
+                continue;
+            }
+        }
+        else if (partition_count % 7 == 0) {
+            /* more than needed, up to 30 with method 1 */
+            k = MIN(kmax, k + 1 + (partition_count % 11));
+        }
+        else if (partition_count % 5 == 0 && k >= 3 && (umax >> (k - 3)) < 4096) {
+            /* less than needed, for longer quotients */
+            k -= 3;
+        }
+
+        put_bits_w(bw, k, method ? 5 : 4);
+        for (int i = 0; i < count; i++) {
+            uint32_t u = ((uint32_t)r[i] << 1) ^ (uint32_t)(r[i] >> 31);
+            put_unary(bw, u >> k);
+            put_bits_w(bw, u, k);
+        }
+        r += count;
+    }
+}
+
+/* Levinson-Durbin on the Hann windowed block */
+static void lpc_coefs(const int32_t *x, int n, int order, double *lpc)
+{
+    double r[33], a[33], tmp[33], e;
+    double *w = malloc(n * sizeof(double));
+
+    for (int i = 0; i < n; i++)
+        w[i] = x[i] * (0.5 - 0.5 * cos(2 * M_PI * i / (n - 1)));
+    for (int k = 0; k <= order; k++) {
+        r[k] = 0;
+        for (int i = 0; i < n - k; i++)
+            r[k] += w[i] * w[i + k];
+    }
+    free(w);
+
+    memset(a, 0, sizeof(a));
+    e = r[0] * (1.0 + 1e-9);
+    for (int i = 1; i <= order && e > 0; i++) {
+        double acc = r[i], k;
+        for (int j = 1; j < i; j++)
+            acc -= a[j] * r[i - j];
+        k = acc / e;
+        memcpy(tmp, a, sizeof(a));
+        tmp[i] = k;
+        for (int j = 1; j < i; j++)
+            tmp[j] = a[j] - k * a[i - j];
+        memcpy(a, tmp, sizeof(a));
+        e *= 1 - k * k;
+    }
+
+    for (int i = 0; i < order; i++)
+        lpc[i] = a[i + 1];
+}
+
+struct lpc_params {
+    int order;
+    int prec;
+    int shift;
+    int32_t qc[32];
+};
+
+/* Quantises the predictor and works out the residual, false when that
+   doesn't fit in 32 bits */
+static bool lpc_prepare(const int32_t *x, int n, struct lpc_params *lp,
+                        int32_t *res)
+{
+    double lpc[32], cmax = 0;
+    int lim = (1 << (lp->prec - 1)) - 1;
+
+    lpc_coefs(x, n, lp->order, lpc);
+    for (int i = 0; i < lp->order; i++)
+        if (fabs(lpc[i]) > cmax)
+            cmax = fabs(lpc[i]);
+    lp->shift = 0;
+    while (lp->shift < 15 && cmax * (1 << (lp->shift + 1)) <= lim)
+        lp->shift++;
+    /* not always the finest shift */
+    lp->shift -= MIN(lp->shift, (int)(lpc_count % 3));
+
+    for (int i = 0; i < lp->order; i++) {
+        long c = lround(lpc[i] * (1 << lp->shift));
+        lp->qc[i] = c > lim ? lim : c < -lim - 1 ? -lim - 1 : c;
+    }
+
+    for (int i = lp->order; i < n; i++) {
+        int64_t sum = 0, v;
+        for (int j = 0; j < lp->order; j++)
+            sum += (int64_t)lp->qc[j] * x[i - j - 1];
+        v = x[i] - (sum >> lp->shift);
+        if (v < INT32_MIN || v > INT32_MAX)
+            return false;
+        res[i - lp->order] = v;
+    }
+    return true;
+}
+
+static void fixed_residual(const int32_t *x, int n, int order, int32_t *res)
+{
+    for (int i = order; i < n; i++) {
+        int64_t p = 0;
+        switch (order) {
+            case 1: p = x[i-1]; break;
+            case 2: p = 2 * (int64_t)x[i-1] - x[i-2]; break;
+            case 3: p = 3 * (int64_t)x[i-1] - 3 * (int64_t)x[i-2] + x[i-3];
+                    break;
+            case 4: p = 4 * (int64_t)x[i-1] - 6 * (int64_t)x[i-2] +
+                        4 * (int64_t)x[i-3] - x[i-4];
+                    break;
+        }
+        res[i - order] = x[i] - p;
+    }
+}
+
+enum { SUB_VERBATIM, SUB_FIXED, SUB_LPC };
+
+static void encode_subframe(struct bitwriter *bw, const int32_t *in, int n,
+                            int bps)
+{
+    static int32_t x[BLOCK], res[BLOCK];
+    struct lpc_params lp = { 0 };
+    int wasted = 32, kind, order = 0;
+    bool constant = true;
+
+    for (int i = 0; i < n; i++) {
+        if (in[i] != in[0])
+            constant = false;
+        if (in[i])
+            wasted = MIN(wasted, __builtin_ctz(in[i]));
+    }
+
+    put_bits_w(bw, 0, 1);
+    if (constant) {
+        put_bits_w(bw, 0, 6);
+        put_bits_w(bw, 0, 1);
+        put_bits_w(bw, in[0], bps);
+        return;
+    }
+
+    if (wasted >= bps)
+        wasted = 0;
+    for (int i = 0; i < n; i++)
+        x[i] = in[i] >> wasted;
+    bps -= wasted;
+
+    /* the type comes before the wasted bits, pick it first */
+    switch (kind_count++ % 10) {
+        case 0:
+            kind = SUB_VERBATIM;
+            break;
+        case 1:
+        case 2:
+            kind = SUB_FIXED;
+            break;
+        default:
+            kind = SUB_LPC;
+            lp.order = lpc_count % 32 + 1;
+            lp.prec = 1 + lpc_count % 15;
+            lpc_count++;
+            if (n < 2 * lp.order || !lpc_prepare(x, n, &lp, res))
+                kind = SUB_FIXED;
+            break;
+    }
+    if (kind == SUB_FIXED) {
+        order = MIN((kind_count / 10) % 5, n - 1);
+        fixed_residual(x, n, order, res);
+    }
+
+    put_bits_w(bw, kind == SUB_VERBATIM ? 1 :
+                   kind == SUB_FIXED ? 8 + order : 32 + lp.order - 1, 6);
+    if (wasted) {
+        put_bits_w(bw, 1, 1);
+        put_unary(bw, wasted - 1);
+    } else {
+        put_bits_w(bw, 0, 1);
+    }
+
+    switch (kind) {
+        case SUB_VERBATIM:
+            for (int i = 0; i < n; i++)
+                put_bits_w(bw, x[i], bps);
+            break;
+        case SUB_FIXED:
+            for (int i = 0; i < order; i++)
+                put_bits_w(bw, x[i], bps);
+            encode_residual(bw, res, n, order);
+            break;
+        case SUB_LPC:
+            for (int i = 0; i < lp.order; i++)
+                put_bits_w(bw, x[i], bps);
+            put_bits_w(bw, lp.prec - 1, 4);
+            put_bits_w(bw, lp.shift, 5);
+            for (int i = 0; i < lp.order; i++)
+                put_bits_w(bw, lp.qc[i], lp.prec);
+            encode_residual(bw, res, n, lp.order);
+            break;
+    }
+}
+
+static void put_utf8(struct bitwriter *bw, uint32_t v)
+{
+    int extra = 1;
+
+    if (v < 0x80) {
+        put_bits_w(bw, v, 8);
+        return;
+    }
+    /* each continuation byte carries 6 bits, the first byte 6 - extra */
+    while (v >> (5 * extra + 6))
+        extra++;
+    put_bits_w(bw, ((1 << (extra + 1)) - 1) << 1, extra + 2);
+    put_bits_w(bw, v >> (6 * extra), 6 - extra);
+    for (int i = extra - 1; i >= 0; i--)
+        put_bits_w(bw, 0x80 | ((v >> (6 * i)) & 0x3f), 8);
+}
+
+static size_t encode_frame(uint8_t *out, const struct stream *s,
+                           uint32_t frame, uint32_t start, int n)
+{
+    static const int size_codes[25] = {
+        [8] = 1, [12] = 2, [16] = 4, [20] = 5, [24] = 6 };
+    static int32_t ch0[BLOCK], ch1[BLOCK];
+    struct bitwriter bw = { out, 0 };
+    const int32_t *l = s->pcm[0] + start;
+    const int32_t *r = s->pcm[s->channels - 1] + start;
+    int assignment, bps0 = s->bps, bps1 = s->bps;
+
+    if (s->channels == 1)
+        assignment = 0;
+    else
+        assignment = (int[]){ 1, 8, 9, 10 }[frame % 4];
+
+    for (int i = 0; i < n; i++) {
+        switch (assignment) {
+            case 0:
+            case 1:
+                ch0[i] = l[i];
+                ch1[i] = r[i];
+                break;
+            case 8:
+                ch0[i] = l[i];
+                ch1[i] = l[i] - r[i];
+                break;
+            case 9:
+                ch0[i] = l[i] - r[i];
+                ch1[i] = r[i];
+                break;
+            case 10:
+                ch0[i] = (l[i] + r[i]) >> 1;
+                ch1[i] = l[i] - r[i];
+                break;
+        }
+    }
+    if (assignment == 9)
+        bps0++;
+    else if (assignment >= 8)
+        bps1++;
+
+    put_bits_w(&bw, 0xfff8, 16);
+    /* block size, rate and sample size in each of the ways a header can
+       give them */
+    if (n == BLOCK && frame % 3 == 0)
+        put_bits_w(&bw, 12, 4);
+    else
+        put_bits_w(&bw, n <= 256 ? 6 : 7, 4);
+    put_bits_w(&bw, frame % 3 == 1 ? 9 : 0, 4);
+    put_bits_w(&bw, assignment, 4);
+    put_bits_w(&bw, frame & 1 ? size_codes[s->bps] : 0, 3);
+    put_bits_w(&bw, 0, 1);
+    put_utf8(&bw, frame);
+    if (!(n == BLOCK && frame % 3 == 0))
+        put_bits_w(&bw, n - 1, n <= 256 ? 8 : 16);
+    put_bits_w(&bw, crc8_w(out, bw.bits / 8), 8);
+
+    encode_subframe(&bw, ch0, n, bps0);
+    if (s->channels > 1)
+        encode_subframe(&bw, ch1, n, bps1);
+    align_w(&bw);
+    put_bits_w(&bw, crc16_w(out, bw.bits / 8), 16);
+
+    return bw.bits / 8;
+}
+
+/* Sines, noise, and blocks that are silent, constant, loud noise or
+   leave the low bits unused, depending on where they are */
+static void make_pcm(struct stream *s)
+{
+    const int32_t max = (1 << (s->bps - 1)) - 1;
+    const int32_t noise = max >> 10;
+    double freq[4], phase[4];
+
+    s->total = (uint64_t)s->ms * RATE / 1000;
+    for (int k = 0; k < 4; k++) {
+        freq[k] = 40 + rnd() % 6000;
+        phase[k] = (rnd() % 628) / 100.0;
+    }
+
+    for (int ch = 0; ch < s->channels; ch++) {
+        s->pcm[ch] = malloc(s->total * sizeof(int32_t));
+        for (uint32_t i = 0; i < s->total; i++) {
+            double t = (double)i / RATE, v = 0;
+            int64_t x;
+
+            for (int k = 0; k < 3; k++)
+                v += sin(2 * M_PI * freq[(k + ch) % 4] * t + phase[k]) / (k + 2);
+            x = v * (0.5 + 0.4 * sin(2 * M_PI * 0.7 * t)) * max;
+            x += (int32_t)(rnd() % (2 * noise + 1)) - noise;
+
+            switch ((i / BLOCK) % 8) {
+                case 3:
+                    x = (int32_t)(rnd() % (2 * (uint32_t)max + 1)) - max;
+                    break;
+                case 5:
+                    x = 0;
+                    break;
+                case 6:
+                    x = ch ? -max / 3 : max / 5;
+                    break;
+                case 7:
+                    x &= ~7;
+                    break;
+            }
+            s->pcm[ch][i] = x > max ? max : x < -max - 1 ? -max - 1 : x;
+        }
+    }
+}
+
+static void encode_stream(struct stream *s)
+{
+    uint8_t *frame_buf = malloc(MAX_FRAMESIZE * 4);
+    size_t capacity = 4096, min_frame = SIZE_MAX, max_frame = 0;
+    uint32_t frame = 0;
+    struct bitwriter bw;
+    md5_context md5;
+
+    make_pcm(s);
+    md5_starts(&md5);
+
+    s->data = malloc(capacity);
+    s->size = 42;               /* marker and STREAMINFO, filled in below */
+
+    for (uint32_t start = 0; start < s->total; start += BLOCK, frame++) {
+        int n = MIN(BLOCK, s->total - start);
+        size_t len = encode_frame(frame_buf, s, frame, start, n);
+
+        md5_samples(&md5, (const int32_t *const []){ s->pcm[0] + start,
+                    s->pcm[s->channels - 1] + start }, s->channels, s->bps,
+                    0, n);
+        if (len > MAX_FRAMESIZE)
+            fail(s, "frame %u is %zu bytes", frame, len);
+        if (len < min_frame)
+            min_frame = len;
+        if (len > max_frame)
+            max_frame = len;
+        while (s->size + len + STREAM_PADDING > capacity)
+            capacity *= 2;
+        s->data = realloc(s->data, capacity);
+        memcpy(s->data + s->size, frame_buf, len);
+        s->size += len;
+    }
+    memset(s->data + s->size, 0, STREAM_PADDING);
+
+    memcpy(s->data, "fLaC", 4);
+    bw.buf = s->data + 4;
+    bw.bits = 0;
+    put_bits_w(&bw, 0x80, 8);   /* last metadata block, STREAMINFO */
+    put_bits_w(&bw, 34, 24);
+    put_bits_w(&bw, BLOCK, 16);
+    put_bits_w(&bw, BLOCK, 16);
+    put_bits_w(&bw, min_frame, 24);
+    put_bits_w(&bw, max_frame, 24);
+    put_bits_w(&bw, RATE, 20);
+    put_bits_w(&bw, s->channels - 1, 3);
+    put_bits_w(&bw, s->bps - 1, 5);
+    put_bits_w(&bw, 0, 4);
+    put_bits_w(&bw, s->no_total ? 0 : s->total, 32);
+    md5_finish(&md5, s->md5);
+    memcpy(bw.buf + bw.bits / 8, s->md5, 16);
+
+    free(frame_buf);
+}
+
+/*** Stub codec API ***/
+
+static struct codec_api api;
+struct codec_api *ci = &api;
+static struct mp3entry id3;
+
+static const struct stream *cur;
+static long inserts, seeks_done, next_seek_at;
+static int64_t seek_target;     /* first sample due after a seek, or -1 */
+static int64_t end_pos;         /* one past the last sample inserted */
+static md5_context out_md5;
+
+static size_t read_filebuf(void *ptr, size_t size)
+{
+    size = MIN(size, cur->size - (size_t)api.curpos);
+    memcpy(ptr, cur->data + api.curpos, size);
+    api.curpos += size;
+    return size;
+}
+
+static void *request_buffer(size_t *realsize, size_t reqsize)
+{
+    *realsize = MIN(reqsize, cur->size - (size_t)api.curpos);
+    return cur->data + api.curpos;
+}
+
+static void advance_buffer(size_t amount)
+{
+    api.curpos = MIN(api.curpos + amount, cur->size);
+}
+
+static bool seek_buffer(size_t newpos)
+{
+    if (newpos > cur->size)
+        return false;
+    api.curpos = newpos;
+    return true;
+}
+
+static void seek_complete(void)
+{
+}
+
+static void set_elapsed(unsigned long value)
+{
+    (void)value;
+}
+
+static void configure(int setting, intptr_t value)
+{
+    (void)setting;
+    (void)value;
+}
+
+static void yield(void)
+{
+}
+
+static long get_command_straight(intptr_t *param)
+{
+    (void)param;
+    return CODEC_ACTION_NULL;
+}
+
+/* seeks to each of seek_points a few blocks after the one before */
+static long get_command_seek(intptr_t *param)
+{
+    if (seeks_done < (long)(sizeof(seek_points) / sizeof(seek_points[0])) &&
+        inserts >= next_seek_at) {
+        *param = (intptr_t)cur->ms * seek_points[seeks_done++] / 1000;
+        seek_target = (int64_t)*param * RATE / 1000;
+        next_seek_at = inserts + 3;
+        return CODEC_ACTION_SEEK_TIME;
+    }
+    return CODEC_ACTION_NULL;
+}
+
+static void pcmbuf_insert(const void *ch1, const void *ch2, int count)
+{
+    const int32_t *out[2] = { ch1, ch2 };
+    int64_t pos = (int64_t)fc.samplenumber + fc.sample_skip;
+    int scale = FLAC_OUTPUT_DEPTH - fc.bps;
+
+    inserts++;
+    if (out[0] != fc.decoded[0] + fc.sample_skip) {
+        fail(cur, "block %ld not from the codec's context", inserts);
+        return;
+    }
+    if (seek_target >= 0 && pos != seek_target)
+        fail(cur, "seek to %lld landed at %lld",
+             (long long)seek_target, (long long)pos);
+    seek_target = -1;
+    md5_samples(&out_md5, out, fc.channels, fc.bps, scale, count);
+    end_pos = pos + count;
+
+    if (!cur->pcm[0])
+        return;
+    if (pos + count > cur->total) {
+        fail(cur, "block at %lld runs past the end", (long long)pos);
+        return;
+    }
+    for (int ch = 0; ch < cur->channels; ch++) {
+        for (int i = 0; i < count; i++) {
+            if (out[ch][i] != (int32_t)((uint32_t)cur->pcm[ch][pos + i] << scale)) {
+                fail(cur, "channel %d sample %lld is %d, not %d", ch,
+                     (long long)(pos + i), out[ch][i] >> scale,
+                     cur->pcm[ch][pos + i]);
+                return;
+            }
+        }
+    }
+}
+
+static void run(const struct stream *s, long (*get_command)(intptr_t *param))
+{
+    enum codec_status status;
+    uint8_t md5[16];
+
+    cur = s;
+    memset(&id3, 0, sizeof(id3));
+    id3.frequency = RATE;
+    api.id3 = &id3;
+    api.filesize = s->size;
+    api.curpos = 0;
+    api.get_command = get_command;
+    inserts = seeks_done = next_seek_at = 0;
+    seek_target = -1;
+    end_pos = 0;
+    md5_starts(&out_md5);
+
+    status = codec_run();
+    if (status != CODEC_OK)
+        fail(s, "codec returned %d", status);
+    if (s->total && end_pos != s->total)
+        fail(s, "stopped at %lld of %u samples", (long long)end_pos, s->total);
+    if (seek_target >= 0)
+        fail(s, "nothing decoded after the last seek");
+
+    md5_finish(&out_md5, md5);
+    if (get_command == get_command_straight && memcmp(md5, s->md5, 16))
+        fail(s, "output doesn't match the MD5 in STREAMINFO");
+}
+
+/* Decodes a FLAC file without tags in front and checks it against the MD5
+   in its STREAMINFO */
+static void run_file(const char *name)
+{
+    struct stream s = { .name = name };
+    static const uint8_t no_md5[16];
+    FILE *f = fopen(name, "rb");
+    long size;
+
+    if (!f || fseek(f, 0, SEEK_END) || (size = ftell(f)) < 42) {
+        fail(&s, "can't read it");
+        if (f)
+            fclose(f);
+        return;
+    }
+    s.size = size;
+    s.data = calloc(1, s.size + STREAM_PADDING);
+    rewind(f);
+    if (fread(s.data, 1, s.size, f) != s.size || memcmp(s.data, "fLaC", 4)) {
+        fail(&s, "not a FLAC file");
+    } else if (((s.data[20] >> 1) & 7) > 1) {
+        /* the codec mixes more channels down to two */
+        printf("skip %s: more than two channels\n", name);
+    } else {
+        int before = failures;
+        memcpy(s.md5, s.data + 26, 16);
+        if (!memcmp(s.md5, no_md5, 16))
+            printf("skip %s: no MD5\n", name);
+        else {
+            run(&s, get_command_straight);
+            printf("%s %s: %lld samples\n", failures == before ? "ok  " : "FAIL",
+                   name, (long long)end_pos);
+        }
+    }
+    free(s.data);
+    fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+    api.read_filebuf = read_filebuf;
+    api.request_buffer = request_buffer;
+    api.advance_buffer = advance_buffer;
+    api.seek_buffer = seek_buffer;
+    api.seek_complete = seek_complete;
+    api.set_elapsed = set_elapsed;
+    api.configure = configure;
+    api.pcmbuf_insert = pcmbuf_insert;
+    api.yield = yield;
+    api.memset = memset;
+    api.memcpy = memcpy;
+    api.memcmp = memcmp;
+
+    codec_main(CODEC_LOAD);
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++)
+            run_file(argv[i]);
+        return failures ? 1 : 0;
+    }
+
+    for (unsigned int i = 0; i < sizeof(streams) / sizeof(streams[0]); i++) {
+        struct stream *s = &streams[i];
+        int before = failures;
+
+        encode_stream(s);
+        run(s, get_command_straight);
+        run(s, get_command_seek);
+        printf("%s %s: %u samples in %zu bytes\n",
+               failures == before ? "ok  " : "FAIL", s->name, s->total,
+               s->size);
+    }
+
+    printf("%d LPC, %d partitions, %s\n", lpc_count, partition_count,
+           failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
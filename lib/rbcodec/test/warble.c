@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include "buffering.h" /* TYPE_PACKET_AUDIO */
 #include "kernel.h"
@@ -41,6 +42,8 @@
 #include "sound.h"
 #include "tdspeed.h"
 #include "platform.h"
+#include "bitbench.h"
+#include "wvbench.h"
 
 /***************** EXPORTED *****************/
 
@@ -100,6 +103,7 @@ off_t filesize(int fd)
 static enum { MODE_PLAY, MODE_WRITE } mode;
 static bool use_dsp = true;
 static bool enable_loop = false;
+static bool time_decode = false;
 static const char *config = "";
 
 /* Volume control */
@@ -824,9 +828,20 @@ static void decode_file(const char *input_fn)
         fprintf(stderr, "error: codec returned error from codec_main\n");
         exit(1);
     }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     if (c_hdr->run_proc() != CODEC_OK) {
         fprintf(stderr, "error: codec error\n");
     }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (time_decode) {
+        double secs = (end.tv_sec - start.tv_sec) +
+                      (end.tv_nsec - start.tv_nsec) / 1e9;
+        double audio = format.freq ?
+                       (double)num_output_samples / format.freq : 0;
+        fprintf(stderr, "decoded %lu samples in %.3f s, %.1fx realtime\n",
+                num_output_samples, secs, secs > 0 ? audio / secs : 0);
+    }
     c_hdr->entry_point(CODEC_UNLOAD);
 
     /* Close */
@@ -835,15 +850,99 @@ static void decode_file(const char *input_fn)
         close(input_fd);
 }
 
+/* compare the ALT and the cached ffmpeg bit readers on random data */
+static void run_bitbench(void)
+{
+    static const char * const names[BITBENCH_NUM_OPS] = {
+        "get_bits", "show_bits+skip", "get_vlc2",
+    };
+    const int size = 1 << 20, count = size / 4, reps = 20;
+    uint8_t *buf = malloc(size + 8);
+    if (!buf) {
+        fprintf(stderr, "error: malloc failed\n");
+        exit(1);
+    }
+    srand(1);
+    for (int i = 0; i < size + 8; i++)
+        buf[i] = rand();
+
+    for (int op = 0; op < BITBENCH_NUM_OPS; op++) {
+        uint32_t sum[2] = { 0, 0 };
+        double ns[2];
+        for (int r = 0; r < 2; r++) {
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int i = 0; i < reps; i++)
+                sum[r] += (r ? bitbench_cached : bitbench_alt)(op, buf, size,
+                                                                count);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            ns[r] = ((end.tv_sec - start.tv_sec) * 1e9 +
+                     (end.tv_nsec - start.tv_nsec)) / ((double)reps * count);
+        }
+        printf("%-15s alt %5.2f ns, cached %5.2f ns%s\n", names[op],
+               ns[0], ns[1], sum[0] != sum[1] ? " MISMATCH" : "");
+    }
+    free(buf);
+}
+
+/* compare WavPack's decorrelation pass with and without its vector path on
+   random residuals */
+static void run_wvbench(void)
+{
+    static const int terms[] = { 1, 2, 3, 4, 5, 6, 7, 8, 17, 18 };
+    const int count = 4096, reps = 2000;
+    const int size = WVBENCH_HISTORY + count * 2;
+    int32_t *in = malloc(size * sizeof(int32_t) * 2);
+    if (!in) {
+        fprintf(stderr, "error: malloc failed\n");
+        exit(1);
+    }
+    int32_t *buf = in + size;
+    srand(1);
+    for (int i = 0; i < size; i++)
+        in[i] = (rand() % 8192) - 4096;
+
+    if (!wvbench_simd_built)
+        printf("no vector path in this build\n");
+#if defined(__i386__) || defined(__x86_64__)
+    else if (!__builtin_cpu_supports("sse4.1")) {
+        printf("the vector path needs SSE4.1, which this CPU lacks\n");
+        free(in);
+        return;
+    }
+#endif
+
+    for (unsigned int t = 0; t < sizeof(terms) / sizeof(terms[0]); t++) {
+        uint32_t sum[2];
+        double ns[2];
+        for (int r = 0; r < 2; r++) {
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            sum[r] = (r ? wvbench_simd : wvbench_scalar)(terms[t], in, buf,
+                                                         count, reps);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            ns[r] = ((end.tv_sec - start.tv_sec) * 1e9 +
+                     (end.tv_nsec - start.tv_nsec)) / ((double)reps * count);
+        }
+        printf("wavpack term %2d scalar %5.2f ns, vector %5.2f ns%s\n",
+               terms[t], ns[0], ns[1], sum[0] != sum[1] ? " MISMATCH" : "");
+    }
+    free(in);
+}
+
 static void print_help(const char *progname)
 {
     fprintf(stderr, "Usage:\n"
                     "        Play: %s [options] INPUTFILE\n"
                     "Write to WAV: %s [options] INPUTFILE OUTPUTFILE\n"
+                    "   Benchmark: %s -b\n"
                     "\n"
                     "general options:\n"
                     "  -c a=1:b=2    Configuration (see below)\n"
                     "  -h            Show this help\n"
+                    "  -t            Print decode time and speed\n"
+                    "  -b            Benchmark the codec bit readers and WavPack\n"
+                    "                decorrelation and exit\n"
                     "\n"
                     "write to WAV options:\n"
                     "  -f            Write raw codec output converted to 64-bit float\n"
@@ -866,14 +965,18 @@ static void print_help(const char *progname)
                     "  %s in.adx -c loop=1:wait=44100:halt=1\n"
                     "  # Lower pitch 1 octave and write to out.wav\n"
                     "  %s in.ogg -c rate=0.5:tempo=2 out.wav\n"
-                    , progname, progname, progname, progname);
+                    , progname, progname, progname, progname, progname);
 }
 
 int main(int argc, char **argv)
 {
     int opt;
-    while ((opt = getopt(argc, argv, "c:fhr")) != -1) {
+    while ((opt = getopt(argc, argv, "bc:fhrt")) != -1) {
         switch (opt) {
+        case 'b':
+            run_bitbench();
+            run_wvbench();
+            exit(0);
         case 'c':
             config = optarg;
             break;
@@ -884,6 +987,9 @@ int main(int argc, char **argv)
             use_dsp = false;
             write_raw = true;
             break;
+        case 't':
+            time_decode = true;
+            break;
         case 'h': /* fallthrough */
         default:
             print_help(argv[0]);
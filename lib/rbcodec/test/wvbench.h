@@ -0,0 +1,42 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef WVBENCH_H
+#define WVBENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* values before the pass, the 8 pairs the longest term looks back */
+#define WVBENCH_HISTORY 16
+
+/* Run WavPack's generic decorr_stereo_pass_cont() for 'term' 'reps' times
+   over 'count' >= 8 interleaved stereo pairs from 'in', which starts with
+   WVBENCH_HISTORY values of history, using 'buf' of the same size to work
+   in. Returns a checksum of the output and of the pass state, which must
+   match between the builds */
+uint32_t wvbench_scalar(int term, const int32_t *in, int32_t *buf, int count,
+                        int reps);
+uint32_t wvbench_simd(int term, const int32_t *in, int32_t *buf, int count,
+                      int reps);
+
+/* false when this host build has no vector path, wvbench_simd() is then the
+   same C loops */
+extern const bool wvbench_simd_built;
+
+#endif /* WVBENCH_H */
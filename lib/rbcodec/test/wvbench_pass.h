@@ -0,0 +1,51 @@
+/***************************************************************************
+ *             __________               __   ___.
+ *   Open      \______   \ ____   ____ |  | _\_ |__   _______  ___
+ *   Source     |       _//  _ \_/ ___\|  |/ /| __ \ /  _ \  \/  /
+ *   Jukebox    |    |   (  <_> )  \___|    < | \_\ (  <_> > <  <
+ *   Firmware   |____|_  /\____/ \___  >__|_ \|___  /\____/__/\_ \
+ *                     \/            \/     \/    \/            \/
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This software is distributed on an "AS IS" basis, WITHOUT WARRANTY OF ANY
+ * KIND, either express or implied.
+ *
+ ****************************************************************************/
+#ifndef WVBENCH_FN
+#error WVBENCH_FN must be defined
+#endif
+
+#include <string.h>
+#include "../codecs/libwavpack/wavpack.h"
+#include "../codecs/libwavpack/decorr.h"
+#include "wvbench.h"
+
+uint32_t WVBENCH_FN(int term, const int32_t *in, int32_t *buf, int count,
+                    int reps)
+{
+    const int size = WVBENCH_HISTORY + count * 2;
+    struct decorr_pass dpp;
+    uint32_t sum = 0;
+
+    memset(&dpp, 0, sizeof(dpp));
+    for (int r = 0; r < reps; r++) {
+        dpp.term = term;
+        dpp.delta = 2;
+        dpp.weight_A = 384;
+        dpp.weight_B = -256;
+        memcpy(buf, in, size * sizeof(int32_t));
+        decorr_stereo_pass_cont(&dpp, buf + WVBENCH_HISTORY, count);
+    }
+
+    for (int i = 0; i < size; i++)
+        sum = sum * 31 + buf[i];
+    for (int i = 0; i < MAX_TERM; i++)
+        sum = (sum * 31 + dpp.samples_A[i]) * 31 + dpp.samples_B[i];
+
+    return (sum * 31 + dpp.weight_A) * 31 + dpp.weight_B;
+}